@@ -0,0 +1,71 @@
+#ifndef ANALYSIS_FRAMEWORK_CHECKPOINT_HXX
+#define ANALYSIS_FRAMEWORK_CHECKPOINT_HXX
+/*--------------------------------------------------------------------------*
+ *  Checkpointing of long event loops. Progress on an output file is kept in
+ *  a sidecar journal (<output>.journal) listing the input entry up to which
+ *  the output is safely on disk; a run with --resume (Global.Resume) picks up
+ *  from there instead of recreating the output.
+ *--------------------------------------------------------------------------*/
+
+#include "Framework/Sharding.hxx"
+
+#include <ROOT/RDataFrame.hxx>
+#include <Rtypes.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TTree;
+
+namespace Analysis {
+
+class Checkpoint {
+public:
+    // resume = false starts a fresh journal, discarding any previous one
+    Checkpoint(const std::string& outputPath, bool resume);
+
+    static std::string JournalPath(const std::string& outputPath) { return outputPath + ".journal"; }
+
+    // Input entries [.., LastCommitted()) are in the output; -1 if nothing is
+    Long64_t LastCommitted() const { return fLastCommitted; }
+    bool     IsComplete()    const { return fComplete; }
+
+    // Record that the output now holds everything before entryEnd. Call only
+    // after the data is flushed, so the journal never runs ahead of the file.
+    void Commit(Long64_t entryEnd);
+    void MarkComplete();
+
+    // Split [begin, end) of a tree into runs of whole clusters, each at
+    // least chunkEntries long (the last one may be shorter)
+    static std::vector<std::pair<Long64_t, Long64_t>>
+    ClusterChunks(TTree& tree, Long64_t begin, Long64_t end, Long64_t chunkEntries);
+
+    // Snapshot treeName in inFile to outFile in cluster-aligned chunks of about
+    // chunkEntries input entries. Every chunk gets its own data frame over an
+    // entry list of the chunk's entries, so build's filters and Defines see
+    // only those; build is told the chunk's tree entries [first, last). Each
+    // chunk goes to its own part file and is journalled; parts are
+    // fast-merged into outFile at the end. With resume, committed chunks are
+    // not redone.
+    using NodeBuilder = std::function<ROOT::RDF::RNode(ROOT::RDF::RNode, Long64_t first, Long64_t last)>;
+    static void SnapshotInChunks(const NodeBuilder& build,
+                                 const std::string& inFile,
+                                 const std::string& treeName,
+                                 const ShardSpec& shard,
+                                 Long64_t chunkEntries,
+                                 const std::string& outFile,
+                                 const std::vector<std::string>& columns,
+                                 const ROOT::RDF::RSnapshotOptions& opt,
+                                 bool resume);
+
+private:
+    void Append(const std::string& line) const;
+
+    std::string fPath;
+    Long64_t    fLastCommitted = -1;
+    bool        fComplete      = false;
+};
+
+} // namespace Analysis
+#endif
@@ -7,6 +7,7 @@
 #include <TEnv.h>
 #include <Rtypes.h>          
 #include <string>
+#include <vector>
 
 
 namespace Analysis {
@@ -30,6 +31,15 @@ public:
 
     virtual Long64_t EntryCount() const { return -1; }
 
+    // Declared data dependencies, used by the ModuleManager stage cache to skip
+    // modules whose outputs are already up to date. A module declaring no
+    // outputs is always run.
+    virtual std::vector<std::string> Inputs()  const { return {}; }
+    virtual std::vector<std::string> Outputs() const { return {}; }
+
+    // Prefix of this module's configuration keys, e.g. "Slimmer" for Slimmer.*
+    virtual std::string ConfigSection() const { return Name(); }
+
     //Access to the configuration object
     const TEnv& Cfg() const { return *fCfg; }
 
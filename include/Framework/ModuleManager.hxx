@@ -8,8 +8,10 @@
 
 #include <TStopwatch.h>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include "Framework/Module.hxx"
+#include "Framework/StageCache.hxx"
 
 namespace Analysis {
 
@@ -22,13 +24,35 @@ public:
     void Add(std::unique_ptr<Module> mod);
 
     // Run the full life-cycle for all registered modules.
+    // With Global.StageCache true, modules whose outputs are up to date
+    // (see StageCache) are skipped; everything after the first module that
+    // does run is re-run as well.
+    // With Global.Scheduler dag, modules are run as a dependency graph instead
+    // of in insertion order (see RunGraph).
     void Run();
 
 private:
     // Determine how many events to loop over.
-    Long64_t DetermineNEntries() const;
+    Long64_t DetermineNEntries(const Module& m) const;
+
+    // Initialise → event loop → Finalise for a single module
+    void RunModule(Module& m) const;
+
+    // Strict insertion-order execution (default)
+    void RunSequential();
+
+    // Build a DAG from the modules' Inputs()/Outputs() and run ready nodes
+    // concurrently on up to Global.MaxConcurrentModules threads, sharing a
+    // Global.NThreads implicit-MT core budget. A failing node only stops
+    // the nodes that depend on it.
+    void RunGraph();
+
+    // parents[j] = indices of the earlier modules whose outputs module j consumes
+    std::vector<std::vector<std::size_t>> BuildDependencies() const;
 
     std::vector<std::unique_ptr<Module>> fModules;
+    std::unique_ptr<StageCache> fCache;
+    std::mutex fCacheMutex;   ///< the cache manifest is shared between graph nodes
 };
 
 } // namespace Analysis
@@ -0,0 +1,67 @@
+#ifndef ANALYSIS_FRAMEWORK_PREVIEW_HXX
+#define ANALYSIS_FRAMEWORK_PREVIEW_HXX
+/*--------------------------------------------------------------------------*
+ *  Preview runs (Global.Preview = f, 0 < f < 1) for iterating on cuts and
+ *  plots: readers visit only whole clusters, spread evenly over every
+ *  sample (one per 1/f clusters, at least one), so about a fraction f of
+ *  the baskets is read and decompressed. The selection depends only on the
+ *  file's cluster layout and f, never on the run.
+ *
+ *  Each sample's weights are scaled by (entries in range) / (entries read),
+ *  histograms are cached under their own key, and the plots and cut flows
+ *  state the preview and its statistical precision.
+ *--------------------------------------------------------------------------*/
+
+#include "Framework/Sharding.hxx"
+#include "Utils/ZoneMap.hxx"
+
+#include <TEnv.h>
+#include <Rtypes.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TTree;
+
+namespace Analysis {
+
+class PreviewSpec {
+public:
+    PreviewSpec() = default;
+    explicit PreviewSpec(double fraction);
+
+    // Reads Global.Preview (default 1, no preview)
+    static PreviewSpec FromConfig(const TEnv& cfg);
+
+    bool   Active()   const { return fFraction < 1.; }
+    double Fraction() const { return fFraction; }
+
+    // ".preview<f>", empty if not a preview
+    std::string Tag() const;
+
+    // Whole clusters of [begin, end) of tree to read, merged into ranges
+    std::vector<std::pair<Long64_t, Long64_t>> Clusters(TTree& tree, Long64_t begin, Long64_t end) const;
+
+    // "~N +- dN (r%)": count read, scaled to the full sample, with its statistical error
+    static std::string Estimate(double nRead, double weightScale);
+
+private:
+    double fFraction = 1.;
+};
+
+// The entries a reader visits in one input tree: the shard's entry range, the
+// preview's clusters of it and, of those, the clusters the zone maps allow
+// for the reader's cuts. Anything short of the whole tree is set as an entry
+// list on the tree, which then replaces ShardSpec::Restrict.
+struct ReadPlan {
+    bool     entryList   = false;   ///< tree restricted by an entry list
+    Long64_t zoneSkipped = 0;       ///< entries the zone maps ruled out
+    double   weightScale = 1.;      ///< entries in range / entries the preview kept
+
+    static ReadPlan Apply(TTree& tree, const std::string& file, const std::string& treeName,
+                          const ShardSpec& shard, const PreviewSpec& preview,
+                          const std::vector<ZoneMap::Term>& terms);
+};
+
+} // namespace Analysis
+#endif
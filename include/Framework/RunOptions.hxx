@@ -0,0 +1,36 @@
+#ifndef ANALYSIS_FRAMEWORK_RUNOPTIONS_HXX
+#define ANALYSIS_FRAMEWORK_RUNOPTIONS_HXX
+/*--------------------------------------------------------------------------*
+ *  Command line handling shared by the run_* executables:
+ *
+ *      run_<x> <config.cfg> [--shard i/N]    process shard i of N
+ *      run_merge <config.cfg> --shards N      merge the N shards' outputs
+ *      run_<x> <config.cfg> --resume          continue checkpointed outputs
+ *      run_<x> <config.cfg> --render-only     redraw plots from Global.HistCache
+ *
+ *  Options are folded into the configuration as Global.* keys so modules
+ *  only ever look at the TEnv. Files listed in Global.ConfigOverlays are
+ *  read on top of the config, their keys taking precedence.
+ *--------------------------------------------------------------------------*/
+
+#include <TEnv.h>
+#include <memory>
+#include <string>
+
+namespace Analysis {
+
+class RunOptions {
+public:
+    // Load the config named on the command line and apply any options to it.
+    // Prints usage and returns nullptr on bad arguments.
+    static std::unique_ptr<TEnv> LoadConfig(int argc, char* argv[], const std::string& exeName);
+
+private:
+    RunOptions()  = default;
+    ~RunOptions() = default;
+
+    static void PrintUsage(const std::string& exeName);
+};
+
+} // namespace Analysis
+#endif
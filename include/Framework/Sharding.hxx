@@ -0,0 +1,79 @@
+#ifndef ANALYSIS_FRAMEWORK_SHARDING_HXX
+#define ANALYSIS_FRAMEWORK_SHARDING_HXX
+/*--------------------------------------------------------------------------*
+ *  Deterministic split of a module's work across N independent processes
+ *  (run_<module> <cfg> --shard i/N), merged afterwards by run_merge.
+ *
+ *  Global.ShardMode entries : every shard reads entries [n*i/N, n*(i+1)/N)
+ *                             of every input and writes <out>.shardIofN.root
+ *  Global.ShardMode files   : shard i owns the input files k with k % N == i
+ *                             and writes their outputs under the usual names
+ *
+ *  Concatenating the entry-mode shards in index order reproduces the
+ *  unsharded output exactly, independent of N. Modules that combine all
+ *  samples into one product (Preselection, Plotter) always split by entries.
+ *--------------------------------------------------------------------------*/
+
+#include <TEnv.h>
+#include <Rtypes.h>
+#include <ROOT/RDataFrame.hxx>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Analysis {
+
+class ShardSpec {
+public:
+    enum class Mode { Entries, Files };
+
+    ShardSpec() = default;
+    ShardSpec(int index, int count, Mode mode = Mode::Entries);
+
+    // Reads Global.ShardIndex, Global.ShardCount and Global.ShardMode
+    static ShardSpec FromConfig(const TEnv& cfg);
+
+    // Unsharded name of the file the plot helpers write histograms to in a
+    // sharded run (Global.ShardHistFile, default histograms_<RunLabel>.root)
+    static std::string HistogramFile(const TEnv& cfg);
+
+    // Parses "i/N"; throws on malformed input or i >= N
+    static std::pair<int, int> ParseIndexCount(const std::string& spec);
+
+    bool Active() const { return fCount > 1; }
+    int  Index()  const { return fIndex; }
+    int  Count()  const { return fCount; }
+    Mode GetMode() const { return fMode; }
+
+    // Same shard, split by entries regardless of Global.ShardMode
+    ShardSpec ByEntries() const { return ShardSpec(fIndex, fCount, Mode::Entries); }
+
+    // ".shard<i>of<N>", empty if not sharded
+    std::string Tag() const;
+
+    // Name of shard i's copy of an output, e.g. out.root -> out.shard2of8.root.
+    // Unchanged in files mode, where each output is written by exactly one shard.
+    std::string OutputName(const std::string& path) const;
+    std::string OutputName(const std::string& path, int index) const;
+
+    // Indices of the input files this shard processes (all of them in entries mode)
+    std::vector<std::size_t> SelectFiles(std::size_t nFiles) const;
+
+    // [begin, end) of this shard's entries in a file with nEntries entries
+    std::pair<Long64_t, Long64_t> EntryRange(Long64_t nEntries) const;
+
+    // Restrict an RDataFrame over treeName in fileName to this shard's entry
+    // range with Range(). Throws under implicit MT, where only an entry list on
+    // the tree (ReadPlan::Apply) selects a range; an empty range works either way.
+    ROOT::RDF::RNode Restrict(ROOT::RDF::RNode node,
+                              const std::string& fileName,
+                              const std::string& treeName) const;
+
+private:
+    int  fIndex = 0;
+    int  fCount = 1;
+    Mode fMode  = Mode::Entries;
+};
+
+} // namespace Analysis
+#endif
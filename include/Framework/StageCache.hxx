@@ -0,0 +1,65 @@
+#ifndef ANALYSIS_FRAMEWORK_STAGECACHE_HXX
+#define ANALYSIS_FRAMEWORK_STAGECACHE_HXX
+/*--------------------------------------------------------------------------*
+ *  Make-like manifest of module runs: a module is up to date if its config
+ *  section, its input files and its recorded outputs are all unchanged.
+ *--------------------------------------------------------------------------*/
+
+#include <TEnv.h>
+#include <Rtypes.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "Framework/Module.hxx"
+
+namespace Analysis {
+
+class StageCache {
+public:
+    // hashContent = true also hashes file contents (slow for large ntuples),
+    // otherwise files are identified by size + modification time only.
+    explicit StageCache(const std::string& manifestPath, bool hashContent = false);
+
+    // True if the module ran before with the same key and its outputs are untouched.
+    bool IsUpToDate(const Module& m) const;
+
+    // Store the module's key and the current stamps of its outputs, then save.
+    void Record(const Module& m);
+
+    // Drop any record of the module (e.g. after a failed run).
+    void Invalidate(const Module& m);
+
+    // FNV-1a 64 bit hash, returned as 16 hex digits
+    static std::string Hash(const std::string& data);
+
+    // Hash of every <section>.* key/value pair in the config and of the
+    // Global.* keys that change a stage's outputs (shard, preview, sidecars, ...)
+    static std::string HashConfigSection(const TEnv& cfg, const std::string& section);
+
+private:
+    struct FileStamp {
+        Long64_t    size  = -1;
+        Long_t      mtime = 0;
+        std::string content;     ///< content hash, empty unless fHashContent
+        bool operator==(const FileStamp& o) const {
+            return size == o.size && mtime == o.mtime && content == o.content;
+        }
+    };
+
+    struct Entry {
+        std::string key;                            ///< config + inputs hash
+        std::map<std::string, FileStamp> outputs;   ///< path -> stamp at record time
+    };
+
+    FileStamp Stamp(const std::string& path) const;  ///< size == -1 if missing
+    std::string StageKey(const Module& m) const;
+    void Load();
+    void Save() const;
+
+    std::string fManifestPath;
+    bool        fHashContent;
+    std::map<std::string, Entry> fEntries;          ///< keyed by module Name()
+};
+
+} // namespace Analysis
+#endif
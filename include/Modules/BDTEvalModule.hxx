@@ -2,9 +2,11 @@
 #define BDTEVAL_MODULE_HXX
 
 #include "Framework/Module.hxx"
+#include "Framework/Sharding.hxx"
 #include "Utils/Plotter.hxx"
 
 #include <TEnv.h>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,6 +15,7 @@ namespace Analysis {
 class BDTEvalModule final : public Module {
 public:
     explicit BDTEvalModule(const TEnv& cfg);
+    ~BDTEvalModule() override;
 
     Long64_t EntryCount() const override;
     void Initialise() override;
@@ -21,6 +24,9 @@ public:
 
     std::string Name() const override { return "BDTEvalModule"; }
 
+    std::vector<std::string> Inputs()  const override;
+    std::vector<std::string> Outputs() const override;
+
 private:
     // config
     std::string fTreeName;
@@ -29,10 +35,39 @@ private:
     std::string fOutputTag;                // appended to filenames, default "_bdt"
     std::vector<std::string> fInputFiles;
     std::vector<std::string> fEvalVars;    // must match training variable names
+    ShardSpec fShard;                      // files / entry range handled by this process
+    Long64_t  fCheckpointEntries;          // commit progress every ~N entries, 0 = off
+    bool      fResume;                     // continue from the journal (--resume)
+    bool      fPerObject;                  // score every PFP of vector<float> eval vars
+    std::vector<std::string> fScoreReductions; // per-object mode: bdt_score_<r> branches; the first is bdt_score
+    std::string fLeadingBy;                // vector<float> ranking the objects for "leading"
+    int       fNThreads;                   // > 1: files and chunks scored concurrently
+    Long64_t  fChunkEntries;               // entries per work item in the parallel path
+
+    // One trained model (BDTEvalModule.Models, or the single WeightsXML/MethodName).
+    // The weights file is read once; every Scorer books its reader from the text.
+    struct Model {
+        std::string name;                  // empty for the single-model config
+        std::string column;                // bdt_score, or bdt_score_<name>
+        std::string weightsXML, method;
+        std::vector<std::string> vars;     // training variables, in training order
+        std::vector<size_t>      varIdx;   // position of each in fAllVars
+        std::string xml;                   // contents of weightsXML
+        std::string type;                  // TMVA method type, e.g. BDT
+    };
+    std::vector<Model>       fModels;
+    std::vector<std::string> fAllVars;     // union of the models' variables, each read once per entry
+
+    class Scorer;                          // booked readers of every model (one per thread)
+    class TreeScorer;                      // a Scorer attached to one input and output tree
+    std::unique_ptr<Scorer> fScorer;       // serial path
 
     // helpers
     static std::vector<std::string> TokeniseCSV(const std::string& s);
-    void ProcessOneFile(const std::string& inPath) const;
+    std::string OutputPathFor(const std::string& inPath) const;
+    void LoadModels();
+    void ProcessOneFile(const std::string& inPath);
+    void ProcessParallel(const std::vector<std::string>& inPaths);
 };
 
 } // namespace Analysis
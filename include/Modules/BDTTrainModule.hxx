@@ -4,6 +4,7 @@
  *  Helper functions to train and evaluate BDTs using TMVA
  *--------------------------------------------------------------------------*/
 #include "Framework/Module.hxx"
+#include "Utils/EventMatrix.hxx"
 #include "Utils/Plotter.hxx"
 
 #include <ROOT/RDataFrame.hxx>
@@ -25,6 +26,12 @@ public:
 
     std::string Name() const override { return "BDTTrainModule"; }
 
+    std::vector<std::string> Inputs()  const override { return fInputFiles; }
+    std::vector<std::string> Outputs() const override { return {WeightsXML(), "tmva_training_output.root"}; }
+
+    // Where TMVA writes the weights: <dataset>/weights/<job>_<method>.weights.xml
+    std::string WeightsXML() const { return fDatasetName + "/weights/" + fJobName + "_" + fMethodName + ".weights.xml"; }
+
 private:
     // Helper: build the input chain from a comma-separated list
     std::vector<std::unique_ptr<ROOT::RDataFrame>> BuildDataFrames(const std::vector<std::string>& files,
@@ -51,12 +58,19 @@ private:
                                const std::vector<double> MinNodeSizeVec,
                                const std::vector<int> nCutsVec);
 
-    // Train and return a figure of merit (e.g., ROC, AUC etc.)
+    // Test events held in memory for scoring the hyperparameter trials
+    EventMatrix LoadTestMatrix(const std::string& testSignalFile,
+                               const std::string& testBkgFile) const;
+
+    // Train and return a figure of merit (e.g., ROC, AUC etc.). With a test
+    // matrix, the AUC is computed in process from the freshly written weights
+    // and TMVA's test/evaluation pass and output file are skipped.
     double TrainBDT(const std::string& trainSignalFile,
                     const std::string& trainBkgFile,
                     const std::string& testSignalFile,
                     const std::string& testBkgFile,
-                    std::string methodString) const;
+                    std::string methodString,
+                    const EventMatrix* test = nullptr) const;
 
     /// Configuration
     std::vector<std::string>      fInputFiles;
@@ -66,6 +80,10 @@ private:
     std::vector<std::string> fVarsToKeep;///< thin list, incl. derived vars
     std::vector<std::string> fTrainVars;///< variables to use for training
     float fTrainFraction; ///< Fraction of events to use for training (rest for testing)
+    std::string fDatasetName; ///< TMVA DataLoader name, the weights directory
+    std::string fJobName;     ///< TMVA Factory job name
+    std::string fMethodName;  ///< name the BDT is booked under
+    std::vector<double> fBkgEfficiencies; ///< signal efficiency reported at these background efficiencies
 
     /// Working objects
     std::vector<std::unique_ptr<ROOT::RDataFrame>> dfVec; ///< DataFrames for each input file
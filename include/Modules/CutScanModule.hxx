@@ -0,0 +1,61 @@
+#ifndef CUTSCAN_MODULE_HXX
+#define CUTSCAN_MODULE_HXX
+/*--------------------------------------------------------------------------*
+ *  Scans the cut on one variable (normally bdt_score), or on a pair of
+ *  variables, for the best figure of merit without re-running the
+ *  Preselection or Plotter.
+ *
+ *  Every sample is read once into (x[, y], weight) arrays; the scan itself
+ *  runs in memory on the sorted arrays (Utils/CutScan.hxx). Samples whose
+ *  label contains "signal" are signal, "data" samples are left out (blind),
+ *  everything else is background.
+ *--------------------------------------------------------------------------*/
+
+#include "Framework/Module.hxx"
+#include "Utils/CutScan.hxx"
+
+#include <TEnv.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Analysis {
+
+class CutScanModule final : public Module {
+public:
+    explicit CutScanModule(const TEnv& cfg);
+
+    Long64_t EntryCount() const override { return 1; }
+    void Initialise() override;
+    void Execute(Long64_t /*entry*/) override {}   // nothing per-event
+    void Finalise() override {}
+
+    std::string Name() const override { return "CutScan"; }
+
+    std::vector<std::string> Inputs()  const override { return fInputFiles; }
+    std::vector<std::string> Outputs() const override { return {fOutputFile}; }
+
+private:
+    // Read the scanned columns and weights of every sample in one event
+    // loop per file; returns the signal and the background events
+    std::pair<ScoredEvents, ScoredEvents> Extract() const;
+
+    /// Configuration
+    std::vector<std::string> fInputFiles;
+    std::string              fTreeName;
+    std::vector<std::string> fSampleLabels;
+    std::vector<double>      fSampleWeights;        ///< POT scale per sample
+    std::vector<std::string> fSampleWeightColumns;  ///< per-event weight per sample, "-" for none
+    std::string fVariable;      ///< x of the "x > cut" scan
+    std::string fYVariable;     ///< optional y of a 2D scan
+    std::string fSelection;     ///< applied before the scan, optional
+    int    fNThresholds;        ///< cuts of a 1D scan
+    int    fNThresholds2D;      ///< cuts per axis of a 2D scan
+    std::vector<double> fRange, fYRange;   ///< min max of the cuts; default: range of the events
+    CutScan::FoM fFoM;
+    double fPunziSigma;
+    std::string fOutputFile;
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,53 @@
+#ifndef EVENTLOOKUP_MODULE_HXX
+#define EVENTLOOKUP_MODULE_HXX
+/*--------------------------------------------------------------------------*
+ *  Finds events by (run, sub, evt) through the files' event index sidecars
+ *  (Utils/EventIndex.hxx), building any that are missing or stale:
+ *
+ *    EventLookup.Files       ntuples to search
+ *    EventLookup.Events      1234:56:7890 ...   and/or
+ *    EventLookup.EventList   text file, one run:sub:evt per line
+ *    EventLookup.OutputFile  copy the found entries into mini-trees, optional
+ *    EventLookup.MatchFiles  later-stage ntuples: report which events of
+ *                            Files (or of the list) are in them, optional
+ *    EventLookup.MatchOutput write the matched run:sub:evt here, optional
+ *--------------------------------------------------------------------------*/
+
+#include "Framework/Module.hxx"
+#include "Utils/EventIndex.hxx"
+
+#include <TEnv.h>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+class EventLookupModule final : public Module {
+public:
+    explicit EventLookupModule(const TEnv& cfg);
+
+    Long64_t EntryCount() const override { return 1; }
+    void Initialise() override;
+    void Execute(Long64_t /*entry*/) override {}   // nothing per-event
+    void Finalise() override {}
+
+    std::string Name() const override { return "EventLookup"; }
+
+private:
+    // Merged index of files, from their sidecars where up to date
+    EventIndex LoadIndex(const std::vector<std::string>& files) const;
+
+    // Copy the entries at locs into one mini-tree per source file
+    void Extract(const std::vector<EventIndex::Location>& locs) const;
+
+    std::vector<std::string> fFiles;
+    std::vector<std::string> fMatchFiles;
+    std::vector<EventKey>    fEvents;
+    std::string              fTreeName;
+    std::vector<std::string> fKeyColumns;
+    std::string              fOutputFile;
+    std::string              fMatchOutput;
+};
+
+} // namespace Analysis
+#endif
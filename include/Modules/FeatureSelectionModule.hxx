@@ -0,0 +1,59 @@
+#ifndef FEATURESELECTION_MODULE_HXX
+#define FEATURESELECTION_MODULE_HXX
+/*--------------------------------------------------------------------------*
+ *  Ranks the BDT input variables and proposes a reduced set.
+ *
+ *  Importance is the drop in test-set AUC when one variable's column is
+ *  shuffled (permutation importance) under the trained weights. Variables
+ *  are then taken in order of importance; one correlated (|rho| above
+ *  FeatureSelection.MaxCorrelation) with an already kept variable joins
+ *  that variable's cluster and is dropped, as is one below
+ *  FeatureSelection.MinImportance.
+ *
+ *  The reduced lists are written as BDTTrainModule.TrainVars and
+ *  BDTEvalModule.EvalVars to FeatureSelection.OutputFile; listing that file
+ *  in Global.ConfigOverlays applies them to later runs.
+ *--------------------------------------------------------------------------*/
+
+#include "Framework/Module.hxx"
+#include "Utils/EventMatrix.hxx"
+
+#include <TEnv.h>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+class FeatureSelectionModule final : public Module {
+public:
+    explicit FeatureSelectionModule(const TEnv& cfg);
+
+    Long64_t EntryCount() const override { return 1; }
+    void Initialise() override;
+    void Execute(Long64_t /*entry*/) override {}   // nothing per-event
+    void Finalise() override {}
+
+    std::string Name() const override { return "FeatureSelection"; }
+
+    std::vector<std::string> Inputs()  const override { return {fTestSignalFile, fTestBkgFile, fWeightsXML}; }
+    std::vector<std::string> Outputs() const override { return {fOutputFile}; }
+
+private:
+    // Test-set AUC of the trained weights on m
+    double Score(const EventMatrix& m) const;
+
+    // Weighted correlation matrix of the variables, [i * nVars + j]
+    static std::vector<double> Correlations(const EventMatrix& m);
+
+    std::vector<std::string> fVars;   ///< defaults to BDTTrainModule.TrainVars
+    std::string fTestSignalFile;
+    std::string fTestBkgFile;
+    std::string fWeightsXML;
+    double fMinImportance;            ///< AUC drop below which a variable is dropped
+    double fMaxCorrelation;           ///< |rho| at which variables share a cluster
+    int    fSeed;
+    std::string fOutputFile;
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,55 @@
+#ifndef LIMIT_MODULE_HXX
+#define LIMIT_MODULE_HXX
+/*--------------------------------------------------------------------------*
+ *  CLs upper limits on the signal strength from the Plotter's logit_bdt
+ *  histograms (Plotter.HistOutputFile), for the nominal signal or for every
+ *  point of the signal mass grid.
+ *
+ *  Each (grid point, mu) toy set is an independent task with its own RNG
+ *  stream, seeded from (Limit.Seed, point, mu); the tasks are spread over
+ *  a thread pool, so results do not depend on the number of threads.
+ *--------------------------------------------------------------------------*/
+
+#include "Framework/Module.hxx"
+#include "Utils/ToyLimit.hxx"
+
+#include <TEnv.h>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+class LimitModule final : public Module {
+public:
+    explicit LimitModule(const TEnv& cfg);
+
+    Long64_t EntryCount() const override { return 1; }
+    void Initialise() override;
+    void Execute(Long64_t /*entry*/) override {}   // nothing per-event
+    void Finalise() override {}
+
+    std::string Name() const override { return "Limit"; }
+
+    std::vector<std::string> Inputs()  const override { return {fInputFile}; }
+    std::vector<std::string> Outputs() const override { return {fOutputFile}; }
+
+private:
+    // Signal, summed background and (optional) data of one grid point
+    ToyLimit LoadModel(const std::string& point) const;
+
+    std::string              fInputFile;
+    std::string              fSignalSample;
+    std::vector<std::string> fBackgroundSamples;
+    std::string              fDataSample;     ///< empty: expected limits only
+    std::vector<std::string> fGridPoints;     ///< empty: the nominal signal
+    int    fNToys;          ///< toys per hypothesis and mu
+    int    fMuSteps;        ///< mu values scanned per point
+    double fMuMax;          ///< top of the mu scan; 0 = from the yields
+    double fCL;             ///< confidence level of the limit
+    int    fSeed;
+    int    fNThreads;       ///< 0 = all cores
+    std::string fOutputFile;
+};
+
+} // namespace Analysis
+#endif
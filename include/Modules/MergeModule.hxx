@@ -0,0 +1,43 @@
+#ifndef MERGE_MODULE_HXX
+#define MERGE_MODULE_HXX
+/*--------------------------------------------------------------------------*
+ *  Combines the outputs of N shards (see Framework/Sharding.hxx) into the
+ *  unsharded files: trees are concatenated in shard order, histograms summed.
+ *--------------------------------------------------------------------------*/
+
+#include "Framework/Module.hxx"
+#include "Framework/Sharding.hxx"
+
+#include <TEnv.h>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+class MergeModule final : public Module {
+public:
+    explicit MergeModule(const TEnv& cfg);
+
+    Long64_t EntryCount() const override { return 1; }
+    void Initialise() override;
+    void Execute(Long64_t /*entry*/) override {}   // nothing per-event
+    void Finalise() override {}
+
+    std::string Name() const override { return "Merge"; }
+
+    std::vector<std::string> Outputs() const override { return fTargets; }
+
+private:
+    // Merge the shard copies of one target; returns false if there was nothing to merge
+    bool MergeOne(const std::string& target) const;
+
+    int  fShardCount;                   ///< N of the shards being merged
+    int  fNThreads;                     ///< targets merged concurrently
+    bool fRender;                       ///< draw the merged histograms
+    bool fRemoveShards;                 ///< delete shard files after a successful merge
+    std::string fHistFile;              ///< merged histogram file
+    std::vector<std::string> fTargets;  ///< unsharded output names
+};
+
+} // namespace Analysis
+#endif
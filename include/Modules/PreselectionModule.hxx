@@ -2,7 +2,11 @@
 #define PRESELECTION_MODULE_HXX
 
 #include "Framework/Module.hxx"
+#include "Framework/Sharding.hxx"
+#include "Framework/Preview.hxx"
 #include "Utils/Plotter.hxx"
+#include "Utils/PlotBook.hxx"
+#include "Utils/ZoneMap.hxx"
 
 #include <ROOT/RDataFrame.hxx>
 #include <TChain.h>
@@ -23,10 +27,15 @@ public:
 
     std::string Name() const override { return "Preselection"; }
 
+    std::vector<std::string> Inputs()  const override { return fInputFiles; }
+    std::vector<std::string> Outputs() const override;
+
 private:
-    // Helper: build the input chain from a comma-separated list
+    // Helper: build the input chain from a comma-separated list. Each tree is
+    // restricted to its read plan (preview, zone maps); plans gets them per file.
     std::vector<std::unique_ptr<ROOT::RDataFrame>> BuildDataFrames(const std::vector<std::string>& files,
-                                            const std::string& treeName) const;
+                                            const std::string& treeName,
+                                            std::vector<ReadPlan>* plans = nullptr) const;
 
     /// Configuration
     std::vector<std::string> fInputFiles;      ///< comma-separated list
@@ -35,8 +44,17 @@ private:
     std::vector<std::string> cuts;       ///< List of cuts strings to apply
     std::vector<std::string> fSampleLabels; ///< Labels for the samples, e.g. "data", "overlay", "signal"
     std::vector<double> fSampleWeights; ///< Weights for each sample to normalise to POT
+    std::vector<std::string> fSampleWeightColumns; ///< Per-event weight column/expression per sample, "-" for none
     std::vector<std::string> fVarsToKeep;///< thin list, incl. derived vars
     std::string        fRunLabel;        ///< “numi_run4b”, …
+    ShardSpec          fShard;           ///< entry range of every sample handled by this process
+    PreviewSpec        fPreview;         ///< Global.Preview: a cluster sample of every input, no ntuples written
+    PlotBook           fPlots;           ///< Preselection.Plots, filled after the cuts
+    Long64_t           fNEntries = 0;    ///< entries read, from the cut flow
+    bool               fEventIndex;      ///< write a (run, sub, evt) index sidecar per output
+    std::vector<std::string> fIndexColumns; ///< run, subrun and event columns of the index
+    std::vector<std::string> fZoneMapColumns; ///< write a zone map sidecar of these per output
+    std::vector<ZoneMap::Term> fZoneTerms; ///< terms of the cuts checked against input zone maps
 
     /// Working objects
     std::unique_ptr<TChain>     fChain;
@@ -2,10 +2,14 @@
 #define SLIMMER_MODULE_HXX
 
 #include "Framework/Module.hxx"
+#include "Framework/Checkpoint.hxx"
+#include "Framework/Preview.hxx"
+#include "Framework/Sharding.hxx"
 #include "Utils/Plotter.hxx"
 
 #include <ROOT/RDataFrame.hxx>
 #include <TChain.h>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -23,10 +27,22 @@ public:
 
     std::string Name() const override { return "Slimmer"; }
 
+    std::vector<std::string> Inputs()  const override;
+    std::vector<std::string> Outputs() const override;
+
 private:
     // Helper: build the input vector of RDataFrames
     std::vector<std::unique_ptr<ROOT::RDataFrame>> BuildDataFrames(const std::vector<std::string>& files,
-                                            const std::string& treeName) const;
+                                            const std::string& treeName,
+                                            std::vector<ReadPlan>* plans = nullptr) const;
+
+    // Helper: good-run and duplicate filters of input file k (inFile), ahead of everything else.
+    // The duplicate scan and good-run list are loaded once; the result applies them to a node
+    // looping over entries [first, last) of inFile, once per event loop.
+    Checkpoint::NodeBuilder EventFilters(const std::string& inFile, std::size_t k) const;
+
+    // Helper: the derived (fiducial) variables kept in the slimmed tree
+    static ROOT::RDF::RNode DefineDerived(ROOT::RDF::RNode node);
 
     /// Configuration
     std::vector<std::string> fInputFiles;      ///< comma-separated list
@@ -34,6 +50,15 @@ private:
     std::vector<std::string> fOutputFiles;         ///< result files
     std::vector<std::string> fVarsToKeep;///< thin list, incl. derived vars
     std::string        fRunLabel;        ///< “run_x”, …
+    ShardSpec          fShard;           ///< this process's share of the inputs
+    Long64_t           fCheckpointEntries; ///< snapshot in journalled chunks of ~N entries, 0 = off
+    bool               fResume;          ///< continue from the journal (--resume)
+    bool               fEventIndex;      ///< write a (run, sub, evt) index sidecar per output
+    std::vector<std::string> fIndexColumns; ///< run, subrun and event columns of the index
+    std::vector<std::string> fGoodRunLists; ///< good-run list per input file, "-" = none
+    bool               fRemoveDuplicates; ///< drop repeated (run, sub, evt) within each input file
+    int                fDuplicateMemoryMB; ///< beyond this the duplicate search uses a Bloom filter
+    std::vector<std::string> fZoneMapColumns; ///< write a zone map sidecar of these per output
 
     /// Working objects
     std::unique_ptr<TChain>     fChain;
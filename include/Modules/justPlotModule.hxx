@@ -2,10 +2,16 @@
 #define PLOTTER_MODULE_HXX
 
 #include "Framework/Module.hxx"
+#include "Framework/Sharding.hxx"
+#include "Framework/Preview.hxx"
 #include "Utils/Plotter.hxx"
+#include "Utils/UniverseHist.hxx"
+#include "Utils/PlotBook.hxx"
+#include "Utils/ZoneMap.hxx"
 
 #include <ROOT/RDataFrame.hxx>
 #include <TChain.h>
+#include <TH1D.h>
 #include <memory>
 #include <vector>
 
@@ -23,17 +29,76 @@ public:
 
     std::string Name() const override { return "Plotter"; }
 
+    std::vector<std::string> Inputs()  const override { return fInputFiles; }
+    std::vector<std::string> Outputs() const override {
+        std::vector<std::string> out;
+        for (const auto& fmt : Plotter::OutputFormats()) {
+            out.push_back("bdt_score_full_hist." + fmt);
+            for (const auto& p : fGridPoints) out.push_back("bdt_score_full_hist_" + p + "." + fmt);
+        }
+        if (!fSystWeights.empty()) out.push_back(fSystFile);
+        if (!fHistOutputFile.empty()) out.push_back(fShard.OutputName(fHistOutputFile));
+        if (!fPlots.OutputFile().empty()) out.push_back(fShard.OutputName(fPlots.OutputFile()));
+        return out;
+    }
+
 private:
-    // Helper: build the input chain from a comma-separated list
+    // Helper: build the input chain from a comma-separated list. Each tree is
+    // restricted to its read plan (preview, zone maps for Plotter.Cuts); plans gets them per file.
     std::vector<std::unique_ptr<ROOT::RDataFrame>> BuildDataFrames(const std::vector<std::string>& files,
-                                            const std::string& treeName) const;
+                                            const std::string& treeName,
+                                            std::vector<ReadPlan>* plans = nullptr) const;
+
+    // The sample node of a data frame: this shard's entries unless the read plan covers them, then Plotter.Cuts
+    ROOT::RDF::RNode SampleNode(ROOT::RDataFrame& df, const std::string& file, const ReadPlan& plan) const;
+
+    // Book the universes of weight branch wCol for logit_bdt (Plotter.SystWeightType)
+    ROOT::RDF::RResultPtr<UniverseHist> BookUniverses(ROOT::RDF::RNode node, const std::string& name,
+                                                      const std::string& cvWeightCol,
+                                                      const std::string& wCol,
+                                                      int nBins, double xMin, double xMax) const;
+
+    // Signal mass grid: logit of every point's score for each sample, per
+    // point and sample, booked lazily or taken from the histogram cache
+    struct GridBooking {
+        std::vector<std::vector<ROOT::RDF::RResultPtr<TH1D>>> lazy;   ///< [point][sample]
+        std::vector<std::vector<TH1D>>        hists;                   ///< [point][sample]
+        std::vector<std::vector<std::string>> keys;                    ///< [point][sample]
+        std::vector<std::unique_ptr<ROOT::RDataFrame>> signalFrames;   ///< one per point
+    };
+    GridBooking BookGrid(std::vector<ROOT::RDF::RNode>& nodes,
+                         const std::vector<std::string>& weightCols,
+                         const std::vector<std::string>& contexts,
+                         int nBins, double xMin, double xMax, bool renderOnly) const;
+    void DrawGrid(GridBooking& grid) const;
 
     /// Configuration
     std::vector<std::string>      fInputFiles;
     std::string        fTreeName;        ///< name of the input TTree
     std::vector<std::string> fSampleLabels; ///< Labels for the samples, e.g. "data", "overlay", "signal"
     std::vector<double> fSampleWeights; ///< Weights for each sample to normalise to POT
+    std::vector<std::string> fSampleWeightColumns; ///< Per-event weight column/expression per sample, "-" for none
     std::vector<std::string> fVarsToKeep;///< thin list, incl. derived vars
+    ShardSpec fShard;                    ///< entry range of every sample handled by this process
+    PreviewSpec fPreview;                ///< Global.Preview: a cluster sample of every input
+    std::vector<std::string> fCuts;      ///< Plotter.Cuts, applied to every sample before filling
+    std::vector<ZoneMap::Term> fZoneTerms; ///< terms of the cuts checked against input zone maps
+
+    /// Systematic universes (Plotter.SystWeights); empty = stat. band only
+    std::vector<std::string> fSystWeights;  ///< vector-of-weights branches, e.g. weightsGenie weightsFlux
+    std::vector<std::string> fSystSamples;  ///< sample labels that carry those branches
+    std::string        fSystWeightType;  ///< element type of the branches: ushort, float or double
+    double             fSystWeightScale; ///< stored weight -> multiplicative factor (1e-3 for ushort)
+    std::string        fSystFile;        ///< covariances and bands are written here
+    std::string        fHistOutputFile;  ///< logit_bdt histograms for the limit module, optional
+
+    PlotBook           fPlots;           ///< Plotter.Plots, filled next to logit_bdt
+
+    /// Signal mass grid (Plotter.GridPoints); empty = the single signal sample
+    std::vector<std::string> fGridPoints;      ///< hypothesis names, e.g. m100 m150
+    std::vector<std::string> fGridSignalFiles; ///< signal file of each point
+    std::string        fGridSignalSample;      ///< sample label each point's signal replaces
+    std::string        fGridScoreColumn;       ///< score column, "{point}" replaced by the point
 
     /// Working objects
     std::unique_ptr<TChain>     fChain;
@@ -0,0 +1,88 @@
+#ifndef ANALYSIS_UTILS_CUTSCAN_HXX
+#define ANALYSIS_UTILS_CUTSCAN_HXX
+
+/*--------------------------------------------------------------------------*
+ *  Threshold scans of "x > cut" (and "x > cut && y > cutY") over events
+ *  held in memory as contiguous (x, y, weight) arrays.
+ *
+ *  Each class is sorted once by x, descending, and turned into a running
+ *  sum of weights, so the yield above any threshold is one binary search:
+ *  a scan over T thresholds costs O(n log n + T log n).
+ *
+ *  The 2D scan sweeps the x thresholds from high to low, adding the events
+ *  that pass into a histogram over the y thresholds; a whole row of y cuts
+ *  is then one suffix sum, O(n log Ty + Tx * Ty) in total.
+ *--------------------------------------------------------------------------*/
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Analysis {
+
+// Events of one class (all signal or all background samples together)
+struct ScoredEvents {
+    std::vector<double> x, y, w;   ///< y is empty for 1D scans
+
+    std::size_t Size() const { return x.size(); }
+    void Append(const ScoredEvents& other);
+};
+
+class CutScan {
+public:
+    enum class FoM { SOverSqrtB, Asimov, Punzi };
+
+    struct Point {
+        double cut = 0., cutY = 0.;
+        double s = 0., b = 0., sumw2B = 0.;   ///< yields passing; sumw2B for the MC error on b
+        double fom = 0.;
+    };
+
+    // Parse "s_over_sqrtb", "asimov" or "punzi"
+    static FoM ParseFoM(const std::string& name);
+
+    // Figure of merit of s signal and b background passing, of sTotal signal
+    // before the cut. punziSigma is the "a" of Punzi's s_eff / (a/2 + sqrt(b)).
+    static double Evaluate(FoM fom, double s, double b, double sTotal, double punziSigma = 5.0);
+
+    // Sorts and accumulates the arrays; sig and bkg are consumed
+    CutScan(ScoredEvents sig, ScoredEvents bkg);
+
+    // nThresholds evenly spaced cuts in [min, max)
+    static std::vector<double> Thresholds(int nThresholds, double min, double max);
+
+    std::vector<Point> Scan(const std::vector<double>& cuts, FoM fom, double punziSigma = 5.0) const;
+
+    // Row-major [ix][iy] over cutsX x cutsY; both classes need y values
+    std::vector<Point> Scan2D(const std::vector<double>& cutsX, const std::vector<double>& cutsY,
+                              FoM fom, double punziSigma = 5.0) const;
+
+    double TotalSignal()     const { return fSig.Total(); }
+    double TotalBackground() const { return fBkg.Total(); }
+
+    // Smallest and largest x of either class
+    std::pair<double, double> Range() const;
+
+private:
+    struct Sorted {
+        std::vector<double> x, y, w;
+        std::vector<double> cumW, cumW2;   ///< cumW[k] = sum of w[0..k)
+
+        explicit Sorted(ScoredEvents ev);
+        // Number of events with x > cut
+        std::size_t Above(double cut) const;
+        double Total() const { return cumW.back(); }
+    };
+
+    // For every cutX, the sum of weights (and squared weights) per cutY of
+    // the events passing both cuts; calls row(ix, sumW, sumW2)
+    template <typename Row>
+    static void Sweep(const Sorted& ev, const std::vector<double>& cutsX,
+                      const std::vector<double>& cutsY, Row&& row);
+
+    Sorted fSig, fBkg;
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,102 @@
+#ifndef ANALYSIS_UTILS_EVENTFILTER_HXX
+#define ANALYSIS_UTILS_EVENTFILTER_HXX
+
+/*--------------------------------------------------------------------------*
+ *  Event-level filters applied by the Slimmer before anything else is read.
+ *
+ *  GoodRunList: the good (run, subrun) pairs as a table over the run range,
+ *  each run either entirely good or holding a bitset of its good subruns,
+ *  so a check is two array reads.
+ *
+ *  DuplicateFilter: the (run, sub, evt) keys occurring more than once in a
+ *  tree, each with its lowest entry. They are found in a pass over the three
+ *  key columns read straight from the tree (Utils/TreeScan), so the entries
+ *  are the tree's own however the pass is threaded. An event loop then
+ *  decides by key, not by entry number, which RDataFrame only knows as
+ *  rdfentry_: an unrepeated key is kept and a repeated one once, by the loop
+ *  whose entry range (shard, checkpoint chunk) holds its lowest entry. That
+ *  loop keeps the first copy it reaches, which is the lowest entry when it
+ *  runs single-threaded and any of the copies in its range under implicit MT.
+ *  Keys go into a sharded hash set when that fits the memory budget; beyond
+ *  it a Bloom filter flags the keys seen more than once, and a second pass
+ *  confirms those exactly.
+ *--------------------------------------------------------------------------*/
+
+#include "Utils/EventIndex.hxx"
+
+#include <Rtypes.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+class GoodRunList {
+public:
+    // One entry per line, '#' comments:
+    //   run                 every subrun of run
+    //   run sub             one subrun
+    //   run first-last      subruns first..last
+    static GoodRunList FromFile(const std::string& path);
+
+    bool Contains(std::uint32_t run, std::uint32_t sub) const
+    {
+        if (run < fFirstRun || run - fFirstRun >= fSlot.size()) return false;
+        const std::int32_t slot = fSlot[run - fFirstRun];
+        if (slot < 0) return slot == kAllSubruns;
+        const auto& bits = fSubruns[slot];
+        return sub / 64 < bits.size() && ((bits[sub / 64] >> (sub % 64)) & 1u);
+    }
+
+    std::size_t NRuns() const;
+
+private:
+    static constexpr std::int32_t kBad = -1, kAllSubruns = -2;
+
+    std::uint32_t                           fFirstRun = 0;
+    std::vector<std::int32_t>               fSlot;      ///< per run from fFirstRun: kBad, kAllSubruns or fSubruns index
+    std::vector<std::vector<std::uint64_t>> fSubruns;   ///< good-subrun bitsets of partially good runs
+};
+
+class DuplicateFilter {
+public:
+    // Scan treeName in file; memoryMB bounds the hash set or Bloom filter
+    static DuplicateFilter Scan(const std::string& file, const std::string& treeName,
+                                const std::vector<std::string>& keyColumns, std::size_t memoryMB);
+
+    // The decisions of one event loop over entries [first, last) of the tree.
+    // Keep is thread-safe; a second loop needs a Pass of its own.
+    class Pass {
+    public:
+        Pass(const DuplicateFilter& filter, Long64_t first, Long64_t last);
+
+        // false for a repeated key already kept, or whose lowest entry is outside the range
+        bool Keep(std::uint32_t run, std::uint32_t sub, std::uint32_t evt);
+
+    private:
+        const DuplicateFilter&                  fFilter;
+        Long64_t                                fFirst, fLast;
+        std::vector<std::atomic<std::uint64_t>> fKept;   ///< bit per repeated key
+    };
+
+    std::size_t NDuplicates() const { return fNDuplicates; }
+    Long64_t    NEntries()    const { return fEntries; }
+    bool        UsedBloom()   const { return fBloom; }
+
+private:
+    struct Repeated {
+        EventKey key;
+        Long64_t first = 0;   ///< lowest entry holding key
+    };
+
+    std::vector<Repeated> fRepeated;   ///< sorted by key
+    std::size_t           fNDuplicates = 0;
+    Long64_t              fEntries = 0;
+    bool                  fBloom = false;
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,81 @@
+#ifndef ANALYSIS_UTILS_EVENTINDEX_HXX
+#define ANALYSIS_UTILS_EVENTINDEX_HXX
+
+/*--------------------------------------------------------------------------*
+ *  (run, sub, evt) -> (file, entry) index over one or more ntuples.
+ *
+ *  The index is one array of fixed-size records sorted by key; a lookup is
+ *  a binary search and loading it is one read. It is stored as a binary
+ *  sidecar next to the file it indexes (<file>.evtidx), written by the
+ *  Slimmer and Preselection when Global.EventIndex is set, and several
+ *  sidecars can be merged to look events up across samples and stages.
+ *--------------------------------------------------------------------------*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+struct EventKey {
+    std::uint32_t run = 0, sub = 0, evt = 0;
+
+    bool operator<(const EventKey& o) const
+    {
+        if (run != o.run) return run < o.run;
+        if (sub != o.sub) return sub < o.sub;
+        return evt < o.evt;
+    }
+    bool operator==(const EventKey& o) const { return run == o.run && sub == o.sub && evt == o.evt; }
+
+    // "run:sub:evt"
+    static EventKey Parse(const std::string& text);
+};
+
+class EventIndex {
+public:
+    struct Location {
+        std::string file;
+        long long   entry = 0;
+    };
+
+    static std::string SidecarPath(const std::string& file) { return file + ".evtidx"; }
+
+    // Index every entry of treeName in each file; keyColumns names the run,
+    // subrun and event columns
+    static EventIndex Build(const std::vector<std::string>& files, const std::string& treeName,
+                            const std::vector<std::string>& keyColumns = {"run", "sub", "evt"});
+
+    // Build the index of file and write it as its sidecar
+    static void WriteSidecar(const std::string& file, const std::string& treeName,
+                             const std::vector<std::string>& keyColumns = {"run", "sub", "evt"});
+
+    void Write(const std::string& path) const;
+    static EventIndex Read(const std::string& path);
+
+    // Add the records of other (its files are appended to this index's)
+    void Merge(const EventIndex& other);
+
+    std::size_t Size()  const { return fRecords.size(); }
+    const std::vector<std::string>& Files() const { return fFiles; }
+
+    // Every (file, entry) holding key; duplicates give several locations
+    std::vector<Location> Find(const EventKey& key) const;
+    bool Contains(const EventKey& key) const;
+
+    // Distinct keys of this index, in order
+    std::vector<EventKey> Keys() const;
+
+private:
+    struct Record {
+        EventKey      key;
+        std::uint32_t file = 0;
+        std::int64_t  entry = 0;
+    };
+
+    std::vector<std::string> fFiles;
+    std::vector<Record>      fRecords;   ///< sorted by key, then file and entry
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,34 @@
+#ifndef ANALYSIS_UTILS_EVENTMATRIX_HXX
+#define ANALYSIS_UTILS_EVENTMATRIX_HXX
+
+/*--------------------------------------------------------------------------*
+ *  Labelled events held in memory for classifier studies: a row-major
+ *  float matrix of the input variables plus a weight and a class per
+ *  event. Rows are laid out as a TMVA::Reader expects its variables, so a
+ *  row is copied into the reader's buffer in one go.
+ *--------------------------------------------------------------------------*/
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+struct EventMatrix {
+    std::vector<std::string> vars;
+    std::vector<float>  values;     ///< [event][var]
+    std::vector<double> weights;
+    std::vector<char>   isSignal;
+
+    std::size_t NVars() const { return vars.size(); }
+    std::size_t Size()  const { return weights.size(); }
+    const float* Row(std::size_t i) const { return values.data() + i * vars.size(); }
+
+    // Append every entry of treeName in file as one class. vars may be
+    // expressions; weightCol may be empty for unit weights.
+    void Append(const std::string& file, const std::string& treeName,
+                const std::string& weightCol, bool signal);
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,70 @@
+#ifndef ANALYSIS_UTILS_HISTCACHE_HXX
+#define ANALYSIS_UTILS_HISTCACHE_HXX
+
+/*--------------------------------------------------------------------------*
+ *  ROOT file of filled histograms, keyed by a hash of everything that went
+ *  into filling them: input file identity, selection, variable, binning and
+ *  weight. Axis titles, colours and draw options are not part of the key,
+ *  so restyling a plot is served from the cache without an event loop.
+ *--------------------------------------------------------------------------*/
+
+#include <TFile.h>
+#include <TH1.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Analysis {
+
+class HistCache {
+public:
+    explicit HistCache(const std::string& path) : fPath(path) {}
+    ~HistCache() { Close(); }
+
+    const std::string& Path() const { return fPath; }
+
+    // Path, size and modification time of each file; nothing is opened
+    static std::string FileIdentity(const std::vector<std::string>& files);
+
+    // Cache key of one histogram. context identifies the inputs, selection
+    // and weight; the remaining arguments identify the fill itself.
+    static std::string Key(const std::string& context,
+                           const std::string& varName,
+                           int nBins, double xMin, double xMax,
+                           bool firstElement = false);
+
+    // The stored object, detached from the file; nullptr on a miss
+    template <typename T>
+    std::unique_ptr<T> Get(const std::string& key) const
+    {
+        std::lock_guard<std::mutex> lock(fMutex);
+        TFile* f = File(false);
+        if (!f) return nullptr;
+        std::unique_ptr<T> out(f->Get<T>(("h" + key).c_str()));
+        // A histogram read from a file is owned by it until detached
+        if constexpr (std::is_base_of_v<TH1, T>) if (out) out->SetDirectory(nullptr);
+        return out;
+    }
+
+    // Store obj (a TH1 or THnSparse) under key, replacing any previous entry
+    void Put(const std::string& key, const TObject& obj);
+
+    // Write the key list and close the file; it is reopened on the next Get or Put
+    void Close();
+
+private:
+    // The file, opened once and kept open (switched to UPDATE on the first
+    // write); nullptr if reading and the cache does not exist yet. fMutex held.
+    TFile* File(bool write) const;
+
+    std::string fPath;
+    mutable std::unique_ptr<TFile> fFile;
+    mutable bool       fWritable = false;
+    mutable std::mutex fMutex;    ///< modules may fill concurrently (DAG scheduler)
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,208 @@
+#ifndef ANALYSIS_UTILS_KERNELS_HXX
+#define ANALYSIS_UTILS_KERNELS_HXX
+
+/*--------------------------------------------------------------------------*
+ *  Per-event kernels used in RDataFrame Define/Filter calls. They live here
+ *  (inline, header only) so the modules and the micro-benchmark run exactly
+ *  the same code.
+ *--------------------------------------------------------------------------*/
+
+#include <ROOT/RVec.hxx>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace Analysis {
+namespace Kernels {
+
+using RVecF = ROOT::VecOps::RVec<float>;
+using RVecD = ROOT::VecOps::RVec<double>;
+using RVecI = ROOT::VecOps::RVec<int>;     // masks, e.g. the type of "trk_score_v > 0.5"
+
+// Sentinels used when a vector is empty (e.g. ext events without a neutrino slice),
+// chosen to be outside the fiducial volume so containment cuts reject them.
+constexpr float kSmall = -9999.f;
+constexpr float kBig   =  9999.f;
+
+// Minimum over two vectors; an empty vector contributes kSmall.
+inline float MinOfPair(const RVecF& a, const RVecF& b)
+{
+    const float aMin = a.empty() ? kSmall : *std::min_element(a.begin(), a.end());
+    const float bMin = b.empty() ? kSmall : *std::min_element(b.begin(), b.end());
+    return std::min(aMin, bMin);
+}
+
+// Maximum over two vectors; an empty vector contributes kBig.
+inline float MaxOfPair(const RVecF& a, const RVecF& b)
+{
+    const float aMax = a.empty() ? kBig : *std::max_element(a.begin(), a.end());
+    const float bMax = b.empty() ? kBig : *std::max_element(b.begin(), b.end());
+    return std::max(aMax, bMax);
+}
+
+// First element of a vector, or a default value if it is empty.
+inline float FirstOrDefault(const RVecF& v, float def = kSmall)
+{
+    return v.empty() ? def : v[0];
+}
+
+// log(s / (1 - s)) with the score clamped away from 0 and 1.
+inline float Logit(float score)
+{
+    const float eps = 1e-6f;
+    const float s = std::min(std::max(score, eps), 1.0f - eps);
+    return std::log(s / (1.0f - s));
+}
+
+//----------------------------------------------------------------------------
+//  Reductions of one jagged (per-PFP) column to a scalar. An RVec read from
+//  a tree views the branch's contiguous values for the event, so these are
+//  plain loops over a span, with no per-event allocation. mask (may be null)
+//  restricts the reduction to the elements where it is non-zero and must have
+//  one element per value; it is applied with selects rather than branches so
+//  the loops vectorise.
+//----------------------------------------------------------------------------
+
+// The per-object columns a kernel combines describe the same objects; a
+// length mismatch (e.g. a track column against a PFP mask) is a configuration
+// error, not something to truncate silently
+inline void CheckSameSize(const char* kernel, const char* what, std::size_t n, std::size_t nValues)
+{
+    if (n != nValues)
+        throw std::runtime_error(std::string("[Kernels] ") + kernel + ": " + what + " has " + std::to_string(n)
+                                 + " elements for " + std::to_string(nValues) + " values");
+}
+
+using Reduction = float (*)(const RVecF& v, const RVecI* mask);
+
+inline float ReduceFirst(const RVecF& v, const RVecI* mask)
+{
+    if (!mask) return FirstOrDefault(v);
+    CheckSameSize("ReduceFirst", "mask", mask->size(), v.size());
+    for (std::size_t i = 0; i < v.size(); ++i)
+        if ((*mask)[i]) return v[i];
+    return kSmall;
+}
+
+inline float ReduceMax(const RVecF& v, const RVecI* mask)
+{
+    constexpr float lowest = -std::numeric_limits<float>::infinity();
+    float out = lowest;
+    const float* x = v.data();
+    const std::size_t n = v.size();
+    if (mask) {
+        CheckSameSize("ReduceMax", "mask", mask->size(), n);
+        const int* m = mask->data();
+        for (std::size_t i = 0; i < n; ++i) out = std::max(out, m[i] ? x[i] : lowest);
+    }
+    else {
+        for (std::size_t i = 0; i < n; ++i) out = std::max(out, x[i]);
+    }
+    return out == lowest ? kSmall : out;
+}
+
+inline float ReduceMin(const RVecF& v, const RVecI* mask)
+{
+    constexpr float highest = std::numeric_limits<float>::infinity();
+    float out = highest;
+    const float* x = v.data();
+    const std::size_t n = v.size();
+    if (mask) {
+        CheckSameSize("ReduceMin", "mask", mask->size(), n);
+        const int* m = mask->data();
+        for (std::size_t i = 0; i < n; ++i) out = std::min(out, m[i] ? x[i] : highest);
+    }
+    else {
+        for (std::size_t i = 0; i < n; ++i) out = std::min(out, x[i]);
+    }
+    return out == highest ? kBig : out;
+}
+
+inline float ReduceSum(const RVecF& v, const RVecI* mask)
+{
+    float out = 0.f;
+    const float* x = v.data();
+    const std::size_t n = v.size();
+    if (mask) {
+        CheckSameSize("ReduceSum", "mask", mask->size(), n);
+        const int* m = mask->data();
+        for (std::size_t i = 0; i < n; ++i) out += m[i] ? x[i] : 0.f;
+    }
+    else {
+        for (std::size_t i = 0; i < n; ++i) out += x[i];
+    }
+    return out;
+}
+
+// Number of elements (passing the mask)
+inline float ReduceCount(const RVecF& v, const RVecI* mask)
+{
+    if (!mask) return static_cast<float>(v.size());
+    CheckSameSize("ReduceCount", "mask", mask->size(), v.size());
+    int out = 0;
+    const int* m = mask->data();
+    for (std::size_t i = 0; i < v.size(); ++i) out += m[i] != 0;
+    return static_cast<float>(out);
+}
+
+inline float ReduceMean(const RVecF& v, const RVecI* mask)
+{
+    const float n = ReduceCount(v, mask);
+    return n > 0.f ? ReduceSum(v, mask) / n : kSmall;
+}
+
+// Reduction by config name (first, max, min, sum, count, mean); nullptr if unknown
+inline Reduction FindReduction(const char* name)
+{
+    static const struct { const char* name; Reduction fn; } kTable[] = {
+        {"first", ReduceFirst}, {"max", ReduceMax}, {"min", ReduceMin},
+        {"sum", ReduceSum}, {"count", ReduceCount}, {"mean", ReduceMean}};
+    for (const auto& r : kTable)
+        if (std::strcmp(r.name, name) == 0) return r.fn;
+    return nullptr;
+}
+
+// Value of the element with the highest score (the leading object), e.g. the
+// theta of the most track-like PFP; kSmall if no element passes the mask.
+// score and mask must have one element per value.
+inline float LeadingBy(const RVecF& v, const RVecF& score, const RVecI* mask = nullptr)
+{
+    const std::size_t n = v.size();
+    CheckSameSize("LeadingBy", "score", score.size(), n);
+    if (mask) CheckSameSize("LeadingBy", "mask", mask->size(), n);
+    std::size_t best = n;
+    float bestScore = -std::numeric_limits<float>::infinity();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (mask && !(*mask)[i]) continue;
+        if (score[i] > bestScore) {
+            bestScore = score[i];
+            best = i;
+        }
+    }
+    return best == n ? kSmall : v[best];
+}
+
+// Elements where mask is non-zero; one mask element per value
+inline RVecF Masked(const RVecF& v, const RVecI& mask)
+{
+    CheckSameSize("Masked", "mask", mask.size(), v.size());
+    return v[mask];
+}
+
+// Per-element fill weights: element weight (if any, one per value) times the event weight
+inline RVecD ElementWeights(const RVecF& v, const RVecF* elementWeight, double eventWeight)
+{
+    RVecD out(v.size(), eventWeight);
+    if (elementWeight) {
+        CheckSameSize("ElementWeights", "element weight", elementWeight->size(), v.size());
+        for (std::size_t i = 0; i < out.size(); ++i) out[i] *= (*elementWeight)[i];
+    }
+    return out;
+}
+
+} // namespace Kernels
+} // namespace Analysis
+#endif
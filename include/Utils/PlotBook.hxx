@@ -0,0 +1,130 @@
+#ifndef ANALYSIS_UTILS_PLOTBOOK_HXX
+#define ANALYSIS_UTILS_PLOTBOOK_HXX
+
+/*--------------------------------------------------------------------------*
+ *  Histograms declared in the config rather than in code:
+ *
+ *    <S>.Plots            npfps energy ...          plots to fill
+ *    <S>.Plot.<p>.Expr    n_pfps                    column or expression
+ *    <S>.Plot.<p>.Bins    5 0.5 5.5                 nBins xMin xMax
+ *    <S>.Plot.<p>.XLabel  Number of PFParticles
+ *    <S>.Plot.<p>.YLabel  Count                     (default)
+ *    <S>.Plot.<p>.Reduce  first                     per-object column handling, optional:
+ *                           first|max|min|sum|count|mean   vector -> scalar (Kernels)
+ *                           leading                        element with the highest LeadingBy
+ *                           each                           fill every element
+ *    <S>.Plot.<p>.Mask    trk_score_v > 0.5         elements taking part, optional
+ *    <S>.Plot.<p>.LeadingBy  trk_score_v            score ranking the objects (leading)
+ *    <S>.Plot.<p>.ElementWeight  ...                per-element weight (each), optional
+ *    <S>.Plot.<p>.LogY    1                         optional
+ *    <S>.Plot.<p>.Selections  sideband signalbox    default: all selections
+ *    <S>.Selections       sideband signalbox        named regions, optional
+ *    <S>.Selection.<r>    topological_score < 0.3   filter of region r
+ *
+ *  Multi-dimensional plots add a y (and z) expression and binning:
+ *
+ *    <S>.Plot.<p>.YExpr   bdt_score                 2D histogram (TH2D)
+ *    <S>.Plot.<p>.YBins   50 0 1
+ *    <S>.Plot.<p>.ZExpr   ...  / .ZBins / .ZLabel   3D histogram (TH3D)
+ *    <S>.Plot.<p>.Profile 1                         mean of y per x bin (TProfile), no YBins
+ *    <S>.Plot.<p>.Sparse  1                         2D/3D as a hash map of filled bins
+ *    <S>.PlotFile         preselection_plots.root   where 2D/3D/profiles are written
+ *
+ *  Sparse plots are filled into per-slot maps merged after the loop
+ *  (SparseHist) and stored as THnSparseD, so memory follows the number of
+ *  filled bins. 2D histograms and profiles are also drawn per sample.
+ *
+ *  Every (plot, selection) pair of a sample is booked lazily on one filter
+ *  node per selection, so all of them are filled in a single event loop.
+ *--------------------------------------------------------------------------*/
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RResultHandle.hxx>
+#include <TEnv.h>
+#include <TObject.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+class PlotBook {
+public:
+    struct Axis {
+        int    nBins = 1;
+        double min = 0., max = 1.;
+    };
+    struct Hist {
+        std::string name, xLabel, yLabel, zLabel, reduce;
+        std::string mask, leadingBy, elementWeight;
+        std::vector<std::string> exprs;   ///< x[, y[, z]]
+        std::vector<Axis>        axes;    ///< one per binned expression (a profile bins x only)
+        bool        logy = false;
+        bool        profile = false;
+        bool        sparse = false;
+        std::vector<std::string> selections;
+
+        std::size_t Dim() const { return exprs.size(); }
+    };
+    struct Selection {
+        std::string name, cut;
+    };
+    // One histogram per sample: hist index and selection index (-1 = none)
+    struct Entry {
+        std::size_t hist = 0;
+        int         selection = -1;
+    };
+
+    // Histograms of one sample, booked lazily or taken from the cache
+    struct Booking {
+        std::string sample;
+        std::vector<ROOT::RDF::RResultHandle> handles;   ///< lazily booked results
+        std::vector<std::function<std::unique_ptr<TObject>()>> fetch;  ///< per entry; empty if cached
+        std::vector<std::string> keys;                   ///< per entry histogram cache keys
+        std::vector<std::unique_ptr<TObject>> objects;   ///< per entry (TH1D, TH2D, TH3D, TProfile
+                                                         ///< or THnSparseD), valid after Collect()
+    };
+
+    static PlotBook FromConfig(const TEnv& cfg, const std::string& section);
+
+    bool Empty() const { return fHists.empty(); }
+
+    // File receiving the 2D/3D/profile plots; empty if there are none
+    std::string OutputFile() const;
+    const std::vector<Entry>& Entries() const { return fEntries; }
+
+    // "<plot>" or "<plot>_<selection>"
+    std::string PlotName(const Entry& e) const;
+
+    // Book every entry for one sample. node may be null in render-only mode.
+    // context identifies the sample's inputs, selection and weight for the
+    // histogram cache; weightCol may be empty.
+    Booking Book(ROOT::RDF::RNode* node, const std::string& prefix, const std::string& sample,
+                 const std::string& weightCol, const std::string& context) const;
+
+    // Handles of the lazily booked results, e.g. for ROOT::RDF::RunGraphs
+    static std::vector<ROOT::RDF::RResultHandle> Handles(const Booking& b);
+
+    // Fetch the filled histograms (runs the loop if it has not run) and store new ones in the cache
+    void Collect(Booking& b, const std::string& prefix) const;
+
+    // One data/MC plot per 1D entry, basename <prefix>_full_hist_<PlotName>;
+    // 2D histograms and profiles per sample, <prefix>_hist_<PlotName>_<sample>.
+    // Multi-dimensional entries are written to ndFile (normally OutputFile()
+    // or a shard's copy of it).
+    void Draw(std::vector<Booking>& samples, const std::vector<std::string>& labels,
+              const std::string& prefix, const std::string& ndFile) const;
+
+private:
+    std::string HistName(const std::string& prefix, const Entry& e, const std::string& sample) const;
+
+    std::vector<Hist>      fHists;
+    std::vector<Selection> fSelections;
+    std::vector<Entry>     fEntries;
+    std::string            fOutputFile;
+};
+
+} // namespace Analysis
+#endif
@@ -10,6 +10,7 @@
 #include <memory>
 #include <TH1.h>
 #include <TH1D.h>
+#include <TH2D.h>
 #include <THStack.h>
 #include <TGraph.h>
 #include <TCanvas.h>
@@ -28,6 +29,8 @@ class TCanvas;
 
 namespace Analysis {
 
+class HistCache;
+
 class Plotter {
 public:
     // ------------------------------------------------------------------
@@ -43,9 +46,40 @@ public:
         int nBins,
         double xMin,
         double xMax,
-        bool removeVectorDuplicates = false);
+        bool removeVectorDuplicates = false,
+        const std::string& weight = "",
+        double scale = 1.0);
 
-    /** Draw a TH1 and write <basename>.png + .pdf into the current dir. */
+    /** As CreateTH1DFromRNode, but served from the histogram cache (if set)
+     *  when the same fill was done before. context must identify the input
+     *  files, selection and weight (see HistCache); titles are taken from
+     *  the arguments, not the cache. node may be null in render-only mode,
+     *  where a cache miss throws. */
+    static TH1D CachedTH1D(
+        const std::string& context,
+        ROOT::RDF::RNode* node,
+        const std::string& name,
+        const std::string& varName,
+        const std::string& xLabel,
+        const std::string& yLabel,
+        int nBins,
+        double xMin,
+        double xMax,
+        bool removeVectorDuplicates = false,
+        const std::string& weight = "",
+        double scale = 1.0);
+
+    /** Define the per-event fill weight (weight) * scale on node and return
+     *  its column name; weight may be a column or an expression. The column
+     *  is of type double: weight itself if it already is a double column and
+     *  scale is 1. Returns an empty string if there is nothing to weight. */
+    static std::string WeightColumn(ROOT::RDF::RNode& node,
+                                    const std::string& name,
+                                    const std::string& weight,
+                                    double scale = 1.0);
+
+    /** Draw a TH1 and write <basename>.png + .pdf into the current dir.
+     *  Profiles are drawn with errors, 2D histograms as COLZ. */
     static void SaveHist(TH1* h,
                          const std::string& basename,
                          const std::string& style = "default");
@@ -61,11 +95,62 @@ public:
                         bool logy = false,
                         const std::vector<double> weights = {});
 
+    /** bkgCovariance (optional): systematic covariance of the total
+     *  background, e.g. from UniverseHist::Covariance(); its diagonal is
+     *  added in quadrature to the statistical band. */
     static void FullDataMCSignalPlot(std::vector<TH1D>& hists,
                                       const std::vector<std::string>& labels,
                                       const std::string& basename,
                                       bool logy = false,
-                                      const std::vector<double> weights = {});
+                                      const std::vector<double> weights = {},
+                                      const TH2D* bkgCovariance = nullptr);
+
+    // ------------------------------------------------------------------
+    //  Histogram sink (sharded runs)
+    // ------------------------------------------------------------------
+
+    /** When set, the plot helpers write their (scaled) histograms into this
+     *  ROOT file, one directory per plot, instead of drawing. Shards are
+     *  summed by run_merge and drawn with RenderFromFile. Empty = draw. */
+    static void SetHistogramSink(const std::string& path);
+    static bool HistogramSinkActive() { return !fHistSink.empty(); }
+
+    /** Draw every plot stored in a histogram sink file. */
+    static void RenderFromFile(const std::string& path);
+
+    // ------------------------------------------------------------------
+    //  Histogram cache (restyling without event loops)
+    // ------------------------------------------------------------------
+
+    /** Persist filled histograms to this ROOT file. Empty = no cache. */
+    static void SetHistCache(const std::string& path);
+    static HistCache* Cache() { return fHistCache.get(); }
+
+    /** Render-only: modules draw from the cache and never read ntuples. */
+    static void SetRenderOnly(bool renderOnly) { fRenderOnly = renderOnly; }
+    static bool RenderOnly() { return fRenderOnly; }
+
+    // ------------------------------------------------------------------
+    //  Output formats and batch rendering
+    // ------------------------------------------------------------------
+
+    /** Extensions every plot is saved as (default png, pdf). */
+    static void SetOutputFormats(const std::vector<std::string>& formats);
+    static const std::vector<std::string>& OutputFormats() { return fFormats; }
+
+    /** workers > 0: the plot helpers only queue their plots, and
+     *  FlushRenderQueue draws them in that many forked batch-mode
+     *  processes. 0 (default) draws immediately. */
+    static void SetRenderWorkers(int workers) { fRenderWorkers = workers; }
+    static bool RenderDeferred() { return fRenderWorkers > 0; }
+
+    /** A line of text drawn at the top of every plot, e.g. for a preview run.
+     *  Empty (default) = none. */
+    static void SetAnnotation(const std::string& text) { fAnnotation = text; }
+
+    /** Draw all queued plots; throws if a worker failed. Call only while no
+     *  event loop is running (the ModuleManager does so after the modules). */
+    static void FlushRenderQueue();
 
 private:
     
@@ -75,6 +160,39 @@ private:
     // ----  internal helpers --------------------------------------
     static std::unique_ptr<TCanvas> MakeCanvas(const std::string& title);
     static void ApplyStyle(const std::string& style);
+    static void SaveCanvas(TCanvas& c, const std::string& basename);  ///< one file per format
+
+    // A plot call captured for deferred rendering
+    struct PlotSpec {
+        enum class Kind { Single, Stacked, FullDataMC };
+        Kind                     kind = Kind::Single;
+        std::unique_ptr<TH1>     single;   ///< SaveHist
+        std::vector<TH1D>        hists;
+        std::vector<std::string> labels;
+        std::string              basename;
+        std::string              style;
+        bool                     logy = false;
+        std::vector<double>      weights;
+        std::unique_ptr<TH2D>    cov;
+    };
+    static void Enqueue(PlotSpec spec);
+    static void Render(PlotSpec& spec);
+
+    // Write hists to <sink>:<basename>/<index>_<label>; the directory title records how to draw them
+    static void WriteToSink(std::vector<TH1D>& hists,
+                            const std::vector<std::string>& labels,
+                            const std::string& basename,
+                            const std::string& drawSpec,
+                            const std::vector<double>& weights);
+
+    static std::string fHistSink;      ///< empty unless histograms go to a file
+    static bool        fSinkCreated;   ///< sink recreated by this process yet?
+    static std::unique_ptr<HistCache> fHistCache;  ///< null unless a cache is set
+    static bool        fRenderOnly;    ///< draw from the cache only
+    static std::vector<std::string> fFormats;  ///< output file extensions
+    static int         fRenderWorkers; ///< > 0: queue plots for FlushRenderQueue
+    static std::vector<PlotSpec> fQueue;
+    static std::string fAnnotation;    ///< drawn on every canvas if set
 };
 
 } // namespace Analysis
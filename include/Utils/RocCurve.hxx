@@ -0,0 +1,36 @@
+#ifndef ANALYSIS_UTILS_ROCCURVE_HXX
+#define ANALYSIS_UTILS_ROCCURVE_HXX
+
+/*--------------------------------------------------------------------------*
+ *  Weighted ROC curve of a classifier score, from one sort of the scored
+ *  events: walking down the scores, the running signal and background
+ *  weights give one (effB, effS) point per distinct score. Tied scores are
+ *  one step, so the AUC (trapezoids) does not depend on the event order.
+ *--------------------------------------------------------------------------*/
+
+#include <cstddef>
+#include <vector>
+
+namespace Analysis {
+
+class RocCurve {
+public:
+    RocCurve(const std::vector<float>& score, const std::vector<double>& weight,
+             const std::vector<char>& isSignal);
+
+    // Area under effS(effB); 0.5 for a random score, 1 for a perfect one
+    double AUC() const { return fAUC; }
+
+    // Signal efficiency at background efficiency effB (1 - rejection), interpolated
+    double SignalEfficiencyAt(double effB) const;
+
+    const std::vector<double>& EffS() const { return fEffS; }
+    const std::vector<double>& EffB() const { return fEffB; }
+
+private:
+    std::vector<double> fEffS, fEffB;   ///< from (0, 0) to (1, 1)
+    double fAUC = 0.;
+};
+
+} // namespace Analysis
+#endif
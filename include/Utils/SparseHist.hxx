@@ -0,0 +1,123 @@
+#ifndef ANALYSIS_UTILS_SPARSEHIST_HXX
+#define ANALYSIS_UTILS_SPARSEHIST_HXX
+
+/*--------------------------------------------------------------------------*
+ *  1-3 dimensional histogram stored as a hash map of filled bins, for
+ *  binnings (migration matrices, score vs variable) with millions of mostly
+ *  empty bins. Memory scales with the number of filled bins.
+ *
+ *  Each slot fills its own map; Merge() folds them together at the end.
+ *  The result converts to a THnSparseD for writing and projections.
+ *--------------------------------------------------------------------------*/
+
+#include <ROOT/RDataFrame.hxx>
+#include <THnSparse.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Analysis {
+
+struct SparseAxis {
+    int    nBins = 1;
+    double min = 0., max = 1.;
+};
+
+class SparseHist {
+public:
+    SparseHist() = default;
+    SparseHist(const std::string& name, const std::string& title,
+               const std::vector<SparseAxis>& axes, unsigned nSlots = 1);
+
+    void Fill(unsigned slot, const double* x, double w = 1.0)
+    {
+        auto& c = fSlots[slot][GlobalBin(x)];
+        c.sumw  += w;
+        c.sumw2 += w * w;
+        ++fSlotEntries[slot];
+    }
+
+    // Fold the per-slot maps into slot 0
+    void Merge();
+
+    std::size_t NDim()        const { return fAxes.size(); }
+    std::size_t NFilledBins() const { return fSlots.empty() ? 0 : fSlots[0].size(); }
+
+    // Content, errors and entries as a THnSparseD (under/overflow included)
+    std::unique_ptr<THnSparseD> ToTHnSparse() const;
+
+private:
+    struct Content {
+        double sumw = 0., sumw2 = 0.;
+    };
+    using BinMap = std::unordered_map<std::uint64_t, Content>;
+
+    // Row-major index over (nBins + 2) bins per axis. As in TAxis::FindFixBin,
+    // NaN goes to the overflow bin, never through the int conversion.
+    std::uint64_t GlobalBin(const double* x) const
+    {
+        std::uint64_t idx = 0;
+        for (std::size_t d = 0; d < fAxes.size(); ++d) {
+            const auto& a = fAxes[d];
+            int b;
+            if (x[d] < a.min)          b = 0;
+            else if (!(x[d] < a.max))  b = a.nBins + 1;
+            else                       b = 1 + static_cast<int>(a.nBins * (x[d] - a.min) / (a.max - a.min));
+            idx = idx * static_cast<std::uint64_t>(a.nBins + 2) + static_cast<std::uint64_t>(b);
+        }
+        return idx;
+    }
+
+    std::string             fName, fTitle;
+    std::vector<SparseAxis> fAxes;
+    std::vector<BinMap>     fSlots;
+    std::vector<Long64_t>   fSlotEntries;
+};
+
+// ----------------------------------------------------------------------
+//  Lazy RDataFrame action filling a SparseHist of dimension D from D double
+//  columns, optionally followed by a double weight column.
+// ----------------------------------------------------------------------
+template <std::size_t D>
+class SparseFillHelper : public ROOT::Detail::RDF::RActionImpl<SparseFillHelper<D>> {
+public:
+    using Result_t = SparseHist;
+
+    SparseFillHelper(const std::string& name, const std::string& title,
+                     const std::vector<SparseAxis>& axes, unsigned nSlots)
+        : fResult(std::make_shared<SparseHist>(name, title, axes, nSlots)) {}
+    SparseFillHelper(SparseFillHelper&&) = default;
+    SparseFillHelper(const SparseFillHelper&) = delete;
+
+    std::shared_ptr<Result_t> GetResultPtr() const { return fResult; }
+    void Initialize() {}
+    void InitTask(TTreeReader*, unsigned int) {}
+
+    template <typename... Ts>
+    void Exec(unsigned int slot, Ts... values)
+    {
+        static_assert(sizeof...(Ts) == D || sizeof...(Ts) == D + 1, "D coordinates and an optional weight");
+        const double v[] = {static_cast<double>(values)...};
+        fResult->Fill(slot, v, sizeof...(Ts) > D ? v[D] : 1.0);
+    }
+
+    void Finalize() { fResult->Merge(); }
+    std::string GetActionName() { return "SparseFill"; }
+
+private:
+    std::shared_ptr<SparseHist> fResult;
+};
+
+// Book a sparse fill of the double columns cols (one per axis, then the
+// weight if cols has one more entry than axes). Lazy, like Histo2D.
+ROOT::RDF::RResultPtr<SparseHist> BookSparse(ROOT::RDF::RNode node,
+                                             const std::string& name,
+                                             const std::string& title,
+                                             const std::vector<SparseAxis>& axes,
+                                             const std::vector<std::string>& cols);
+
+} // namespace Analysis
+#endif
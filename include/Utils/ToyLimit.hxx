@@ -0,0 +1,62 @@
+#ifndef ANALYSIS_UTILS_TOYLIMIT_HXX
+#define ANALYSIS_UTILS_TOYLIMIT_HXX
+
+/*--------------------------------------------------------------------------*
+ *  CLs upper limits on a signal strength mu from toys, for a binned Poisson
+ *  likelihood L(mu) = prod_i Pois(n_i | mu s_i + b_i).
+ *
+ *  The test statistic is the one-sided profile likelihood ratio
+ *      q_mu = 2 [NLL(mu) - NLL(muhat)],  0 <= muhat <= mu,  else 0,
+ *  with muhat found by a safeguarded Newton iteration (NLL is convex in mu).
+ *
+ *  For one mu, ToyLimit::Toys() throws n toys under mu s + b and under b;
+ *  the sorted q values give the observed CLs and, from the quantiles of the
+ *  b-only q distribution, the expected CLs band. A toy set depends only on
+ *  its seed, so any set can be thrown on any thread.
+ *--------------------------------------------------------------------------*/
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Analysis {
+
+class ToyLimit {
+public:
+    // Expected band quantiles: -2, -1, 0, +1, +2 sigma of the limit
+    static constexpr std::array<double, 5> kBandQuantiles{0.975, 0.84, 0.5, 0.16, 0.025};
+
+    // s, b per bin; data may be empty (expected limits only).
+    // Background bins are floored at a small positive yield.
+    ToyLimit(std::vector<double> s, std::vector<double> b, std::vector<double> data = {});
+
+    double NLL(double mu, const double* n) const;
+    double MuHat(const double* n) const;
+    double QMu(double mu, const double* n) const;
+
+    bool   HasData()     const { return !fData.empty(); }
+    double TotalSignal() const;
+    double TotalBackground() const;
+
+    // Sorted q_mu of n toys each under mu s + b and under b, and q_mu of the data
+    struct ToySet {
+        double mu = 0., qObs = 0.;
+        std::vector<double> qSB, qB;
+    };
+    ToySet Toys(double mu, int nToys, std::uint64_t seed) const;
+
+    // CLs = P(q >= qRef | mu s + b) / P(q >= qRef | b)
+    static double CLs(const ToySet& t, double qRef);
+    static double ObservedCLs(const ToySet& t) { return CLs(t, t.qObs); }
+    // Expected CLs at band quantile k of kBandQuantiles
+    static double ExpectedCLs(const ToySet& t, std::size_t k);
+
+    // First mu where cls falls below alpha, interpolated; the last mu if none
+    static double Crossing(const std::vector<double>& mus, const std::vector<double>& cls, double alpha);
+
+private:
+    std::vector<double> fS, fB, fData;
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,54 @@
+#ifndef ANALYSIS_UTILS_TREESCAN_HXX
+#define ANALYSIS_UTILS_TREESCAN_HXX
+
+/*--------------------------------------------------------------------------*
+ *  Pass over a few columns of a tree that needs the tree entry number of
+ *  every value (sidecars, duplicate search). With implicit MT an RDataFrame
+ *  numbers entries (rdfentry_) in the order its tasks happen to run, so
+ *  these passes read the tree directly instead: the range is split into
+ *  runs of whole clusters, each scanned by one thread with its own TTree
+ *  and TTreeFormulas, which read only the branches the expressions use.
+ *--------------------------------------------------------------------------*/
+
+#include <Rtypes.h>
+#include <TTreeFormula.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Analysis {
+
+class TreeScan {
+public:
+    // The expressions evaluated for the current entry
+    struct Values {
+        std::vector<TTreeFormula*> formulas;
+        std::vector<int>           sizes;     ///< values per expression (0 for an empty vector)
+
+        double Get(std::size_t k, int i = 0) const { return formulas[k]->EvalInstance(i); }
+        int    Size(std::size_t k) const { return sizes[k]; }
+    };
+
+    // Callback with the task (run of clusters) and the tree entry number
+    using Callback = std::function<void(std::size_t task, Long64_t entry, const Values& values)>;
+
+    // Upper bound on the task numbers ForEach passes: 1 without implicit MT
+    static std::size_t MaxTasks();
+
+    // Runs of whole clusters covering [begin, end) of treeName in file, at most MaxTasks()
+    static std::vector<std::pair<Long64_t, Long64_t>> Tasks(const std::string& file, const std::string& treeName,
+                                                            Long64_t begin, Long64_t end);
+
+    // Evaluate exprs (TTree::Draw syntax) for every entry in [begin, end) of
+    // treeName in file, in entry order within a task. Tasks run concurrently
+    // with implicit MT, so fn must only touch state of its own task.
+    static void ForEach(const std::string& file, const std::string& treeName,
+                        const std::vector<std::string>& exprs, Long64_t begin, Long64_t end,
+                        const Callback& fn);
+};
+
+} // namespace Analysis
+#endif
@@ -0,0 +1,170 @@
+#ifndef ANALYSIS_UTILS_UNIVERSEHIST_HXX
+#define ANALYSIS_UTILS_UNIVERSEHIST_HXX
+
+/*--------------------------------------------------------------------------*
+ *  One variable filled in every systematic universe at once (flux, GENIE,
+ *  reinteraction, ...) from a per-event vector of weights.
+ *
+ *  While filling, each slot keeps a bin-major [bin][universe] buffer so the
+ *  per-event update is one contiguous multiply-add over the universes.
+ *  Merge() sums the slots and transposes into a single [universe][bin]
+ *  array, from which the covariance matrix and error band are computed.
+ *  An event without weights sits at its central value in every universe.
+ *  Bins include under- and overflow (nBins + 2 per universe).
+ *--------------------------------------------------------------------------*/
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RVec.hxx>
+#include <TH1D.h>
+#include <TH2D.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+class UniverseHist {
+public:
+    UniverseHist() = default;
+    UniverseHist(const std::string& name, int nBins, double xMin, double xMax, unsigned nSlots = 1);
+
+    // Fill one event: cvWeight * w[u] * scale goes into universe u, or
+    // cvWeight into every universe if the event has no weights (n == 0).
+    // The universe count is fixed by the first event that has weights.
+    template <typename T>
+    void Fill(unsigned slot, double x, double cvWeight, const T* w, std::size_t n, double scale = 1.0)
+    {
+        const int bin = FindBin(x);
+        fCV[slot][bin] += cvWeight;
+        if (n == 0) {
+            fNoWeights[slot][bin] += cvWeight;
+            return;
+        }
+        double* row = SlotRow(slot, bin, n);
+        const double cw = cvWeight * scale;
+        for (std::size_t u = 0; u < n; ++u) row[u] += cw * static_cast<double>(w[u]);
+    }
+
+    // Sum the per-slot buffers into the [universe][bin] result
+    void Merge();
+
+    // this += scale * other (same binning and universe count); e.g. to build
+    // the total background from the samples with their POT weights
+    void Add(const UniverseHist& other, double scale = 1.0);
+
+    std::size_t NUniverses() const { return fNUniverses; }
+    int         NBins()      const { return fNBins; }
+
+    // Content of universe u in bin b (0 = underflow, nBins + 1 = overflow)
+    double At(std::size_t u, int b) const { return fUniv[u * Stride() + b]; }
+
+    TH1D CentralValue() const;
+    TH1D Universe(std::size_t u) const;
+
+    // cov_ij = 1/N sum_u (n_u,i - cv_i)(n_u,j - cv_j), visible bins only
+    TH2D Covariance() const;
+
+    // Central value with sqrt(cov_ii) as the bin errors
+    TH1D ErrorBand() const;
+
+private:
+    std::size_t Stride() const { return static_cast<std::size_t>(fNBins) + 2; }
+    int FindBin(double x) const;
+    double* SlotRow(unsigned slot, int bin, std::size_t n);
+
+    std::string fName;
+    int         fNBins = 0;
+    double      fXMin = 0., fXMax = 1.;
+    std::size_t fNUniverses = 0;
+
+    std::vector<std::vector<double>> fCV;    ///< [slot][bin] central value
+    std::vector<std::vector<double>> fNoWeights; ///< [slot][bin] central value of events without weights
+    std::vector<std::vector<double>> fFill;  ///< [slot][bin][universe] fill buffers
+    std::vector<std::size_t>         fSlotNU;///< universes allocated per slot
+    std::vector<double>              fUniv;  ///< [universe][bin] after Merge()
+};
+
+// ----------------------------------------------------------------------
+//  Lazy RDataFrame action filling a UniverseHist, so any number of weight
+//  sets can be booked next to the ordinary histograms and filled in the
+//  same event loop:
+//
+//    auto genie = BookUniverses<unsigned short>(node, "genie", "logit_bdt",
+//                                               "weightsGenie", 11, -5., 6., 1e-3);
+//    ... book and run the ordinary histograms ...
+//    TH2D cov = genie->Covariance();
+// ----------------------------------------------------------------------
+template <typename W>
+class UniverseFillHelper : public ROOT::Detail::RDF::RActionImpl<UniverseFillHelper<W>> {
+public:
+    using Result_t = UniverseHist;
+
+    // scale converts stored weights to multiplicative factors (e.g. 1e-3 for
+    // the unsigned short GENIE/flux weights)
+    UniverseFillHelper(const std::string& name, int nBins, double xMin, double xMax,
+                       unsigned nSlots, double scale = 1.0)
+        : fResult(std::make_shared<UniverseHist>(name, nBins, xMin, xMax, nSlots))
+        , fScale(scale) {}
+    UniverseFillHelper(UniverseFillHelper&&) = default;
+    UniverseFillHelper(const UniverseFillHelper&) = delete;
+
+    std::shared_ptr<Result_t> GetResultPtr() const { return fResult; }
+    void Initialize() {}
+    void InitTask(TTreeReader*, unsigned int) {}
+
+    template <typename X>
+    void Exec(unsigned int slot, X x, const ROOT::VecOps::RVec<W>& w)
+    {
+        fResult->Fill(slot, static_cast<double>(x), 1.0, w.data(), w.size(), fScale);
+    }
+
+    // Variant with a per-event central-value weight column
+    template <typename X, typename CW>
+    void Exec(unsigned int slot, X x, CW cvWeight, const ROOT::VecOps::RVec<W>& w)
+    {
+        fResult->Fill(slot, static_cast<double>(x), static_cast<double>(cvWeight), w.data(), w.size(), fScale);
+    }
+
+    void Finalize() { fResult->Merge(); }
+    std::string GetActionName() { return "UniverseFill"; }
+
+private:
+    std::shared_ptr<UniverseHist> fResult;
+    double fScale;
+};
+
+// Book the universes of weight column wCol (element type W) against the
+// scalar column var (type X). Lazy, like Histo1D.
+template <typename W, typename X = float>
+ROOT::RDF::RResultPtr<UniverseHist> BookUniverses(ROOT::RDF::RNode node,
+                                                  const std::string& name,
+                                                  const std::string& var,
+                                                  const std::string& wCol,
+                                                  int nBins, double xMin, double xMax,
+                                                  double scale = 1.0)
+{
+    return node.Book<X, ROOT::VecOps::RVec<W>>(
+        UniverseFillHelper<W>(name, nBins, xMin, xMax, node.GetNSlots(), scale), {var, wCol});
+}
+
+// As above, with a per-event central-value weight (a double column, e.g.
+// from Plotter::WeightColumn) multiplying the nominal and every universe
+template <typename W, typename X = float>
+ROOT::RDF::RResultPtr<UniverseHist> BookUniverses(ROOT::RDF::RNode node,
+                                                  const std::string& name,
+                                                  const std::string& var,
+                                                  const std::string& cvWeightCol,
+                                                  const std::string& wCol,
+                                                  int nBins, double xMin, double xMax,
+                                                  double scale = 1.0)
+{
+    if (cvWeightCol.empty())
+        return BookUniverses<W, X>(node, name, var, wCol, nBins, xMin, xMax, scale);
+    return node.Book<X, double, ROOT::VecOps::RVec<W>>(
+        UniverseFillHelper<W>(name, nBins, xMin, xMax, node.GetNSlots(), scale), {var, cvWeightCol, wCol});
+}
+
+} // namespace Analysis
+#endif
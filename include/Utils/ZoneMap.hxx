@@ -0,0 +1,86 @@
+#ifndef ANALYSIS_UTILS_ZONEMAP_HXX
+#define ANALYSIS_UTILS_ZONEMAP_HXX
+
+/*--------------------------------------------------------------------------*
+ *  Per-cluster column statistics ("zone maps") of an ntuple.
+ *
+ *  For a configured set of branches every cluster of the tree records the
+ *  minimum, maximum and number of null values (NaN, or an empty vector).
+ *  They are kept in a small text sidecar next to the file (<file>.zonemap),
+ *  written by the Slimmer and Preselection when Global.ZoneMapColumns is set.
+ *
+ *  A reader with a conjunction of cuts first checks the simple terms
+ *  ("column < number", "number >= column", ...) against the statistics and
+ *  reads only the clusters where every term can hold (ReadPlan, in
+ *  Framework/Preview.hxx). Terms on other columns, on vector branches, and
+ *  cuts with "||" or parentheses are not used, which is always safe: the
+ *  cuts are still applied to every entry read.
+ *--------------------------------------------------------------------------*/
+
+#include <Rtypes.h>
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Analysis {
+
+class ZoneMap {
+public:
+    struct Stats {
+        double   min = 0., max = 0.;   ///< over the non-null values
+        Long64_t nNull = 0;
+    };
+    struct Cluster {
+        Long64_t begin = 0, end = 0;
+        std::vector<Stats> stats;      ///< one per column
+    };
+
+    // column op value, e.g. NeutrinoEnergy2 < 500
+    struct Term {
+        enum class Op { Less, LessEqual, Greater, GreaterEqual, Equal };
+        std::string column;
+        Op          op = Op::Less;
+        double      value = 0.;
+    };
+
+    static std::string SidecarPath(const std::string& file) { return file + ".zonemap"; }
+
+    static ZoneMap Build(const std::string& file, const std::string& treeName,
+                         const std::vector<std::string>& columns);
+    static void WriteSidecar(const std::string& file, const std::string& treeName,
+                             const std::vector<std::string>& columns);
+
+    void Write(const std::string& path) const;
+    static ZoneMap Read(const std::string& path);
+
+    // The sidecar of file, if there is one for treeName that is not older than file
+    static std::optional<ZoneMap> Load(const std::string& file, const std::string& treeName);
+
+    // The terms of cuts (all of which must pass) usable against zone maps
+    static std::vector<Term> ParseCuts(const std::vector<std::string>& cuts);
+
+    // Entry ranges within [first, last) of the clusters where every term can hold
+    std::vector<std::pair<Long64_t, Long64_t>> Candidates(const std::vector<Term>& terms,
+                                                          Long64_t first, Long64_t last) const;
+
+    // Remove from ranges (entries of treeName in file, of nEntries in total)
+    // the clusters where some term cannot hold, if file has an up-to-date
+    // zone map. Returns the number of entries removed.
+    static Long64_t Narrow(const std::string& file, const std::string& treeName, Long64_t nEntries,
+                           const std::vector<Term>& terms, std::vector<std::pair<Long64_t, Long64_t>>& ranges);
+
+    const std::vector<std::string>& Columns()  const { return fColumns; }
+    const std::vector<Cluster>&     Clusters() const { return fClusters; }
+
+private:
+    std::string              fTreeName;
+    Long64_t                 fEntries = 0;
+    std::vector<std::string> fColumns;
+    std::vector<bool>        fIsVector;   ///< statistics over the elements; not used for skipping
+    std::vector<Cluster>     fClusters;
+};
+
+} // namespace Analysis
+#endif
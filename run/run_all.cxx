@@ -2,6 +2,7 @@
 #include <vector>
 #include "Framework/Module.hxx"
 #include "Framework/ModuleManager.hxx"
+#include "Framework/RunOptions.hxx"
 #include "Modules/SlimmerModule.hxx"
 #include "Modules/PreselectionModule.hxx"
 #include "Modules/BDTTrainModule.hxx"
@@ -11,11 +12,9 @@
 
 int main(int argc, char* argv[])
 {
-    if (argc!=2) {
-        std::cerr << "Usage: run_all <config.cfg>\n";
-        return 1;
-    }
-    TEnv cfg(argv[1]);
+    auto cfgPtr = Analysis::RunOptions::LoadConfig(argc, argv, "run_all");
+    if (!cfgPtr) return 1;
+    const TEnv& cfg = *cfgPtr;
     
     // Build the vector explicitly (was having problems before)
 
@@ -0,0 +1,571 @@
+/*--------------------------------------------------------------------------*
+ *  Micro-benchmark for the per-event kernels (Utils/Kernels.hxx), the cut
+ *  expressions and the BDT scoring, driven over synthetic in-memory RVec
+ *  columns. Reports ns/event for each kernel and the throughput scaling of
+ *  the RDataFrame versions over a list of thread counts. Optionally draws
+ *  many plots and tracks resident memory (Benchmark.PlotStress), and runs
+ *  consistency checks on small generated files (Benchmark.Checks).
+ *--------------------------------------------------------------------------*/
+#include "Utils/Kernels.hxx"
+#include "Utils/Plotter.hxx"
+#include "Utils/ZoneMap.hxx"
+#include "Utils/EventIndex.hxx"
+#include "Utils/EventFilter.hxx"
+#include "Utils/UniverseHist.hxx"
+#include "Framework/Preview.hxx"
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RVec.hxx>
+#include <TEnv.h>
+#include <TROOT.h>
+#include <TSystem.h>
+#include <TMVA/Reader.h>
+#include <TH1D.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Analysis;
+using RVecF = Kernels::RVecF;
+
+namespace {
+
+//------------------------------------------------------------------------------
+// Jagged column stored as flat values + offsets, exposed as non-owning RVecs
+struct JaggedColumn {
+    std::vector<float>     values;
+    std::vector<ULong64_t> offsets{0};
+
+    RVecF View(ULong64_t evt) const
+    {
+        const auto begin = offsets[evt];
+        const auto size  = offsets[evt + 1] - begin;
+        // RVec adopting external memory: no copy, no allocation
+        return size == 0 ? RVecF() : RVecF(const_cast<float*>(values.data() + begin), size);
+    }
+};
+
+struct SyntheticData {
+    ULong64_t nEvents = 0;
+    std::vector<JaggedColumn> jagged;      // trk_sce_{start,end}_{x,y,z}_v, shr_phi_v
+    std::vector<std::vector<float>> scalars; // one per scalar branch name
+};
+
+const std::vector<std::string> kJaggedNames = {
+    "trk_sce_start_x_v", "trk_sce_end_x_v",
+    "trk_sce_start_y_v", "trk_sce_end_y_v",
+    "trk_sce_start_z_v", "trk_sce_end_z_v",
+    "shr_phi_v"};
+
+const std::vector<std::string> kScalarNames = {
+    "nslice", "flash_time", "nu_flashmatch_score", "NeutrinoEnergy2",
+    "contained_fraction", "crtveto", "bdt_score"};
+
+std::vector<std::string> SplitWs(const std::string& raw)
+{
+    std::vector<std::string> out;
+    std::stringstream ss(raw);
+    std::string tok;
+    while (ss >> tok) {
+        if (!tok.empty() && tok.back()==',') tok.pop_back();
+        if (!tok.empty()) out.push_back(tok);
+    }
+    return out;
+}
+
+// Same parsing as PreselectionModule: comma-separated, optional quotes
+std::vector<std::string> SplitCuts(const std::string& raw)
+{
+    std::vector<std::string> out;
+    std::stringstream ss(raw);
+    std::string tok;
+    while (std::getline(ss, tok, ',')) {
+        tok.erase(0, tok.find_first_not_of(" \t\n\r"));
+        tok.erase(tok.find_last_not_of(" \t\n\r") + 1);
+        if (tok.size() >= 2 &&
+           ((tok.front() == '"'  && tok.back() == '"') ||
+            (tok.front() == '\'' && tok.back() == '\'')))
+            tok = tok.substr(1, tok.size() - 2);
+        if (!tok.empty()) out.push_back(tok);
+    }
+    return out;
+}
+
+//------------------------------------------------------------------------------
+// Multiplicity is Poisson(mean) for non-empty events, plus a fraction of
+// events with all vectors empty (ext-like, no neutrino slice).
+SyntheticData MakeData(ULong64_t nEvents, double meanMult, double emptyFrac, unsigned seed)
+{
+    SyntheticData d;
+    d.nEvents = nEvents;
+    d.jagged.resize(kJaggedNames.size());
+    d.scalars.assign(kScalarNames.size(), std::vector<float>(nEvents));
+
+    std::mt19937_64 rng(seed);
+    std::poisson_distribution<int>        mult(meanMult);
+    std::bernoulli_distribution           empty(emptyFrac);
+    std::uniform_real_distribution<float> pos(-50.f, 1050.f);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    for (auto& col : d.jagged) {
+        col.values.reserve(static_cast<std::size_t>(nEvents * meanMult));
+        col.offsets.reserve(nEvents + 1);
+    }
+
+    for (ULong64_t e = 0; e < nEvents; ++e) {
+        const int n = empty(rng) ? 0 : mult(rng);
+        for (auto& col : d.jagged) {
+            for (int k = 0; k < n; ++k) col.values.push_back(pos(rng));
+            col.offsets.push_back(col.values.size());
+        }
+        d.scalars[0][e] = n > 0 ? 1.f : 0.f;          // nslice
+        d.scalars[1][e] = 20.f * unit(rng);           // flash_time
+        d.scalars[2][e] = 30.f * unit(rng);           // nu_flashmatch_score
+        d.scalars[3][e] = 1000.f * unit(rng);         // NeutrinoEnergy2
+        d.scalars[4][e] = unit(rng);                  // contained_fraction
+        d.scalars[5][e] = unit(rng) < 0.1f ? 1.f : 0.f; // crtveto
+        d.scalars[6][e] = unit(rng);                  // bdt_score
+    }
+    return d;
+}
+
+//------------------------------------------------------------------------------
+// Time fn() over nEvents and return ns/event (best of nRepeat)
+double TimeNsPerEvent(ULong64_t nEvents, int nRepeat, const std::function<double()>& fn)
+{
+    double best = 1e300;
+    volatile double sink = 0;
+    for (int r = 0; r < nRepeat; ++r) {
+        const auto t0 = std::chrono::steady_clock::now();
+        sink = sink + fn();
+        const auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+    return best / static_cast<double>(nEvents);
+}
+
+void PrintRow(const std::string& name, double nsPerEvt)
+{
+    std::cout << "  " << std::left << std::setw(34) << name
+              << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+              << nsPerEvt << " ns/evt  "
+              << std::setw(10) << std::setprecision(1) << 1e3 / nsPerEvt << " Mevt/s\n";
+}
+
+//------------------------------------------------------------------------------
+// Define the synthetic columns on an empty-source RDataFrame, as views onto the in-memory data
+ROOT::RDF::RNode AddColumns(ROOT::RDataFrame& df, const SyntheticData& d)
+{
+    ROOT::RDF::RNode node = df;
+    for (std::size_t c = 0; c < kJaggedNames.size(); ++c) {
+        const JaggedColumn* col = &d.jagged[c];
+        node = node.Define(kJaggedNames[c], [col](ULong64_t e) { return col->View(e); }, {"rdfentry_"});
+    }
+    for (std::size_t c = 0; c < kScalarNames.size(); ++c) {
+        const std::vector<float>* col = &d.scalars[c];
+        node = node.Define(kScalarNames[c], [col](ULong64_t e) { return (*col)[e]; }, {"rdfentry_"});
+    }
+    return node;
+}
+
+//------------------------------------------------------------------------------
+// Zone maps built with implicit MT on must describe the tree's own clusters:
+// a read plan for a cut keeps every entry passing it.
+bool CheckZoneMapReadPlan(const std::string& dir, unsigned nThreads)
+{
+    const std::string file = dir + "/check_zonemap.root";
+    {
+        TFile f(file.c_str(), "RECREATE");
+        TTree t("tree", "zone map check");
+        t.SetAutoFlush(1000);   // many small clusters
+        float x = 0.f;
+        t.Branch("x", &x);
+        // Rising with the entry number, so every cluster covers a narrow range
+        for (int i = 0; i < 200000; ++i) {
+            x = 0.01f * i + 1e-4f * ((i * 7919) % 100);
+            t.Fill();
+        }
+        t.Write();
+    }
+
+    if (ROOT::IsImplicitMTEnabled()) ROOT::DisableImplicitMT();
+    ROOT::EnableImplicitMT(nThreads);
+    ZoneMap::WriteSidecar(file, "tree", {"x"});
+
+    const std::string cut = "x > 420 && x < 433.5";
+    const auto expected = ROOT::RDataFrame("tree", file).Filter(cut).Count().GetValue();
+
+    std::unique_ptr<TFile> f{TFile::Open(file.c_str(), "READ")};
+    auto* tree = f->Get<TTree>("tree");
+    const ReadPlan plan = ReadPlan::Apply(*tree, file, "tree", ShardSpec(), PreviewSpec(),
+                                          ZoneMap::ParseCuts({cut}));
+    const auto kept = ROOT::RDataFrame(*tree).Filter(cut).Count().GetValue();
+    ROOT::DisableImplicitMT();
+
+    const bool ok = plan.zoneSkipped > 0 && kept == expected;
+    std::cout << "  " << (ok ? "ok  " : "FAIL") << " zone map under " << nThreads << " threads: "
+              << kept << " of " << expected << " passing entries kept, "
+              << plan.zoneSkipped << " entries skipped\n";
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// An event index built with implicit MT on must point every key at the tree
+// entry it was read from.
+bool CheckEventIndexEntries(const std::string& dir, unsigned nThreads)
+{
+    const std::string file = dir + "/check_evtidx.root";
+    const Long64_t nEntries = 100000;
+    {
+        TFile f(file.c_str(), "RECREATE");
+        TTree t("tree", "event index check");
+        t.SetAutoFlush(1000);
+        unsigned int run = 1, sub = 0, evt = 0;
+        t.Branch("run", &run);
+        t.Branch("sub", &sub);
+        t.Branch("evt", &evt);
+        for (Long64_t i = 0; i < nEntries; ++i) {
+            sub = static_cast<unsigned int>(i / 100);
+            evt = static_cast<unsigned int>(i);
+            t.Fill();
+        }
+        t.Write();
+    }
+
+    if (ROOT::IsImplicitMTEnabled()) ROOT::DisableImplicitMT();
+    ROOT::EnableImplicitMT(nThreads);
+    const EventIndex idx = EventIndex::Build({file}, "tree");
+    ROOT::DisableImplicitMT();
+
+    Long64_t wrong = 0, found = 0;
+    for (const auto& key : idx.Keys())
+        for (const auto& loc : idx.Find(key)) {
+            ++found;
+            if (loc.entry != static_cast<long long>(key.evt)) ++wrong;
+        }
+
+    const bool ok = found == nEntries && wrong == 0;
+    std::cout << "  " << (ok ? "ok  " : "FAIL") << " event index under " << nThreads << " threads: "
+              << found << " records, " << wrong << " pointing at the wrong entry\n";
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// With implicit MT on, duplicate removal must keep every key exactly once,
+// whether the tree is read in one loop or in two halves (shards, chunks).
+bool CheckDuplicateFilter(const std::string& dir, unsigned nThreads)
+{
+    const std::string file = dir + "/check_duplicates.root";
+    const Long64_t nEntries = 100000;
+    std::set<std::uint32_t> distinct;
+    {
+        TFile f(file.c_str(), "RECREATE");
+        TTree t("tree", "duplicate filter check");
+        t.SetAutoFlush(1000);
+        unsigned int run = 1, sub = 0, evt = 0;
+        t.Branch("run", &run);
+        t.Branch("sub", &sub);
+        t.Branch("evt", &evt);
+        for (Long64_t i = 0; i < nEntries; ++i) {
+            // Every 7th entry repeats one from far back, often in the other half
+            evt = static_cast<unsigned int>(i % 7 == 0 ? (i * 31) % (i + 1) : i);
+            distinct.insert(evt);
+            t.Fill();
+        }
+        t.Write();
+    }
+
+    if (ROOT::IsImplicitMTEnabled()) ROOT::DisableImplicitMT();
+    ROOT::EnableImplicitMT(nThreads);
+    const auto filter = DuplicateFilter::Scan(file, "tree", {"run", "sub", "evt"}, 64);
+
+    auto keptIn = [&](Long64_t first, Long64_t last) {
+        auto pass = std::make_shared<DuplicateFilter::Pass>(filter, first, last);
+        ROOT::RDataFrame df("tree", file);
+        return df.Filter([pass](unsigned int run, unsigned int sub, unsigned int evt) {
+                             return pass->Keep(run, sub, evt); }, {"run", "sub", "evt"})
+                 .Count().GetValue();
+    };
+    const auto whole = keptIn(0, nEntries);
+    // Each half reads the whole tree here; only the range decides
+    const auto halves = keptIn(0, nEntries / 2) + keptIn(nEntries / 2, nEntries);
+    ROOT::DisableImplicitMT();
+
+    const bool ok = whole == distinct.size() && halves == distinct.size()
+                 && filter.NDuplicates() == nEntries - distinct.size();
+    std::cout << "  " << (ok ? "ok  " : "FAIL") << " duplicate filter under " << nThreads << " threads: "
+              << distinct.size() << " keys, kept " << whole << " in one loop and " << halves << " in two\n";
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// Universes filled from weights averaging one, with some events carrying no
+// weights at all, must average to the central value in every bin.
+bool CheckUniverseNoWeights()
+{
+    const std::size_t nUniv = 4;
+    UniverseHist h("check_univ", 4, 0., 4., 2);
+    const std::vector<double> unit(nUniv, 1.), spread{0.5, 0.9, 1.1, 1.5};
+    h.Fill(0, 0.5, 1.0, unit.data(), unit.size());
+    h.Fill(1, 0.5, 0.5, unit.data(), 0);            // no weights, next to weighted events
+    h.Fill(1, 1.5, 2.0, unit.data(), 0);            // no weights, alone in its bin
+    h.Fill(0, 2.5, 1.0, spread.data(), spread.size());
+    h.Fill(1, 2.5, 3.0, unit.data(), 0);
+    h.Merge();
+
+    const TH1D cv = h.CentralValue();
+    double worst = 0.;
+    for (int b = 0; b <= h.NBins() + 1; ++b) {
+        double mean = 0.;
+        for (std::size_t u = 0; u < h.NUniverses(); ++u) mean += h.At(u, b) / h.NUniverses();
+        worst = std::max(worst, std::abs(mean - cv.GetBinContent(b)));
+    }
+
+    const bool ok = h.NUniverses() == nUniv && worst < 1e-12;
+    std::cout << "  " << (ok ? "ok  " : "FAIL") << " universes with unweighted events: largest bias "
+              << worst << "\n";
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc!=2) {
+        std::cerr << "Usage: run_benchmark <config.cfg>\n";
+        return 1;
+    }
+    TEnv cfg(argv[1]);
+
+    const ULong64_t nEvents  = static_cast<ULong64_t>(cfg.GetValue("Benchmark.NEvents", 1000000));
+    const double meanMult    = cfg.GetValue("Benchmark.MeanMultiplicity", 3.0);
+    const double emptyFrac   = cfg.GetValue("Benchmark.EmptyFraction", 0.1);
+    const int    nRepeat     = cfg.GetValue("Benchmark.Repeat", 3);
+    const unsigned seed      = static_cast<unsigned>(cfg.GetValue("Benchmark.Seed", 12345));
+
+    std::vector<unsigned> threads;
+    for (const auto& t : SplitWs(cfg.GetValue("Benchmark.Threads", "1 2 4 8")))
+        threads.push_back(static_cast<unsigned>(std::stoul(t)));
+
+    // Cut expressions default to the preselection cuts if present in the config
+    std::string cutString = cfg.GetValue("Benchmark.Cuts", "");
+    if (cutString.empty()) cutString = cfg.GetValue("Preselection.Cuts",
+        "nslice == 1,flash_time > 6.5,flash_time < 16.5,nu_flashmatch_score < 15,"
+        "NeutrinoEnergy2 < 500,contained_fraction > 0.9,crtveto == 0");
+    const auto cuts = SplitCuts(cutString);
+
+    std::cout << "[Benchmark] Generating " << nEvents << " events, mean multiplicity "
+              << meanMult << ", empty fraction " << emptyFrac << "\n";
+    const SyntheticData d = MakeData(nEvents, meanMult, emptyFrac, seed);
+
+    //----------------------------------------------------------------------
+    // 1.  Bare kernels over the in-memory columns (single thread)
+    //----------------------------------------------------------------------
+    std::cout << "\n[Benchmark] Bare kernels (1 thread, best of " << nRepeat << ")\n";
+
+    PrintRow("Slimmer MinOfPair", TimeNsPerEvent(nEvents, nRepeat, [&] {
+        double s = 0;
+        for (ULong64_t e = 0; e < nEvents; ++e) s += Kernels::MinOfPair(d.jagged[0].View(e), d.jagged[1].View(e));
+        return s;
+    }));
+    PrintRow("Slimmer MaxOfPair", TimeNsPerEvent(nEvents, nRepeat, [&] {
+        double s = 0;
+        for (ULong64_t e = 0; e < nEvents; ++e) s += Kernels::MaxOfPair(d.jagged[0].View(e), d.jagged[1].View(e));
+        return s;
+    }));
+    PrintRow("Plotter FirstOrDefault (_first)", TimeNsPerEvent(nEvents, nRepeat, [&] {
+        double s = 0;
+        for (ULong64_t e = 0; e < nEvents; ++e) s += Kernels::FirstOrDefault(d.jagged[6].View(e));
+        return s;
+    }));
+    PrintRow("PlotBook ReduceMax", TimeNsPerEvent(nEvents, nRepeat, [&] {
+        double s = 0;
+        for (ULong64_t e = 0; e < nEvents; ++e) s += Kernels::ReduceMax(d.jagged[6].View(e), nullptr);
+        return s;
+    }));
+    PrintRow("PlotBook ReduceSum", TimeNsPerEvent(nEvents, nRepeat, [&] {
+        double s = 0;
+        for (ULong64_t e = 0; e < nEvents; ++e) s += Kernels::ReduceSum(d.jagged[6].View(e), nullptr);
+        return s;
+    }));
+    PrintRow("PlotBook LeadingBy", TimeNsPerEvent(nEvents, nRepeat, [&] {
+        double s = 0;
+        for (ULong64_t e = 0; e < nEvents; ++e) s += Kernels::LeadingBy(d.jagged[0].View(e), d.jagged[1].View(e));
+        return s;
+    }));
+    PrintRow("PlotterModule Logit", TimeNsPerEvent(nEvents, nRepeat, [&] {
+        double s = 0;
+        for (ULong64_t e = 0; e < nEvents; ++e) s += Kernels::Logit(d.scalars[6][e]);
+        return s;
+    }));
+
+    //----------------------------------------------------------------------
+    // 2.  BDT scoring, if a weights file is given
+    //----------------------------------------------------------------------
+    const std::string weightsXML = cfg.GetValue("Benchmark.WeightsXML", "");
+    if (!weightsXML.empty() && !gSystem->AccessPathName(weightsXML.c_str())) {
+        const std::string method = cfg.GetValue("Benchmark.MethodName", "BDTG");
+        const auto evalVars = SplitWs(cfg.GetValue("BDTEvalModule.EvalVars", ""));
+
+        TMVA::Reader reader("!Color:Silent");
+        std::vector<float> varBuf(evalVars.size(), 0.f);
+        for (std::size_t i = 0; i < evalVars.size(); ++i)
+            reader.AddVariable(evalVars[i].c_str(), &varBuf[i]);
+        reader.BookMVA(method.c_str(), weightsXML.c_str());
+
+        const ULong64_t nScore = std::min<ULong64_t>(nEvents, 100000);
+        PrintRow("BDT EvaluateMVA (" + method + ")", TimeNsPerEvent(nScore, nRepeat, [&] {
+            double s = 0;
+            for (ULong64_t e = 0; e < nScore; ++e) {
+                for (std::size_t j = 0; j < varBuf.size(); ++j)
+                    varBuf[j] = d.scalars[j % d.scalars.size()][e];
+                s += reader.EvaluateMVA(method.c_str());
+            }
+            return s;
+        }));
+    }
+    else {
+        std::cout << "  (BDT scoring skipped: set Benchmark.WeightsXML to a TMVA weights file)\n";
+    }
+
+    //----------------------------------------------------------------------
+    // 3.  RDataFrame Define/Filter kernels across thread counts
+    //----------------------------------------------------------------------
+    using Job = std::function<double(ROOT::RDF::RNode)>;
+    const std::vector<std::pair<std::string, Job>> rdfJobs = {
+        {"RDF columns only (baseline)", [](ROOT::RDF::RNode n) {
+            return n.Sum<float>("bdt_score").GetValue(); }},
+        {"RDF Slimmer min/max x,y,z", [](ROOT::RDF::RNode n) {
+            return n.Define("min_x", Kernels::MinOfPair, {"trk_sce_start_x_v", "trk_sce_end_x_v"})
+                    .Define("max_x", Kernels::MaxOfPair, {"trk_sce_start_x_v", "trk_sce_end_x_v"})
+                    .Define("min_y", Kernels::MinOfPair, {"trk_sce_start_y_v", "trk_sce_end_y_v"})
+                    .Define("max_y", Kernels::MaxOfPair, {"trk_sce_start_y_v", "trk_sce_end_y_v"})
+                    .Define("min_z", Kernels::MinOfPair, {"trk_sce_start_z_v", "trk_sce_end_z_v"})
+                    .Define("max_z", Kernels::MaxOfPair, {"trk_sce_start_z_v", "trk_sce_end_z_v"})
+                    .Define("sum", [](float a, float b, float c, float x, float y, float z) {
+                        return double(a) + b + c + x + y + z; },
+                        {"min_x", "max_x", "min_y", "max_y", "min_z", "max_z"})
+                    .Sum<double>("sum").GetValue(); }},
+        {"RDF _first + Histo1D", [](ROOT::RDF::RNode n) {
+            return n.Define("shr_phi_v_first", [](const RVecF& v) { return Kernels::FirstOrDefault(v); }, {"shr_phi_v"})
+                    .Histo1D({"h_first", "", 20, -3.14, 3.14}, "shr_phi_v_first")->GetMean(); }},
+        {"RDF logit_bdt + Histo1D", [](ROOT::RDF::RNode n) {
+            return n.Define("logit_bdt", Kernels::Logit, {"bdt_score"})
+                    .Histo1D({"h_logit", "", 11, -5.0, 6.0}, "logit_bdt")->GetMean(); }},
+        {"RDF cut chain (jitted)", [&cuts](ROOT::RDF::RNode n) {
+            for (const auto& c : cuts) n = n.Filter(c);
+            return static_cast<double>(n.Count().GetValue()); }},
+    };
+
+    std::cout << "\n[Benchmark] RDataFrame kernels (wall time, best of " << nRepeat << ")\n";
+    std::vector<std::vector<double>> nsTable(rdfJobs.size());
+
+    for (const unsigned nThreads : threads) {
+        if (ROOT::IsImplicitMTEnabled()) ROOT::DisableImplicitMT();
+        if (nThreads > 1) ROOT::EnableImplicitMT(nThreads);
+
+        std::cout << "\n  -- " << nThreads << " thread(s) --\n";
+        for (std::size_t j = 0; j < rdfJobs.size(); ++j) {
+            const double ns = TimeNsPerEvent(nEvents, nRepeat, [&] {
+                ROOT::RDataFrame df(nEvents);
+                return rdfJobs[j].second(AddColumns(df, d));
+            });
+            nsTable[j].push_back(ns);
+            PrintRow(rdfJobs[j].first, ns);
+        }
+    }
+    if (ROOT::IsImplicitMTEnabled()) ROOT::DisableImplicitMT();
+
+    //----------------------------------------------------------------------
+    // 4.  Scaling summary relative to the first thread count
+    //----------------------------------------------------------------------
+    std::cout << "\n[Benchmark] Throughput scaling (speed-up vs " << threads.front() << " thread(s))\n";
+    std::cout << "  " << std::left << std::setw(34) << "kernel";
+    for (const unsigned t : threads) std::cout << std::right << std::setw(8) << (std::to_string(t) + "T");
+    std::cout << "\n";
+    for (std::size_t j = 0; j < rdfJobs.size(); ++j) {
+        std::cout << "  " << std::left << std::setw(34) << rdfJobs[j].first;
+        for (const double ns : nsTable[j])
+            std::cout << std::right << std::setw(8) << std::fixed << std::setprecision(2) << nsTable[j][0] / ns;
+        std::cout << "\n";
+    }
+
+    //----------------------------------------------------------------------
+    // 5.  Plot stress: resident memory must stay flat over many plots
+    //----------------------------------------------------------------------
+    const int nPlots = cfg.GetValue("Benchmark.PlotStress", 0);
+    if (nPlots > 0) {
+        const std::string plotDir = cfg.GetValue("Benchmark.PlotDir", "plot_stress");
+        gSystem->mkdir(plotDir.c_str(), kTRUE);
+        gROOT->SetBatch(kTRUE);
+        Plotter::SetOutputFormats(SplitWs(cfg.GetValue("Benchmark.PlotFormats", "png")));
+
+        // Template histograms, copied per plot since the plot helpers restyle them
+        const std::vector<std::string> labels = {"beamoff", "overlay", "dirt", "signal", "data"};
+        std::vector<TH1D> templ;
+        std::mt19937 rng(seed);
+        std::normal_distribution<double> gaus(0.5, 2.0);
+        for (const auto& l : labels) {
+            templ.emplace_back(("stress_" + l).c_str(), ";Logit BDT Score;Count", 11, -5.0, 6.0);
+            templ.back().SetDirectory(nullptr);
+            for (int k = 0; k < 2000; ++k) templ.back().Fill(gaus(rng));
+        }
+
+        auto residentKB = [] {
+            ProcInfo_t info;
+            gSystem->GetProcInfo(&info);
+            return info.fMemResident;
+        };
+
+        std::cout << "\n[Benchmark] Plot stress: " << nPlots << " FullDataMCSignalPlot calls into " << plotDir << "\n";
+        const int report = std::max(1, nPlots / 10);
+        Long_t rssWarm = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int p = 0; p < nPlots; ++p) {
+            std::vector<TH1D> hists = templ;
+            // A bounded set of file names, the objects are what is being measured
+            Plotter::FullDataMCSignalPlot(hists, labels, plotDir + "/stress_" + std::to_string(p % 100));
+            if (p == std::min(nPlots - 1, 99)) rssWarm = residentKB();
+            if ((p + 1) % report == 0)
+                std::cout << "  plots " << std::setw(6) << p + 1 << "  RSS " << residentKB() / 1024 << " MB\n";
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        const Long_t rssEnd = residentKB();
+        std::cout << "  " << std::fixed << std::setprecision(2) << ms / nPlots << " ms/plot, RSS growth after warm-up: "
+                  << (rssEnd - rssWarm) / 1024.0 << " MB ("
+                  << (nPlots > 100 ? (rssEnd - rssWarm) / double(nPlots - 100) : 0.0) << " kB/plot)\n";
+    }
+
+    //----------------------------------------------------------------------
+    // 6.  Consistency checks on small generated files
+    //----------------------------------------------------------------------
+    if (cfg.GetValue("Benchmark.Checks", 0) != 0) {
+        const std::string checkDir = cfg.GetValue("Benchmark.CheckDir", "benchmark_checks");
+        gSystem->mkdir(checkDir.c_str(), kTRUE);
+        const unsigned nThreads = std::max(2u, threads.back());
+
+        std::cout << "\n[Benchmark] Consistency checks in " << checkDir << "\n";
+        int failed = 0;
+        if (!CheckZoneMapReadPlan(checkDir, nThreads)) ++failed;
+        if (!CheckEventIndexEntries(checkDir, nThreads)) ++failed;
+        if (!CheckDuplicateFilter(checkDir, nThreads)) ++failed;
+        if (!CheckUniverseNoWeights()) ++failed;
+        if (failed) {
+            std::cerr << "[Benchmark] " << failed << " check(s) failed\n";
+            return 1;
+        }
+    }
+    return 0;
+}
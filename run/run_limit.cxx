@@ -0,0 +1,22 @@
+#include <memory>
+#include <vector>
+#include "Framework/Module.hxx"
+#include "Framework/ModuleManager.hxx"
+#include "Framework/RunOptions.hxx"
+#include "Modules/LimitModule.hxx"
+#include <TEnv.h>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    auto cfgPtr = Analysis::RunOptions::LoadConfig(argc, argv, "run_limit");
+    if (!cfgPtr) return 1;
+    const TEnv& cfg = *cfgPtr;
+
+    std::vector<std::unique_ptr<Analysis::Module>> modules;
+    modules.emplace_back(std::make_unique<Analysis::LimitModule>(cfg));
+
+    Analysis::ModuleManager mgr(std::move(modules));
+    mgr.Run();
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include <memory>
+#include <vector>
+#include "Framework/Module.hxx"
+#include "Framework/ModuleManager.hxx"
+#include "Framework/RunOptions.hxx"
+#include "Modules/MergeModule.hxx"
+#include "Modules/SlimmerModule.hxx"
+#include "Modules/PreselectionModule.hxx"
+#include "Modules/BDTEvalModule.hxx"
+#include <TEnv.h>
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    auto cfgPtr = Analysis::RunOptions::LoadConfig(argc, argv, "run_merge");
+    if (!cfgPtr) return 1;
+    TEnv& cfg = *cfgPtr;
+
+    // Unless given explicitly, merge the outputs of every module configured in
+    // this file. The modules are only asked for their (unsharded) output names.
+    if (!cfg.Defined("Merge.Targets")) {
+        std::vector<std::unique_ptr<Analysis::Module>> producers;
+        if (cfg.Defined("Slimmer.OutputFiles"))
+            producers.emplace_back(std::make_unique<Analysis::SlimmerModule>(cfg));
+        if (cfg.Defined("Preselection.Outputs"))
+            producers.emplace_back(std::make_unique<Analysis::PreselectionModule>(cfg));
+        if (cfg.Defined("BDTEvalModule.InputFiles"))
+            producers.emplace_back(std::make_unique<Analysis::BDTEvalModule>(cfg));
+
+        std::string targets;
+        for (const auto& m : producers)
+            for (const auto& out : m->Outputs()) targets += out + " ";
+        cfg.SetValue("Merge.Targets", targets.c_str());
+    }
+
+    std::vector<std::unique_ptr<Analysis::Module>> modules;
+    modules.emplace_back(std::make_unique<Analysis::MergeModule>(cfg));
+
+    Analysis::ModuleManager mgr(std::move(modules));
+    mgr.Run();
+    return 0;
+}
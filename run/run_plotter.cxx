@@ -2,17 +2,16 @@
 #include <vector>
 #include "Framework/Module.hxx"
 #include "Framework/ModuleManager.hxx"
+#include "Framework/RunOptions.hxx"
 #include "Modules/justPlotModule.hxx"
 #include <TEnv.h>
 #include <iostream>
 
 int main(int argc, char* argv[])
 {
-    if (argc!=2) {
-        std::cerr << "Usage: run_preselection <config.cfg>\n";
-        return 1;
-    }
-    TEnv cfg(argv[1]);
+    auto cfgPtr = Analysis::RunOptions::LoadConfig(argc, argv, "run_plotter");
+    if (!cfgPtr) return 1;
+    const TEnv& cfg = *cfgPtr;
     
     // Build the vector explicitly (was having problems before)
 
@@ -0,0 +1,165 @@
+#include "Framework/Checkpoint.hxx"
+
+#include <TEntryList.h>
+#include <TFile.h>
+#include <TFileMerger.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+//----------------------------------------------------------------------------//
+// Journal format, appended one line at a time:
+//   commit <entryEnd>
+//   complete
+//----------------------------------------------------------------------------//
+Checkpoint::Checkpoint(const std::string& outputPath, bool resume)
+    : fPath(JournalPath(outputPath))
+{
+    if (!resume) {
+        std::remove(fPath.c_str());
+        return;
+    }
+
+    std::ifstream in(fPath);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string tag;
+        ss >> tag;
+        Long64_t entry = -1;
+        if (tag == "commit" && (ss >> entry)) fLastCommitted = std::max(fLastCommitted, entry);
+        else if (tag == "complete")           fComplete = true;
+        // a torn last line from a crash simply fails to parse and is ignored
+    }
+}
+
+//----------------------------------------------------------------------------//
+void Checkpoint::Append(const std::string& line) const
+{
+    std::ofstream out(fPath, std::ios::app);
+    if (!out)
+        throw std::runtime_error("[Checkpoint] Cannot write journal: " + fPath);
+    out << line << "\n";
+    out.flush();
+}
+
+//----------------------------------------------------------------------------//
+void Checkpoint::Commit(Long64_t entryEnd)
+{
+    Append("commit " + std::to_string(entryEnd));
+    fLastCommitted = entryEnd;
+}
+
+//----------------------------------------------------------------------------//
+void Checkpoint::MarkComplete()
+{
+    Append("complete");
+    fComplete = true;
+}
+
+//----------------------------------------------------------------------------//
+std::vector<std::pair<Long64_t, Long64_t>>
+Checkpoint::ClusterChunks(TTree& tree, Long64_t begin, Long64_t end, Long64_t chunkEntries)
+{
+    std::vector<std::pair<Long64_t, Long64_t>> chunks;
+    if (begin >= end) return chunks;
+
+    auto clusters = tree.GetClusterIterator(begin);
+    Long64_t chunkStart = begin;
+    Long64_t clusterStart;
+    while ((clusterStart = clusters()) < end) {
+        const Long64_t clusterEnd = std::min(clusters.GetNextEntry(), end);
+        if (clusterEnd - chunkStart >= chunkEntries) {
+            chunks.emplace_back(chunkStart, clusterEnd);
+            chunkStart = clusterEnd;
+        }
+        if (clusterEnd >= end) break;
+    }
+    if (chunkStart < end) chunks.emplace_back(chunkStart, end);
+    return chunks;
+}
+
+//----------------------------------------------------------------------------//
+void Checkpoint::SnapshotInChunks(const NodeBuilder& build,
+                                  const std::string& inFile,
+                                  const std::string& treeName,
+                                  const ShardSpec& shard,
+                                  Long64_t chunkEntries,
+                                  const std::string& outFile,
+                                  const std::vector<std::string>& columns,
+                                  const ROOT::RDF::RSnapshotOptions& opt,
+                                  bool resume)
+{
+    Checkpoint journal(outFile, resume);
+    if (resume && journal.IsComplete() && !gSystem->AccessPathName(outFile.c_str())) {
+        std::cout << "[Checkpoint] " << outFile << " already complete, skipping.\n";
+        return;
+    }
+
+    std::vector<std::pair<Long64_t, Long64_t>> chunks;
+    {
+        std::unique_ptr<TFile> f{TFile::Open(inFile.c_str(), "READ")};
+        if (!f || f->IsZombie())
+            throw std::runtime_error("[Checkpoint] Cannot open file: " + inFile);
+        auto tree = f->Get<TTree>(treeName.c_str());
+        if (!tree)
+            throw std::runtime_error("[Checkpoint] Cannot find tree: " + treeName);
+        const auto [begin, end] = shard.EntryRange(tree->GetEntries());
+        chunks = ClusterChunks(*tree, begin, end, chunkEntries);
+    }
+
+    ROOT::RDF::RSnapshotOptions partOpt = opt;
+    partOpt.fMode = "RECREATE";
+
+    std::vector<std::string> parts;
+    for (std::size_t k = 0; k < chunks.size(); ++k) {
+        const auto [cBegin, cEnd] = chunks[k];
+        const std::string part = outFile + ".part" + std::to_string(k);
+        parts.push_back(part);
+
+        if (resume && cEnd <= journal.LastCommitted() && !gSystem->AccessPathName(part.c_str())) {
+            std::cout << "[Checkpoint] Chunk " << k << " [" << cBegin << ", " << cEnd << ") already done.\n";
+            continue;
+        }
+
+        std::cout << "[Checkpoint] Writing chunk " << k + 1 << " / " << chunks.size()
+                  << " [" << cBegin << ", " << cEnd << ") to " << part << "\n";
+        // A fresh frame per chunk over the chunk's entries only: an entry list
+        // on the tree, so the loop reads no other cluster and, unlike Range()
+        // or rdfentry_, it holds under implicit MT too
+        std::unique_ptr<TFile> f{TFile::Open(inFile.c_str(), "READ")};
+        auto tree = f && !f->IsZombie() ? f->Get<TTree>(treeName.c_str()) : nullptr;
+        if (!tree)
+            throw std::runtime_error("[Checkpoint] Cannot read " + treeName + " from " + inFile);
+        // Like the tree, the list lives as long as the file stays open
+        auto* list = new TEntryList("checkpoint_chunk", "entries of the chunk", tree);
+        for (Long64_t e = cBegin; e < cEnd; ++e) list->Enter(e);
+        tree->SetEntryList(list);
+        ROOT::RDataFrame df(*tree);
+        build(df, cBegin, cEnd).Snapshot(treeName, part, columns, partOpt);
+
+        // Snapshot has closed the part file by now
+        journal.Commit(cEnd);
+    }
+
+    // Stitch the parts together in order and drop them
+    TFileMerger merger(kFALSE, kFALSE);
+    merger.SetFastMethod(kTRUE);
+    merger.SetPrintLevel(0);
+    if (!merger.OutputFile(outFile.c_str(), opt.fMode.c_str()))
+        throw std::runtime_error("[Checkpoint] Cannot create " + outFile);
+    for (const auto& p : parts) merger.AddFile(p.c_str(), kFALSE);
+    if (!parts.empty() && !merger.Merge())
+        throw std::runtime_error("[Checkpoint] Merging chunks failed for " + outFile);
+
+    journal.MarkComplete();
+    for (const auto& p : parts) std::remove(p.c_str());
+}
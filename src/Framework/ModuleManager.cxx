@@ -1,7 +1,20 @@
 #include "Framework/ModuleManager.hxx"
+#include "Utils/Plotter.hxx"
+#include "Utils/HistCache.hxx"
 
+#include <TEnv.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
 #include <iostream>
 #include <iomanip>
+#include <set>
+#include <stdexcept>
+#include <thread>
 
 using namespace Analysis;
 
@@ -16,62 +29,282 @@ void ModuleManager::Add(std::unique_ptr<Module> mod)
 }
 
 //----------------------------------------------------------------------------//
-Long64_t ModuleManager::DetermineNEntries() const
+Long64_t ModuleManager::DetermineNEntries(const Module& m) const
 {
-    for (const auto& m : fModules) {
-        const Long64_t n = m->EntryCount();
-        if (n > 0) return n;
-    }
+    // Ask the module being run rather than the first registered one: with the
+    // stage cache, earlier modules may have been skipped and never initialised.
+    const Long64_t n = m.EntryCount();
+    if (n > 0) return n;
     throw std::runtime_error(
         "[ModuleManager] Could not determine number of events – "
-        "not all modules returned a valid EntryCount().");
+        + m.Name() + " did not return a valid EntryCount().");
 }
 
 //----------------------------------------------------------------------------//
-void ModuleManager::Run()
+void ModuleManager::RunModule(Module& m) const
 {
-    if (fModules.empty())
-        throw std::runtime_error("[ModuleManager] No modules registered!");
-
     //------------------------------------------------------------------//
     // 1.  Initialise
     //------------------------------------------------------------------//
-    for (auto& m : fModules) {
-        std::cout << "  ↳ Initialising " << m->Name() << " …\n";
-        m->Initialise();
+    std::cout << "  ↳ Initialising " << m.Name() << " …\n";
+    m.Initialise();
 
     // Have to call this after Initialise() to ensure all modules are ready - in the slimmer this requires
     // the TChain to be built first, in the others it requires available data frames.
 
-        const Long64_t nEntries = DetermineNEntries();
-        std::cout << "[ModuleManager] Will process " << nEntries
-                << " entries.\n";
+    const Long64_t nEntries = DetermineNEntries(m);
+    std::cout << "[ModuleManager] Will process " << nEntries
+            << " entries.\n";
+
+    //------------------------------------------------------------------//
+    // 2.  Event loop - stopwatch only gives useful information if we actually loop over events in Execute()
+    //------------------------------------------------------------------//
+
+    TStopwatch sw;
+    sw.Start();
+    for (Long64_t i = 0; i < nEntries; ++i) {
+        if (i%10000==0)
+            std::cout << "\r[ModuleManager] " << std::setw(7) << i
+                    << " / " << nEntries << std::flush;
+
+
+        m.Execute(i);
+    }
+    sw.Stop();
+    const Double_t cpuTime = sw.CpuTime();
+    std::cout << "\r[ModuleManager] Finished loop in "
+            << std::fixed << std::setprecision(3)
+            << cpuTime << " s (" << (cpuTime/nEntries) * 1e3
+            << " ms / evt)\n";
+
+    //------------------------------------------------------------------//
+    // 3.  Finalise
+    //------------------------------------------------------------------//
+    std::cout << "  ↳ Finalising " << m.Name() << " …\n";
+    m.Finalise();
+}
+
+//----------------------------------------------------------------------------//
+void ModuleManager::Run()
+{
+    if (fModules.empty())
+        throw std::runtime_error("[ModuleManager] No modules registered!");
+
+    const TEnv& cfg = fModules.front()->Cfg();
+    if (cfg.GetValue("Global.StageCache", false)) {
+        const std::string manifest = cfg.GetValue("Global.StageCacheManifest", ".microscope_manifest");
+        std::cout << "[ModuleManager] Stage cache enabled, manifest: " << manifest << "\n";
+        fCache = std::make_unique<StageCache>(manifest, cfg.GetValue("Global.StageCacheHashContent", false));
+    }
 
-        //------------------------------------------------------------------//
-        // 2.  Event loop - stopwatch only gives useful information if we actually loop over events in Execute()
-        //------------------------------------------------------------------//
+    const std::string scheduler = cfg.GetValue("Global.Scheduler", "sequential");
+    if (scheduler == "dag")             RunGraph();
+    else if (scheduler == "sequential") RunSequential();
+    else throw std::runtime_error("[ModuleManager] Unknown Global.Scheduler: " + scheduler);
 
-        TStopwatch sw;
-        sw.Start();
-        for (Long64_t i = 0; i < nEntries; ++i) {
-            if (i%10000==0)
-                std::cout << "\r[ModuleManager] " << std::setw(7) << i
-                        << " / " << nEntries << std::flush;
+    // Plots queued for batch rendering (Global.RenderWorkers > 0)
+    Plotter::FlushRenderQueue();
 
+    // The histogram cache stays open while the modules run; write it out once
+    if (auto* cache = Plotter::Cache()) cache->Close();
+}
+
+//----------------------------------------------------------------------------//
+void ModuleManager::RunSequential()
+{
+    // Once one module has re-run, everything downstream of it is stale too
+    bool invalidated = false;
+    for (auto& m : fModules) {
+        if (fCache && !invalidated && fCache->IsUpToDate(*m)) {
+            std::cout << "  ↳ Skipping " << m->Name() << " (outputs up to date)\n";
+            continue;
+        }
+        invalidated = true;
+
+        if (fCache) fCache->Invalidate(*m);
+        RunModule(*m);
+        // Queued plots are outputs too: draw them before the manifest records the files
+        Plotter::FlushRenderQueue();
+        if (fCache) fCache->Record(*m);
+    }
+}
+
+//----------------------------------------------------------------------------//
+std::vector<std::vector<std::size_t>> ModuleManager::BuildDependencies() const
+{
+    // Configs mix absolute and relative paths (and symlinks) for the same file,
+    // so both sides are resolved against the working directory before matching
+    auto normalise = [](const std::string& p) {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        const fs::path absolute = fs::absolute(p, ec).lexically_normal();
+        const fs::path resolved = fs::weakly_canonical(absolute, ec);
+        return (ec ? absolute : resolved).string();
+    };
+
+    const std::size_t n = fModules.size();
+    std::vector<std::vector<std::size_t>> parents(n);
+    std::vector<std::set<std::string>> produced(n);
+    for (std::size_t i = 0; i < n; ++i)
+        for (const auto& out : fModules[i]->Outputs()) produced[i].insert(normalise(out));
+
+    for (std::size_t j = 0; j < n; ++j) {
+        const auto inputs = fModules[j]->Inputs();
+
+        // A module that declares nothing keeps its place in the insertion order
+        if (inputs.empty() && fModules[j]->Outputs().empty()) {
+            for (std::size_t i = 0; i < j; ++i) parents[j].push_back(i);
+            continue;
+        }
+
+        // Only earlier modules can be producers, so the graph is acyclic by construction
+        for (std::size_t i = 0; i < j; ++i) {
+            const bool consumes = std::any_of(inputs.begin(), inputs.end(),
+                [&](const std::string& in) { return produced[i].count(normalise(in)) > 0; });
+            const bool opaque = fModules[i]->Inputs().empty() && fModules[i]->Outputs().empty();
+            if (consumes || opaque) parents[j].push_back(i);
+        }
+    }
+    return parents;
+}
+
+//----------------------------------------------------------------------------//
+void ModuleManager::RunGraph()
+{
+    const TEnv& cfg = fModules.front()->Cfg();
+    const std::size_t n = fModules.size();
+    const auto parents = BuildDependencies();
+
+    std::vector<std::vector<std::size_t>> children(n);
+    for (std::size_t j = 0; j < n; ++j)
+        for (auto i : parents[j]) children[i].push_back(j);
+
+    std::cout << "[ModuleManager] Dependency graph:\n";
+    for (std::size_t j = 0; j < n; ++j) {
+        std::cout << "    " << fModules[j]->Name() << " <- {";
+        for (std::size_t k = 0; k < parents[j].size(); ++k)
+            std::cout << (k ? ", " : " ") << fModules[parents[j][k]]->Name();
+        std::cout << " }\n";
+    }
+
+    // Concurrent nodes share one implicit-MT pool, so the core budget is global
+    ROOT::EnableThreadSafety();
+    const int nThreads = cfg.GetValue("Global.NThreads", 0);
+    if (nThreads > 0 && !ROOT::IsImplicitMTEnabled()) ROOT::EnableImplicitMT(nThreads);
+
+    unsigned maxConcurrent = static_cast<unsigned>(cfg.GetValue("Global.MaxConcurrentModules", 0));
+    if (maxConcurrent == 0) maxConcurrent = static_cast<unsigned>(n);
+
+    enum class State { Pending, Running, Done, Skipped, Failed, Blocked };
+    std::vector<State> state(n, State::Pending);
+    std::vector<std::size_t> nWaiting(n);
+    std::vector<bool> ranUpstream(n, false);    // an ancestor re-ran, so the cache is stale
+    std::vector<std::string> errors(n);
+    for (std::size_t j = 0; j < n; ++j) nWaiting[j] = parents[j].size();
+
+    // With deferred rendering the plots only exist after the final flush, so
+    // the modules that ran are recorded then. Children of a module that ran
+    // re-run anyway, so none of them consults the missing record.
+    const bool deferRecord = Plotter::RenderDeferred();
+    std::vector<Module*> toRecord;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::size_t> ready;
+    std::size_t nFinished = 0;
+    for (std::size_t j = 0; j < n; ++j) if (nWaiting[j] == 0) ready.push_back(j);
+
+    // Called with mtx held once node j has reached a final state
+    std::function<void(std::size_t)> finish = [&](std::size_t j) {
+        ++nFinished;
+        const bool ok = state[j] == State::Done || state[j] == State::Skipped;
+        for (auto c : children[j]) {
+            if (state[c] != State::Pending) continue;
+            if (!ok) {
+                state[c] = State::Blocked;
+                errors[c] = "upstream " + fModules[j]->Name() + " did not complete";
+                finish(c);
+                continue;
+            }
+            if (state[j] == State::Done) ranUpstream[c] = true;
+            if (--nWaiting[c] == 0) ready.push_back(c);
+        }
+    };
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [&] { return !ready.empty() || nFinished == n; });
+            if (ready.empty()) return;
+
+            const std::size_t j = ready.front();
+            ready.pop_front();
+            Module& m = *fModules[j];
+            state[j] = State::Running;
+            const bool stale = ranUpstream[j];
+            lock.unlock();
+
+            State result = State::Done;
+            try {
+                bool upToDate = false;
+                if (fCache && !stale) {
+                    std::lock_guard<std::mutex> cacheLock(fCacheMutex);
+                    upToDate = fCache->IsUpToDate(m);
+                }
+                if (upToDate) {
+                    std::cout << "  ↳ Skipping " << m.Name() << " (outputs up to date)\n";
+                    result = State::Skipped;
+                }
+                else {
+                    if (fCache) { std::lock_guard<std::mutex> cacheLock(fCacheMutex); fCache->Invalidate(m); }
+                    RunModule(m);
+                    if (fCache && deferRecord) {
+                        std::lock_guard<std::mutex> cacheLock(fCacheMutex);
+                        toRecord.push_back(&m);
+                    }
+                    else if (fCache) { std::lock_guard<std::mutex> cacheLock(fCacheMutex); fCache->Record(m); }
+                }
+            }
+            catch (const std::exception& e) {
+                result = State::Failed;
+                lock.lock();
+                errors[j] = e.what();
+                lock.unlock();
+            }
+
+            lock.lock();
+            state[j] = result;
+            finish(j);
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    const unsigned nWorkers = std::min<unsigned>(maxConcurrent, static_cast<unsigned>(n));
+    std::cout << "[ModuleManager] Running " << n << " modules on " << nWorkers << " worker(s)\n";
+    for (unsigned w = 0; w < nWorkers; ++w) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+
+    if (!toRecord.empty()) {
+        Plotter::FlushRenderQueue();
+        for (auto* m : toRecord) fCache->Record(*m);
+    }
 
-            m->Execute(i);
+    // Per-node report
+    std::size_t nBad = 0;
+    std::cout << "[ModuleManager] Summary:\n";
+    for (std::size_t j = 0; j < n; ++j) {
+        const char* what = "done";
+        switch (state[j]) {
+            case State::Skipped: what = "up to date"; break;
+            case State::Failed:  what = "FAILED";     ++nBad; break;
+            case State::Blocked: what = "not run";    ++nBad; break;
+            default: break;
         }
-        sw.Stop();
-        const Double_t cpuTime = sw.CpuTime();
-        std::cout << "\r[ModuleManager] Finished loop in "
-                << std::fixed << std::setprecision(3)
-                << cpuTime << " s (" << (cpuTime/nEntries) * 1e3
-                << " ms / evt)\n";
-
-        //------------------------------------------------------------------//
-        // 3.  Finalise
-        //------------------------------------------------------------------//
-        std::cout << "  ↳ Finalising " << m->Name() << " …\n";
-        m->Finalise();
+        std::cout << "    " << std::left << std::setw(20) << fModules[j]->Name() << what;
+        if (!errors[j].empty()) std::cout << " (" << errors[j] << ")";
+        std::cout << "\n";
     }
+    if (nBad > 0)
+        throw std::runtime_error("[ModuleManager] " + std::to_string(nBad) + " module(s) failed or were not run.");
 }
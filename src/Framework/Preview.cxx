@@ -0,0 +1,107 @@
+#include "Framework/Preview.hxx"
+
+#include <TEntryList.h>
+#include <TTree.h>
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+//----------------------------------------------------------------------------//
+PreviewSpec::PreviewSpec(double fraction)
+    : fFraction(fraction)
+{
+    if (!(fraction > 0. && fraction <= 1.))
+        throw std::runtime_error("[Preview] Global.Preview must be in (0, 1], got " + std::to_string(fraction));
+}
+
+//----------------------------------------------------------------------------//
+PreviewSpec PreviewSpec::FromConfig(const TEnv& cfg)
+{
+    return PreviewSpec(cfg.GetValue("Global.Preview", 1.0));
+}
+
+//----------------------------------------------------------------------------//
+std::string PreviewSpec::Tag() const
+{
+    if (!Active()) return "";
+    std::ostringstream ss;
+    ss << ".preview" << std::setprecision(6) << fFraction;
+    return ss.str();
+}
+
+//----------------------------------------------------------------------------//
+std::vector<std::pair<Long64_t, Long64_t>>
+PreviewSpec::Clusters(TTree& tree, Long64_t begin, Long64_t end) const
+{
+    if (!Active() || begin >= end) return {{begin, end}};
+
+    std::vector<std::pair<Long64_t, Long64_t>> all, ranges;
+    auto it = tree.GetClusterIterator(begin);
+    Long64_t start;
+    while ((start = it()) < end) {
+        all.emplace_back(std::max(start, begin), std::min(it.GetNextEntry(), end));
+        if (all.back().second >= end) break;
+    }
+
+    // Systematic sample: cluster c is kept when [c f, (c + 1) f) crosses an
+    // integer (offset by one half, so the strata are centred)
+    for (std::size_t c = 0; c < all.size(); ++c) {
+        if (std::floor((c + 1) * fFraction + 0.5) <= std::floor(c * fFraction + 0.5)) continue;
+        if (!ranges.empty() && ranges.back().second == all[c].first) ranges.back().second = all[c].second;
+        else ranges.push_back(all[c]);
+    }
+    if (ranges.empty()) ranges.push_back(all[all.size() / 2]);
+    return ranges;
+}
+
+//----------------------------------------------------------------------------//
+std::string PreviewSpec::Estimate(double nRead, double weightScale)
+{
+    std::ostringstream ss;
+    ss << "~" << std::setprecision(4) << nRead * weightScale
+       << " +- " << std::sqrt(nRead) * weightScale;
+    if (nRead > 0) ss << " (" << std::setprecision(2) << 100. / std::sqrt(nRead) << "%)";
+    return ss.str();
+}
+
+//----------------------------------------------------------------------------//
+ReadPlan ReadPlan::Apply(TTree& tree, const std::string& file, const std::string& treeName,
+                         const ShardSpec& shard, const PreviewSpec& preview,
+                         const std::vector<ZoneMap::Term>& terms)
+{
+    ReadPlan plan;
+    const auto [begin, end] = shard.EntryRange(tree.GetEntries());
+    auto ranges = preview.Clusters(tree, begin, end);
+
+    Long64_t previewed = 0;
+    for (const auto& [b, e] : ranges) previewed += e - b;
+    if (previewed > 0) plan.weightScale = static_cast<double>(end - begin) / previewed;
+
+    plan.zoneSkipped = ZoneMap::Narrow(file, treeName, tree.GetEntries(), terms, ranges);
+    // A shard's range is an entry list too: rdfentry_, which ShardSpec::Restrict
+    // would have to filter on under implicit MT, is not the tree entry there.
+    // An empty shard is left to Restrict: an empty entry list would read everything.
+    const bool wholeTree = begin == 0 && end == tree.GetEntries();
+    if ((!preview.Active() && plan.zoneSkipped == 0 && wholeTree) || begin >= end) return plan;
+
+    // The tree does not own its entry list; like the tree itself it lives
+    // as long as the file stays open
+    auto* list = new TEntryList("readplan", "entries to read", &tree);
+    Long64_t nRead = 0;
+    for (const auto& [b, e] : ranges) {
+        for (Long64_t i = b; i < e; ++i) list->Enter(i);
+        nRead += e - b;
+    }
+    tree.SetEntryList(list);
+    plan.entryList = true;
+
+    std::cout << "[ReadPlan] " << file << ": reading " << nRead << " of " << (end - begin) << " entries";
+    if (preview.Active()) std::cout << ", preview weight scale " << plan.weightScale;
+    std::cout << "\n";
+    return plan;
+}
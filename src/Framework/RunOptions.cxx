@@ -0,0 +1,130 @@
+#include "Framework/RunOptions.hxx"
+#include "Framework/Sharding.hxx"
+#include "Framework/Preview.hxx"
+#include "Utils/Plotter.hxx"
+
+#include <TSystem.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+//----------------------------------------------------------------------------//
+void RunOptions::PrintUsage(const std::string& exeName)
+{
+    std::cerr << "Usage: " << exeName << " <config.cfg> [--shard i/N] [--shards N] [--resume] [--render-only] [--preview f]\n";
+}
+
+//----------------------------------------------------------------------------//
+std::unique_ptr<TEnv> RunOptions::LoadConfig(int argc, char* argv[], const std::string& exeName)
+{
+    if (argc < 2) {
+        PrintUsage(exeName);
+        return nullptr;
+    }
+    auto cfg = std::make_unique<TEnv>(argv[1]);
+    bool runShard = false;
+
+    // Generated fragments (e.g. a FeatureSelection proposal) override the config's keys
+    std::stringstream ssOverlays{cfg->GetValue("Global.ConfigOverlays", "")};
+    std::string overlay;
+    while (ssOverlays >> overlay) {
+        if (overlay.back()==',') overlay.pop_back();
+        if (gSystem->AccessPathName(overlay.c_str())) {
+            std::cerr << "[" << exeName << "] Config overlay not found, skipped: " << overlay << "\n";
+            continue;
+        }
+        cfg->ReadFile(overlay.c_str(), kEnvChange);
+        std::cout << "[" << exeName << "] Applied config overlay " << overlay << "\n";
+    }
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--shard" && i + 1 < argc) {
+            try {
+                const auto [index, count] = ShardSpec::ParseIndexCount(argv[++i]);
+                cfg->SetValue("Global.ShardIndex", index);
+                cfg->SetValue("Global.ShardCount", count);
+                runShard = true;
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+                PrintUsage(exeName);
+                return nullptr;
+            }
+        }
+        else if (arg == "--resume") {
+            // Continue checkpointed outputs from their journals (Global.CheckpointEntries)
+            cfg->SetValue("Global.Resume", 1);
+        }
+        else if (arg == "--render-only") {
+            // Redraw the plots from the histogram cache (Global.HistCache) without reading ntuples
+            cfg->SetValue("Global.RenderOnly", 1);
+        }
+        else if (arg == "--preview" && i + 1 < argc) {
+            // Read a fraction f of every sample's clusters (Global.Preview)
+            cfg->SetValue("Global.Preview", std::atof(argv[++i]));
+        }
+        else if (arg == "--shards" && i + 1 < argc) {
+            // Number of shards to merge (run_merge); this process is not itself a shard
+            cfg->SetValue("Merge.ShardCount", std::atoi(argv[++i]));
+        }
+        else {
+            std::cerr << "[" << exeName << "] Unknown argument: " << arg << "\n";
+            PrintUsage(exeName);
+            return nullptr;
+        }
+    }
+
+    // In a sharded run, histograms are summed by run_merge rather than drawn per shard
+    const ShardSpec shard = ShardSpec::FromConfig(*cfg);
+    if (runShard && shard.Active()) {
+        const std::string histFile = ShardSpec::HistogramFile(*cfg);
+        std::cout << "[" << exeName << "] Running shard " << shard.Index() << " of "
+                  << shard.Count() << ", histograms to "
+                  << shard.OutputName(histFile, shard.Index()) << "\n";
+        Plotter::SetHistogramSink(shard.OutputName(histFile, shard.Index()));
+    }
+
+    const std::string histCache = cfg->GetValue("Global.HistCache", "");
+    const bool renderOnly = cfg->GetValue("Global.RenderOnly", 0) != 0;
+    if (renderOnly && histCache.empty()) {
+        std::cerr << "[" << exeName << "] --render-only needs Global.HistCache in the config\n";
+        return nullptr;
+    }
+    Plotter::SetHistCache(histCache);
+    Plotter::SetRenderOnly(renderOnly);
+
+    std::vector<std::string> formats;
+    std::stringstream ssFormats{cfg->GetValue("Global.PlotFormats", "png pdf")};
+    std::string fmt;
+    while (ssFormats >> fmt) {
+        if (fmt.back()==',') fmt.pop_back();
+        if (!fmt.empty() && fmt.front()=='.') fmt.erase(0, 1);
+        if (!fmt.empty()) formats.push_back(fmt);
+    }
+    Plotter::SetOutputFormats(formats);
+    Plotter::SetRenderWorkers(cfg->GetValue("Global.RenderWorkers", 0));
+
+    // Preview plots state how much of the statistics they show
+    try {
+        const PreviewSpec preview = PreviewSpec::FromConfig(*cfg);
+        if (preview.Active()) {
+            std::ostringstream note;
+            note << "Preview " << 100. * preview.Fraction() << "% of events: stat. errors ~"
+                 << std::setprecision(2) << 1. / std::sqrt(preview.Fraction()) << "x full sample";
+            Plotter::SetAnnotation(note.str());
+            std::cout << "[" << exeName << "] " << note.str() << "\n";
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return nullptr;
+    }
+    return cfg;
+}
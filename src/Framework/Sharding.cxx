@@ -0,0 +1,130 @@
+#include "Framework/Sharding.hxx"
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TROOT.h>
+
+#include <memory>
+#include <stdexcept>
+
+using namespace Analysis;
+
+//----------------------------------------------------------------------------//
+ShardSpec::ShardSpec(int index, int count, Mode mode)
+    : fIndex(index), fCount(count), fMode(mode)
+{
+    if (count < 1 || index < 0 || index >= count)
+        throw std::runtime_error("[Sharding] Invalid shard " + std::to_string(index)
+                                 + "/" + std::to_string(count));
+}
+
+//----------------------------------------------------------------------------//
+ShardSpec ShardSpec::FromConfig(const TEnv& cfg)
+{
+    const int index = cfg.GetValue("Global.ShardIndex", 0);
+    const int count = cfg.GetValue("Global.ShardCount", 1);
+    const std::string mode = cfg.GetValue("Global.ShardMode", "entries");
+    if (mode != "entries" && mode != "files")
+        throw std::runtime_error("[Sharding] Unknown Global.ShardMode: " + mode);
+    return ShardSpec(index, count, mode == "files" ? Mode::Files : Mode::Entries);
+}
+
+//----------------------------------------------------------------------------//
+std::string ShardSpec::HistogramFile(const TEnv& cfg)
+{
+    const std::string label = cfg.GetValue("Global.RunLabel", "run_x");
+    return cfg.GetValue("Global.ShardHistFile", ("histograms_" + label + ".root").c_str());
+}
+
+//----------------------------------------------------------------------------//
+std::pair<int, int> ShardSpec::ParseIndexCount(const std::string& spec)
+{
+    const auto slash = spec.find('/');
+    if (slash == std::string::npos)
+        throw std::runtime_error("[Sharding] Expected --shard i/N, got: " + spec);
+    int index = 0, count = 0;
+    try {
+        index = std::stoi(spec.substr(0, slash));
+        count = std::stoi(spec.substr(slash + 1));
+    }
+    catch (const std::exception&) {
+        throw std::runtime_error("[Sharding] Expected --shard i/N, got: " + spec);
+    }
+    if (count < 1 || index < 0 || index >= count)
+        throw std::runtime_error("[Sharding] Shard index must satisfy 0 <= i < N, got: " + spec);
+    return {index, count};
+}
+
+//----------------------------------------------------------------------------//
+std::string ShardSpec::Tag() const
+{
+    if (!Active()) return "";
+    return ".shard" + std::to_string(fIndex) + "of" + std::to_string(fCount);
+}
+
+//----------------------------------------------------------------------------//
+std::string ShardSpec::OutputName(const std::string& path) const
+{
+    if (fMode == Mode::Files) return path;
+    return OutputName(path, fIndex);
+}
+
+//----------------------------------------------------------------------------//
+std::string ShardSpec::OutputName(const std::string& path, int index) const
+{
+    if (!Active()) return path;
+    const std::string tag = ".shard" + std::to_string(index) + "of" + std::to_string(fCount);
+    std::string out = path;
+    const auto slash = out.find_last_of('/');
+    const auto dot   = out.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) out += tag;
+    else                                                                         out.insert(dot, tag);
+    return out;
+}
+
+//----------------------------------------------------------------------------//
+std::vector<std::size_t> ShardSpec::SelectFiles(std::size_t nFiles) const
+{
+    std::vector<std::size_t> sel;
+    for (std::size_t k = 0; k < nFiles; ++k)
+        if (fMode == Mode::Entries || !Active() || static_cast<int>(k % fCount) == fIndex)
+            sel.push_back(k);
+    return sel;
+}
+
+//----------------------------------------------------------------------------//
+std::pair<Long64_t, Long64_t> ShardSpec::EntryRange(Long64_t nEntries) const
+{
+    if (!Active() || fMode == Mode::Files) return {0, nEntries};
+    // 128-bit intermediate: n * i can overflow for very large chains and farms
+    const auto begin = static_cast<Long64_t>((static_cast<__int128>(nEntries) * fIndex) / fCount);
+    const auto end   = static_cast<Long64_t>((static_cast<__int128>(nEntries) * (fIndex + 1)) / fCount);
+    return {begin, end};
+}
+
+//----------------------------------------------------------------------------//
+ROOT::RDF::RNode ShardSpec::Restrict(ROOT::RDF::RNode node,
+                                     const std::string& fileName,
+                                     const std::string& treeName) const
+{
+    if (!Active() || fMode == Mode::Files) return node;
+
+    // Only the tree header is read here, unlike Count() which runs an event loop
+    std::unique_ptr<TFile> file{TFile::Open(fileName.c_str(), "READ")};
+    if (!file || file->IsZombie())
+        throw std::runtime_error("[Sharding] Cannot open file: " + fileName);
+    auto tree = file->Get<TTree>(treeName.c_str());
+    if (!tree)
+        throw std::runtime_error("[Sharding] Cannot find tree: " + treeName);
+    const auto [begin, end] = EntryRange(tree->GetEntries());
+    if (begin == 0 && end == tree->GetEntries()) return node;
+    if (begin >= end)
+        return node.Filter([]() { return false; }, {}, "shard");
+
+    // Under implicit MT rdfentry_ numbers entries in the order tasks run, so
+    // it cannot select a range; the tree needs an entry list (ReadPlan::Apply)
+    if (ROOT::IsImplicitMTEnabled())
+        throw std::runtime_error("[Sharding] Entries-mode shard of " + fileName
+                                 + " under implicit MT: restrict the tree with ReadPlan::Apply instead");
+    return node.Range(begin, end);
+}
@@ -0,0 +1,185 @@
+#include "Framework/StageCache.hxx"
+
+#include <TSystem.h>
+#include <THashList.h>
+#include <TEnv.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace Analysis;
+
+//----------------------------------------------------------------------------//
+StageCache::StageCache(const std::string& manifestPath, bool hashContent)
+    : fManifestPath(manifestPath)
+    , fHashContent(hashContent)
+{
+    Load();
+}
+
+//----------------------------------------------------------------------------//
+std::string StageCache::Hash(const std::string& data)
+{
+    std::uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+    return buf;
+}
+
+//----------------------------------------------------------------------------//
+// The Global keys that change what a stage writes. Scheduling, threading,
+// plot formats (checked through the outputs themselves), caching and
+// skipping optimisations such as Global.UseZoneMaps leave outputs alone.
+static const std::vector<std::string> kOutputGlobals{
+    "Global.RunLabel",
+    "Global.ShardIndex", "Global.ShardCount", "Global.ShardMode", "Global.ShardHistFile",
+    "Global.Preview",
+    "Global.EventIndex", "Global.EventIndexColumns", "Global.ZoneMapColumns",
+};
+
+//----------------------------------------------------------------------------//
+std::string StageCache::HashConfigSection(const TEnv& cfg, const std::string& section)
+{
+    // TEnv keeps its records in a hash list, so sort them for a stable hash
+    std::vector<std::pair<std::string, std::string>> records;
+    const std::string prefix = section + ".";
+    TIter next(const_cast<TEnv&>(cfg).GetTable());
+    while (auto* rec = dynamic_cast<TEnvRec*>(next())) {
+        const std::string name = rec->GetName();
+        if (name.rfind(prefix, 0) == 0
+            || std::find(kOutputGlobals.begin(), kOutputGlobals.end(), name) != kOutputGlobals.end())
+            records.emplace_back(name, rec->GetValue());
+    }
+    std::sort(records.begin(), records.end());
+
+    std::string text;
+    for (const auto& r : records) text += r.first + "=" + r.second + "\n";
+    return Hash(text);
+}
+
+//----------------------------------------------------------------------------//
+StageCache::FileStamp StageCache::Stamp(const std::string& path) const
+{
+    FileStamp st;
+    FileStat_t info;
+    if (gSystem->GetPathInfo(path.c_str(), info) != 0) return st;   // missing
+
+    st.size  = info.fSize;
+    st.mtime = info.fMtime;
+    if (fHashContent) {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream buf;
+        buf << in.rdbuf();
+        st.content = Hash(buf.str());
+    }
+    return st;
+}
+
+//----------------------------------------------------------------------------//
+std::string StageCache::StageKey(const Module& m) const
+{
+    std::ostringstream key;
+    key << "config " << HashConfigSection(m.Cfg(), m.ConfigSection()) << "\n";
+    for (const auto& in : m.Inputs()) {
+        const FileStamp st = Stamp(in);
+        key << "input " << in << " " << st.size << " " << st.mtime << " " << st.content << "\n";
+    }
+    return Hash(key.str());
+}
+
+//----------------------------------------------------------------------------//
+bool StageCache::IsUpToDate(const Module& m) const
+{
+    const auto outputs = m.Outputs();
+    if (outputs.empty()) return false;
+
+    auto it = fEntries.find(m.Name());
+    if (it == fEntries.end()) return false;
+    if (it->second.key != StageKey(m)) return false;
+
+    for (const auto& out : outputs) {
+        auto rec = it->second.outputs.find(out);
+        if (rec == it->second.outputs.end()) return false;
+        const FileStamp now = Stamp(out);
+        if (now.size < 0 || !(now == rec->second)) return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------//
+void StageCache::Record(const Module& m)
+{
+    Entry e;
+    e.key = StageKey(m);
+    for (const auto& out : m.Outputs()) e.outputs[out] = Stamp(out);
+    fEntries[m.Name()] = e;
+    Save();
+}
+
+//----------------------------------------------------------------------------//
+void StageCache::Invalidate(const Module& m)
+{
+    if (fEntries.erase(m.Name())) Save();
+}
+
+//----------------------------------------------------------------------------//
+// Manifest format, one record per line:
+//   stage  <module> <key>
+//   output <size> <mtime> <content-hash or -> <path>
+//----------------------------------------------------------------------------//
+void StageCache::Load()
+{
+    std::ifstream in(fManifestPath);
+    if (!in) return;
+
+    std::string line;
+    Entry* current = nullptr;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string tag;
+        ss >> tag;
+        if (tag == "stage") {
+            std::string name, key;
+            ss >> name >> key;
+            current = &fEntries[name];
+            current->key = key;
+        }
+        else if (tag == "output" && current) {
+            FileStamp st;
+            std::string path;
+            ss >> st.size >> st.mtime >> st.content;
+            if (st.content == "-") st.content.clear();
+            std::getline(ss >> std::ws, path);
+            current->outputs[path] = st;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------//
+void StageCache::Save() const
+{
+    // Write to a temporary file first so a crash never leaves a half-written manifest
+    const std::string tmp = fManifestPath + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!out) {
+            std::cerr << "[StageCache] Cannot write manifest: " << tmp << "\n";
+            return;
+        }
+        for (const auto& [name, e] : fEntries) {
+            out << "stage " << name << " " << e.key << "\n";
+            for (const auto& [path, st] : e.outputs)
+                out << "output " << st.size << " " << st.mtime << " "
+                    << (st.content.empty() ? "-" : st.content) << " " << path << "\n";
+        }
+    }
+    std::rename(tmp.c_str(), fManifestPath.c_str());
+}
@@ -1,16 +1,32 @@
 #include "Modules/BDTEvalModule.hxx"
+#include "Framework/Checkpoint.hxx"
+#include "Framework/Preview.hxx"
+#include "Utils/Kernels.hxx"
 
 #include <TMVA/Reader.h>
+#include <TMVA/MethodBase.h>
+#include <TMVA/Types.h>
+#include <ROOT/TBufferMerger.hxx>
 #include <TFile.h>
 #include <TTree.h>
 #include <TLeaf.h>
+#include <TBranch.h>
+#include <TClass.h>
 #include <TDirectory.h>
+#include <TSystem.h>
+#include <TROOT.h>
 
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <memory>
 #include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 using namespace Analysis;
 
@@ -26,6 +42,193 @@ static std::vector<std::string> split_ws_or_commas(const std::string& raw) {
     return out;
 }
 
+//---------------------------------------------
+// Booked TMVA readers of every model with their variable buffers. A reader
+// is not thread-safe, so each thread has its own Scorer; all of them book
+// from the weights text read once by LoadModels.
+class BDTEvalModule::Scorer {
+public:
+    explicit Scorer(const std::vector<Model>& models)
+    {
+        // TMVA's booking touches global state; evaluation on separate readers does not
+        static std::mutex bookMutex;
+        std::lock_guard<std::mutex> lock(bookMutex);
+        bufs.reserve(models.size());
+        for (const auto& m : models) {
+            bufs.emplace_back(m.vars.size(), 0.f);
+            readers.push_back(std::make_unique<TMVA::Reader>("!Color:!Silent"));
+            for (size_t j = 0; j < m.vars.size(); ++j) readers.back()->AddVariable(m.vars[j].c_str(), &bufs.back()[j]);
+            // Booking from the XML text does not register the method under a
+            // name in the reader, so it is evaluated through the returned method
+            auto* method = readers.back()->BookMVA(TMVA::Types::Instance().GetMethodType(m.type.c_str()), m.xml.c_str());
+            if (!method)
+                throw std::runtime_error("[BDTEvalModule] Cannot book " + m.method + " from " + m.weightsXML);
+            methods.push_back(static_cast<TMVA::MethodBase*>(method));
+        }
+    }
+
+    std::vector<std::unique_ptr<TMVA::Reader>> readers;   // per model
+    std::vector<TMVA::MethodBase*>             methods;   // per model, owned by its reader
+    std::vector<std::vector<float>>            bufs;      // per model, bound to its reader
+};
+
+//---------------------------------------------
+// Reads the models' variables from one input tree and writes every score
+// branch of one output tree cloned from it.
+class BDTEvalModule::TreeScorer {
+public:
+    // Finds the variables in inTree. In per-object mode the vector<float>
+    // variables are bound here, so construct before cloning the tree.
+    TreeScorer(const BDTEvalModule& mod, Scorer& scorer, TTree& inTree, const std::string& inPath)
+        : fMod(mod), fScorer(scorer)
+        , fJagged(mod.fAllVars.size() + 1, nullptr), fLeadingIdx(mod.fAllVars.size())
+        , fValues(mod.fAllVars.size(), 0.f)
+        , fScore(mod.fModels.size(), -999.f), fScoresV(mod.fModels.size()), fScoresPtr(mod.fModels.size())
+        , fReduced(mod.fModels.size(), std::vector<float>(mod.fPerObject ? mod.fScoreReductions.size() : 0, -999.f))
+    {
+        for (size_t m = 0; m < fScoresV.size(); ++m) fScoresPtr[m] = &fScoresV[m];
+
+        // check variables exist and cache TLeaf*; each variable is read once
+        // however many models use it
+        fLeaves.reserve(mod.fAllVars.size());
+        for (const auto& v : mod.fAllVars) {
+            // Try both leaf and (branch->leaf) name resolution
+            TLeaf* leaf = inTree.GetLeaf(v.c_str());
+            if (!leaf) {
+                // Some TTrees store leaves as "branch.leaf". Try to find by scanning all leaves.
+                TObjArray* leafs = inTree.GetListOfLeaves();
+                for (int i = 0; i < leafs->GetEntries() && !leaf; ++i) {
+                    auto* L = static_cast<TLeaf*>(leafs->At(i));
+                    if (std::string(L->GetName()) == v) leaf = L;
+                }
+                if (!leaf) {
+                    std::ostringstream msg;
+                    msg << "[BDTEvalModule] Missing variable leaf '" << v
+                        << "' in tree '" << mod.fTreeName << "' (file " << inPath << ").";
+                    throw std::runtime_error(msg.str());
+                }
+            }
+            fLeaves.push_back(leaf);
+        }
+
+        // Per-object mode: vector<float> variables (and the LeadingBy ranking) are
+        // read whole; scalar variables are broadcast to every object.
+        if (!mod.fPerObject) return;
+        auto bindVector = [&](const std::string& name, std::vector<float>** addr) {
+            TBranch* br = inTree.GetBranch(name.c_str());
+            TClass* cls = nullptr;
+            EDataType type;
+            if (!br || br->GetExpectedType(cls, type) != 0 || !cls) return false;
+            if (std::string(cls->GetName()) != "vector<float>")
+                throw std::runtime_error("[BDTEvalModule] Per-object variable " + name + " is a "
+                                         + cls->GetName() + "; only vector<float> is supported.");
+            inTree.SetBranchAddress(name.c_str(), addr);
+            return true;
+        };
+        bool anyJagged = false;
+        for (size_t u = 0; u < mod.fAllVars.size(); ++u) {
+            if (!bindVector(mod.fAllVars[u], &fJagged[u])) continue;
+            anyJagged = true;
+            if (mod.fAllVars[u] == mod.fLeadingBy) fLeadingIdx = u;
+        }
+        if (!anyJagged)
+            throw std::runtime_error("[BDTEvalModule] PerObject set but no EvalVars is a vector<float> branch.");
+        if (!mod.fLeadingBy.empty() && fLeadingIdx == mod.fAllVars.size()
+            && !bindVector(mod.fLeadingBy, &fJagged[fLeadingIdx]))
+            throw std::runtime_error("[BDTEvalModule] LeadingBy branch not found or not a vector: " + mod.fLeadingBy);
+    }
+
+    // Add the score branches to outTree, or re-attach them when resuming.
+    // bdt_score always holds the first model's score; in per-object mode
+    // each model also has <column>_v and <column>_<reduction>.
+    void Attach(TTree& outTree, bool resuming)
+    {
+        auto attach = [&](const std::string& name, float* addr) {
+            if (resuming) outTree.SetBranchAddress(name.c_str(), addr);
+            else          outTree.Branch(name.c_str(), addr, (name + "/F").c_str());
+        };
+        attach("bdt_score", &fBdtScore);
+        for (size_t m = 0; m < fMod.fModels.size(); ++m) {
+            const std::string& col = fMod.fModels[m].column;
+            if (col != "bdt_score") attach(col, &fScore[m]);
+            if (!fMod.fPerObject) continue;
+            if (resuming) outTree.SetBranchAddress((col + "_v").c_str(), &fScoresPtr[m]);
+            else          outTree.Branch((col + "_v").c_str(), &fScoresV[m]);
+            for (size_t r = 0; r < fMod.fScoreReductions.size(); ++r)
+                attach(col + "_" + fMod.fScoreReductions[r], &fReduced[m][r]);
+        }
+    }
+
+    // Read entry i of the input tree and compute every score
+    void Score(TTree& inTree, Long64_t i)
+    {
+        inTree.GetEntry(i);
+
+        // populate the scalar values from leaves (ROOT returns double; cast to float).
+        // GetValue(0) is the first element of an array unless it is read per object.
+        size_t nObj = std::numeric_limits<size_t>::max();
+        for (size_t u = 0; u < fLeaves.size(); ++u) {
+            if (fJagged[u]) nObj = std::min(nObj, fJagged[u]->size());
+            else            fValues[u] = static_cast<float>(fLeaves[u]->GetValue(0));
+        }
+
+        const auto& reductions = fMod.fScoreReductions;
+        for (size_t m = 0; m < fMod.fModels.size(); ++m) {
+            const Model& model = fMod.fModels[m];
+            TMVA::Reader& reader = *fScorer.readers[m];
+            TMVA::MethodBase* method = fScorer.methods[m];
+            auto& buf = fScorer.bufs[m];
+            for (size_t j = 0; j < model.vars.size(); ++j)
+                if (!fJagged[model.varIdx[j]]) buf[j] = fValues[model.varIdx[j]];
+
+            if (!fMod.fPerObject) {
+                fScore[m] = reader.EvaluateMVA(method);
+                continue;
+            }
+
+            // One evaluation per object over the flat per-event arrays;
+            // cost follows the object count
+            auto& sv = fScoresV[m];
+            sv.resize(nObj);
+            for (size_t k = 0; k < nObj; ++k) {
+                for (size_t j = 0; j < model.vars.size(); ++j)
+                    if (const auto* col = fJagged[model.varIdx[j]]) buf[j] = (*col)[k];
+                sv[k] = reader.EvaluateMVA(method);
+            }
+
+            const Kernels::RVecF view = sv.empty() ? Kernels::RVecF() : Kernels::RVecF(sv.data(), sv.size());
+            for (size_t r = 0; r < reductions.size(); ++r) {
+                if (reductions[r] == "leading") {
+                    const auto* by = fJagged[fLeadingIdx];
+                    const Kernels::RVecF rank = by->empty() ? Kernels::RVecF()
+                                                            : Kernels::RVecF(const_cast<float*>(by->data()), by->size());
+                    fReduced[m][r] = Kernels::LeadingBy(view, rank);
+                }
+                else {
+                    fReduced[m][r] = Kernels::FindReduction(reductions[r].c_str())(view, nullptr);
+                }
+            }
+            fScore[m] = fReduced[m][0];
+        }
+        fBdtScore = fScore[0];
+    }
+
+private:
+    const BDTEvalModule& fMod;
+    Scorer&              fScorer;
+    std::vector<TLeaf*>  fLeaves;                   // per fAllVars entry
+    std::vector<std::vector<float>*> fJagged;       // per fAllVars entry (+ LeadingBy); null = scalar
+    size_t               fLeadingIdx;
+    std::vector<float>   fValues;                   // scalar values of the current entry
+
+    // output buffers
+    float                fBdtScore = -999.f;
+    std::vector<float>   fScore;                    // per model
+    std::vector<std::vector<float>>  fScoresV;      // per model, per-object mode
+    std::vector<std::vector<float>*> fScoresPtr;
+    std::vector<std::vector<float>>  fReduced;      // per model and reduction
+};
+
 //---------------------------------------------
 BDTEvalModule::BDTEvalModule(const TEnv& cfg)
 : Module(cfg)
@@ -33,6 +236,13 @@ BDTEvalModule::BDTEvalModule(const TEnv& cfg)
 , fWeightsXML (cfg.GetValue("BDTEvalModule.WeightsXML", "dataset/weights/TMVAClassification_BDTG.weights.xml"))
 , fMethodName (cfg.GetValue("BDTEvalModule.MethodName", "BDTG"))
 , fOutputTag  (cfg.GetValue("BDTEvalModule.OutputTag",  "_bdt"))
+, fShard      (ShardSpec::FromConfig(cfg))
+, fCheckpointEntries(cfg.GetValue("Global.CheckpointEntries", 0))
+, fResume     (cfg.GetValue("Global.Resume", false))
+, fPerObject  (cfg.GetValue("BDTEvalModule.PerObject", 0) != 0)
+, fLeadingBy  (cfg.GetValue("BDTEvalModule.LeadingBy", ""))
+, fNThreads   (cfg.GetValue("BDTEvalModule.NThreads", 1))
+, fChunkEntries(cfg.GetValue("BDTEvalModule.ChunkEntries", 1000000))
 {
     // Input files: allow spaces and/or commas
     fInputFiles = split_ws_or_commas(cfg.GetValue("BDTEvalModule.InputFiles", ""));
@@ -43,10 +253,60 @@ BDTEvalModule::BDTEvalModule(const TEnv& cfg)
     if (fInputFiles.empty())
         throw std::runtime_error("[BDTEvalModule] No input files provided (BDTEvalModule.InputFiles).");
 
-    if (fEvalVars.empty())
-        throw std::runtime_error("[BDTEvalModule] No EvalVariables provided — must match training variables.");
+    // Models to score in the same pass: BDTEvalModule.Models a b, each with
+    // BDTEvalModule.Model.<a>.WeightsXML and optional .MethodName / .EvalVars
+    for (const auto& name : split_ws_or_commas(cfg.GetValue("BDTEvalModule.Models", ""))) {
+        const std::string key = "BDTEvalModule.Model." + name;
+        Model m;
+        m.name       = name;
+        m.column     = "bdt_score_" + name;
+        m.weightsXML = cfg.GetValue((key + ".WeightsXML").c_str(), "");
+        m.method     = cfg.GetValue((key + ".MethodName").c_str(), fMethodName.c_str());
+        m.vars       = split_ws_or_commas(cfg.GetValue((key + ".EvalVars").c_str(), ""));
+        if (m.vars.empty()) m.vars = fEvalVars;
+        if (m.weightsXML.empty())
+            throw std::runtime_error("[BDTEvalModule] No " + key + ".WeightsXML given.");
+        fModels.push_back(std::move(m));
+    }
+    if (fModels.empty()) {
+        Model m;
+        m.column     = "bdt_score";
+        m.weightsXML = fWeightsXML;
+        m.method     = fMethodName;
+        m.vars       = fEvalVars;
+        fModels.push_back(std::move(m));
+    }
+
+    for (auto& m : fModels) {
+        if (m.vars.empty())
+            throw std::runtime_error("[BDTEvalModule] No EvalVariables provided — must match training variables.");
+        for (const auto& v : m.vars) {
+            auto it = std::find(fAllVars.begin(), fAllVars.end(), v);
+            m.varIdx.push_back(static_cast<size_t>(it - fAllVars.begin()));
+            if (it == fAllVars.end()) fAllVars.push_back(v);
+        }
+    }
+
+    // Per-object mode: reductions of bdt_score_v, each written as bdt_score_<name>
+    fScoreReductions = split_ws_or_commas(cfg.GetValue("BDTEvalModule.ScoreReductions", "max"));
+    if (fPerObject) {
+        if (fScoreReductions.empty())
+            throw std::runtime_error("[BDTEvalModule] PerObject needs at least one ScoreReductions entry.");
+        for (const auto& r : fScoreReductions) {
+            if (r == "leading") {
+                if (fLeadingBy.empty())
+                    throw std::runtime_error("[BDTEvalModule] ScoreReductions leading needs BDTEvalModule.LeadingBy.");
+            }
+            else if (!Kernels::FindReduction(r.c_str())) {
+                throw std::runtime_error("[BDTEvalModule] Unknown score reduction: " + r);
+            }
+        }
+    }
 }
 
+//---------------------------------------------
+BDTEvalModule::~BDTEvalModule() = default;
+
 //---------------------------------------------
 std::vector<std::string> BDTEvalModule::TokeniseCSV(const std::string& s) {
     return split_ws_or_commas(s);
@@ -56,94 +316,116 @@ std::vector<std::string> BDTEvalModule::TokeniseCSV(const std::string& s) {
 Long64_t BDTEvalModule::EntryCount() const { return 1; }
 
 //---------------------------------------------
-void BDTEvalModule::ProcessOneFile(const std::string& inPath) const
+std::vector<std::string> BDTEvalModule::Inputs() const
+{
+    std::vector<std::string> in;
+    for (auto k : fShard.SelectFiles(fInputFiles.size())) in.push_back(fInputFiles[k]);
+    for (const auto& m : fModels) in.push_back(m.weightsXML);
+    return in;
+}
+
+//---------------------------------------------
+std::vector<std::string> BDTEvalModule::Outputs() const
+{
+    std::vector<std::string> out;
+    for (auto k : fShard.SelectFiles(fInputFiles.size())) out.push_back(OutputPathFor(fInputFiles[k]));
+    return out;
+}
+
+//---------------------------------------------
+std::string BDTEvalModule::OutputPathFor(const std::string& inPath) const
+{
+    std::string outPath = inPath;
+    auto pos = outPath.find_last_of('.');
+    if (pos == std::string::npos) outPath += fOutputTag + ".root";
+    else                          outPath.insert(pos, fOutputTag); // e.g. input.root -> input_bdt.root
+    return fShard.OutputName(outPath);
+}
+
+//---------------------------------------------
+static TTree* GetInputTree(TFile& inFile, const std::string& treeName, const std::string& inPath)
+{
+    // fetch tree (allow for directory path in treeName)
+    TObject* obj = inFile.Get(treeName.c_str());
+    if (!obj) {
+        throw std::runtime_error("[BDTEvalModule] Cannot find tree: " + treeName
+                                  + " in file " + inPath);
+    }
+    auto* inTree = dynamic_cast<TTree*>(obj);
+    if (!inTree) {
+        throw std::runtime_error("[BDTEvalModule] Object at " + treeName + " is not a TTree.");
+    }
+    return inTree;
+}
+
+//---------------------------------------------
+void BDTEvalModule::ProcessOneFile(const std::string& inPath)
 {
     // open input
-    std::cout << "Loop!" << std::endl;
     std::cout << "[BDTEvalModule] Opening input file: " << inPath << "\n";
     std::unique_ptr<TFile> inFile{TFile::Open(inPath.c_str(), "READ")};
     if (!inFile || inFile->IsZombie())
         throw std::runtime_error("[BDTEvalModule] Cannot open input file: " + inPath);
+    TTree* inTree = GetInputTree(*inFile, fTreeName, inPath);
 
-    // fetch tree (allow for directory path in fTreeName)
-    TTree* inTree = nullptr;
-    {
-        TObject* obj = inFile->Get(fTreeName.c_str());
-        if (!obj) {
-            throw std::runtime_error("[BDTEvalModule] Cannot find tree: " + fTreeName
-                                      + " in file " + inPath);
-        }
-        inTree = dynamic_cast<TTree*>(obj);
-        if (!inTree) {
-            throw std::runtime_error("[BDTEvalModule] Object at " + fTreeName + " is not a TTree.");
-        }
-    }
+    TreeScorer scorer(*this, *fScorer, *inTree, inPath);
 
-    // check variables exist and cache TLeaf*
-    std::vector<TLeaf*> leaves;
-    leaves.reserve(fEvalVars.size());
-    for (const auto& v : fEvalVars) {
-        // Try both leaf and (branch->leaf) name resolution
-        TLeaf* leaf = inTree->GetLeaf(v.c_str());
-        if (!leaf) {
-            // Some TTrees store leaves as "branch.leaf". Try to find by scanning all leaves.
-            bool found = false;
-            TObjArray* leafs = inTree->GetListOfLeaves();
-            for (int i = 0; i < leafs->GetEntries(); ++i) {
-                auto* L = static_cast<TLeaf*>(leafs->At(i));
-                if (std::string(L->GetName()) == v) { leaf = L; found = true; break; }
-            }
-            if (!found) {
-                std::ostringstream msg;
-                msg << "[BDTEvalModule] Missing variable leaf '" << v
-                    << "' in tree '" << fTreeName << "' (file " << inPath << ").";
-                throw std::runtime_error(msg.str());
-            }
-        }
-        leaves.push_back(leaf);
-    }
+    // output file name
+    const std::string outPath = OutputPathFor(inPath);
+    const auto [firstEntry, lastEntry] = fShard.EntryRange(inTree->GetEntries());
+    const Long64_t nEntries = lastEntry - firstEntry;
 
-    // prepare TMVA::Reader with float buffers (kept in scope)
-    TMVA::Reader reader("!Color:!Silent");
-    std::vector<float> varBuf(fEvalVars.size(), 0.f);
-    for (size_t i = 0; i < fEvalVars.size(); ++i) {
-        reader.AddVariable(fEvalVars[i].c_str(), &varBuf[i]);
+    // With checkpointing, progress is journalled next to the output (see Framework/Checkpoint.hxx)
+    const bool checkpointing = fCheckpointEntries > 0;
+    Checkpoint journal(outPath, fResume && checkpointing);
+    const bool resuming = checkpointing && fResume && journal.LastCommitted() >= 0
+                          && !gSystem->AccessPathName(outPath.c_str());
+    if (resuming && journal.IsComplete()) {
+        std::cout << "[BDTEvalModule] " << outPath << " already complete, skipping.\n";
+        return;
     }
 
-    // book MVA
-    reader.BookMVA(fMethodName.c_str(), fWeightsXML.c_str());
-
-    // output file name
-    std::string outPath = inPath;
-    auto pos = outPath.find_last_of('.');
-    if (pos == std::string::npos) outPath += fOutputTag + ".root";
-    else                          outPath.insert(pos, fOutputTag); // e.g. input.root -> input_bdt.root
-
-    std::unique_ptr<TFile> outFile{TFile::Open(outPath.c_str(), "RECREATE")};
+    std::unique_ptr<TFile> outFile{TFile::Open(outPath.c_str(), resuming ? "UPDATE" : "RECREATE")};
     if (!outFile || outFile->IsZombie())
         throw std::runtime_error("[BDTEvalModule] Cannot create output file: " + outPath);
 
-    // clone tree structure and add bdt_score branch
     outFile->cd();
-    std::unique_ptr<TTree> outTree{inTree->CloneTree(0)};
-    float bdt_score = -999.f;
-    TBranch* brScore = outTree->Branch("bdt_score", &bdt_score, "bdt_score/F");
-
-    // main loop
-    const Long64_t nEntries = inTree->GetEntries();
-    for (Long64_t i = 0; i < nEntries; ++i) {
-        inTree->GetEntry(i);
-
-        // populate var buffers from leaves (ROOT returns double; cast to float)
-        for (size_t j = 0; j < leaves.size(); ++j) {
-            // GetValue(0) handles both scalar and first element of arrays; if your
-            // variables are arrays, change to GetValue(index) as needed.
-            varBuf[j] = static_cast<float>(leaves[j]->GetValue(0));
-        }
+    std::unique_ptr<TTree> outTree;
+    Long64_t startEntry = firstEntry;
+    if (resuming) {
+        // The tree as of its last AutoSave is what is safely on disk; carry on after it
+        outTree.reset(outFile->Get<TTree>(inTree->GetName()));
+        if (!outTree)
+            throw std::runtime_error("[BDTEvalModule] Cannot resume, no tree in " + outPath);
+        inTree->CopyAddresses(outTree.get());
+        scorer.Attach(*outTree, true);
+        startEntry = firstEntry + outTree->GetEntries();
+        if (startEntry != journal.LastCommitted())
+            std::cout << "[BDTEvalModule] Note: journal at entry " << journal.LastCommitted()
+                      << ", output holds up to " << startEntry << "; using the output.\n";
+        std::cout << "[BDTEvalModule] Resuming " << outPath << " at entry " << startEntry << "\n";
+    }
+    else {
+        // clone tree structure and add the score branches
+        outTree.reset(inTree->CloneTree(0));
+        scorer.Attach(*outTree, false);
+    }
 
-        bdt_score = reader.EvaluateMVA(fMethodName.c_str());
-        brScore->Fill();
-        outTree->Fill(); // copies all original branches + our new one
+    // main loop, over this shard's entry range only, committing at cluster
+    // boundaries once at least fCheckpointEntries entries have been added
+    const auto chunks = checkpointing
+        ? Checkpoint::ClusterChunks(*inTree, startEntry, lastEntry, fCheckpointEntries)
+        : std::vector<std::pair<Long64_t, Long64_t>>{{startEntry, lastEntry}};
+    for (const auto& [chunkBegin, chunkEnd] : chunks) {
+        for (Long64_t i = chunkBegin; i < chunkEnd; ++i) {
+            scorer.Score(*inTree, i);
+            outTree->Fill(); // copies all original branches + our new ones
+        }
+        if (checkpointing) {
+            // Flush baskets and write the tree header, then record the progress
+            outTree->AutoSave("SaveSelf FlushBaskets");
+            journal.Commit(chunkEnd);
+        }
     }
 
     outTree->Write("", TObject::kOverwrite);
@@ -153,26 +435,153 @@ void BDTEvalModule::ProcessOneFile(const std::string& inPath) const
 
     outFile->Write();
     outFile->Close();
+    if (checkpointing) journal.MarkComplete();
 
     std::cout << "[BDTEvalModule] Wrote: " << outPath
               << "  (entries: " << nEntries << ")\n";
 }
 
+//---------------------------------------------
+void BDTEvalModule::ProcessParallel(const std::vector<std::string>& inPaths)
+{
+    // Work items are cluster-aligned entry ranges of every file, largest
+    // files first so the tail is short. Each output is a TBufferMerger fed by
+    // the ranges of its input; entries of different ranges may be written in
+    // any order.
+    struct Item {
+        size_t   file;
+        Long64_t begin, end;
+    };
+    std::vector<Item> items;
+    std::vector<Long64_t> fileEntries(inPaths.size(), 0);
+    for (size_t f = 0; f < inPaths.size(); ++f) {
+        std::unique_ptr<TFile> inFile{TFile::Open(inPaths[f].c_str(), "READ")};
+        if (!inFile || inFile->IsZombie())
+            throw std::runtime_error("[BDTEvalModule] Cannot open input file: " + inPaths[f]);
+        TTree* inTree = GetInputTree(*inFile, fTreeName, inPaths[f]);
+        const auto [first, last] = fShard.EntryRange(inTree->GetEntries());
+        fileEntries[f] = last - first;
+        for (const auto& [b, e] : Checkpoint::ClusterChunks(*inTree, first, last, fChunkEntries))
+            items.push_back({f, b, e});
+    }
+    std::stable_sort(items.begin(), items.end(), [&](const Item& a, const Item& b) {
+        return fileEntries[a.file] > fileEntries[b.file];
+    });
+
+    ROOT::EnableThreadSafety();
+    std::vector<std::unique_ptr<ROOT::TBufferMerger>> mergers;
+    for (const auto& in : inPaths)
+        mergers.push_back(std::make_unique<ROOT::TBufferMerger>(OutputPathFor(in).c_str(), "RECREATE"));
+
+    const int nWorkers = std::max(1, std::min<int>(fNThreads, static_cast<int>(items.size())));
+    std::cout << "[BDTEvalModule] Scoring " << inPaths.size() << " file(s) in " << items.size()
+              << " range(s) on " << nWorkers << " thread(s)\n";
+
+    std::atomic<size_t> next{0};
+    std::mutex mtx;
+    std::vector<std::string> errors;
+    auto worker = [&]() {
+        try {
+            Scorer scorer(fModels);    // this thread's readers
+            for (size_t k = next++; k < items.size(); k = next++) {
+                const Item& item = items[k];
+                const std::string& inPath = inPaths[item.file];
+                std::unique_ptr<TFile> inFile{TFile::Open(inPath.c_str(), "READ")};
+                if (!inFile || inFile->IsZombie())
+                    throw std::runtime_error("[BDTEvalModule] Cannot open input file: " + inPath);
+                TTree* inTree = GetInputTree(*inFile, fTreeName, inPath);
+                TreeScorer ts(*this, scorer, *inTree, inPath);
+
+                // The range's tree belongs to its merger file, which is sent
+                // to the output on Write and destroyed before the input closes
+                auto outFile = mergers[item.file]->GetFile();
+                outFile->cd();
+                TTree* outTree = inTree->CloneTree(0);
+                ts.Attach(*outTree, false);
+                for (Long64_t i = item.begin; i < item.end; ++i) {
+                    ts.Score(*inTree, i);
+                    outTree->Fill();
+                }
+                outFile->Write();
+            }
+        }
+        catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(mtx);
+            errors.emplace_back(e.what());
+            next = items.size();   // stop the other workers early
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int w = 0; w < nWorkers; ++w) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+    mergers.clear();   // flushes and closes the outputs
+
+    for (const auto& e : errors) std::cerr << e << "\n";
+    if (!errors.empty())
+        throw std::runtime_error("[BDTEvalModule] " + std::to_string(errors.size()) + " worker(s) failed.");
+
+    for (size_t f = 0; f < inPaths.size(); ++f)
+        std::cout << "[BDTEvalModule] Wrote: " << OutputPathFor(inPaths[f])
+                  << "  (entries: " << fileEntries[f] << ")\n";
+}
+
+//---------------------------------------------
+void BDTEvalModule::LoadModels()
+{
+    // Each weights file is read once here, not once per input file or thread
+    for (auto& m : fModels) {
+        std::ifstream in(m.weightsXML);
+        if (!in)
+            throw std::runtime_error("[BDTEvalModule] Cannot read weights file: " + m.weightsXML);
+        std::ostringstream text;
+        text << in.rdbuf();
+        m.xml = text.str();
+
+        // <MethodSetup Method="BDT::BDTG"> names the method type
+        const auto pos = m.xml.find("Method=\"");
+        const auto sep = pos == std::string::npos ? pos : m.xml.find("::", pos);
+        if (sep == std::string::npos)
+            throw std::runtime_error("[BDTEvalModule] No method type in weights file: " + m.weightsXML);
+        m.type = m.xml.substr(pos + 8, sep - pos - 8);
+    }
+}
+
 //---------------------------------------------
 void BDTEvalModule::Initialise() {
-    std::cout << "[BDTEvalModule] Using weights xml: " << fWeightsXML << "\n";
-    std::cout << "[BDTEvalModule] Method: " << fMethodName << "\n";
     std::cout << "[BDTEvalModule] Tree: " << fTreeName << "\n";
-    std::cout << "[BDTEvalModule] Variables (" << fEvalVars.size() << "): ";
-    for (auto& v : fEvalVars) std::cout << v << " ";
-    std::cout << "\n";
+    for (const auto& m : fModels) {
+        std::cout << "[BDTEvalModule] " << m.column << ": " << m.method << " (" << m.weightsXML << "), variables ("
+                  << m.vars.size() << "): ";
+        for (auto& v : m.vars) std::cout << v << " ";
+        std::cout << "\n";
+    }
+    LoadModels();
+    if (PreviewSpec::FromConfig(Cfg()).Active())
+        std::cout << "[BDTEvalModule] Global.Preview ignored: scored ntuples are always written in full\n";
 
-    for (const auto& f : fInputFiles) {
-        std::cout << "[BDTEvalModule] Will loop over input file: " << f << "\n";
+    const auto selected = fShard.SelectFiles(fInputFiles.size());
+    for (auto k : selected) {
+        std::cout << "[BDTEvalModule] Will loop over input file: " << fInputFiles[k] << "\n";
     }
-    for (const auto& f : fInputFiles) {
-        std::cout << "[BDTEvalModule] Processing: " << f << "\n";
-        ProcessOneFile(f);
+
+    // Checkpointed runs commit one output at a time, so they stay serial
+    const bool parallel = fNThreads > 1 && fCheckpointEntries <= 0 && !fResume;
+    if (fNThreads > 1 && !parallel)
+        std::cout << "[BDTEvalModule] Checkpointing/resume is on; scoring files one at a time.\n";
+
+    if (parallel) {
+        std::vector<std::string> paths;
+        for (auto k : selected) paths.push_back(fInputFiles[k]);
+        ProcessParallel(paths);
+    }
+    else {
+        fScorer = std::make_unique<Scorer>(fModels);
+        for (auto k : selected) {
+            const auto& f = fInputFiles[k];
+            std::cout << "[BDTEvalModule] Processing: " << f << "\n";
+            ProcessOneFile(f);
+        }
     }
     std::cout << "[BDTEvalModule] Done.\n";
 }
@@ -180,4 +589,4 @@ void BDTEvalModule::Initialise() {
 //---------------------------------------------
 void BDTEvalModule::Finalise() {
     // Nothing to do
-}
\ No newline at end of file
+}
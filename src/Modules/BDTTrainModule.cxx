@@ -1,5 +1,8 @@
 #include "Modules/BDTTrainModule.hxx"
 #include "Utils/Plotter.hxx"
+#include "Framework/Sharding.hxx"
+#include "Framework/Preview.hxx"
+#include "Utils/RocCurve.hxx"
 
 #include <TEnv.h>
 #include <TFile.h>
@@ -14,10 +17,12 @@
 #include <TTree.h>
 #include <TH1D.h>
 #include <TChain.h>
+#include <chrono>
 #include <cstdio>
 
 #include <TMVA/Factory.h>
 #include <TMVA/DataLoader.h>
+#include <TMVA/Reader.h>
 #include <TMVA/Tools.h>
 
 using namespace Analysis;
@@ -27,6 +32,9 @@ BDTTrainModule::BDTTrainModule(const TEnv& cfg)
     : Module(cfg)
     , fTreeName   (cfg.GetValue("BDTTrainModule.TreeName", "nuselection/NeutrinoSelectionFilter"))
     , fTrainFraction(cfg.GetValue("BDTTrainModule.TrainFraction", 0.8f))
+    , fDatasetName(cfg.GetValue("BDTTrainModule.DatasetName", "dataset"))
+    , fJobName    (cfg.GetValue("BDTTrainModule.JobName", "TMVAClassification"))
+    , fMethodName (cfg.GetValue("BDTTrainModule.MethodName", "BDTG"))
 {
 
     std::stringstream ssInput{cfg.GetValue("BDTTrainModule.InputFiles", "")};
@@ -62,6 +70,12 @@ BDTTrainModule::BDTTrainModule(const TEnv& cfg)
     while (ssWeights >> weight) {
         fSampleWeights.push_back(weight);
     }
+
+    std::stringstream ssEffB{cfg.GetValue("BDTTrainModule.BkgEfficiencies", "0.01 0.1")};
+    double effB;
+    while (ssEffB >> effB) {
+        fBkgEfficiencies.push_back(effB);
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -199,6 +213,19 @@ BDTTrainModule::BuildTestTrainSamples(std::vector<ROOT::RDF::RNode> dfs,
     return {train_signal_File, train_bkg_File, test_signal_File, test_bkg_File};
 }
 
+//------------------------------------------------------------------------------
+EventMatrix BDTTrainModule::LoadTestMatrix(const std::string& testSignalFile,
+                                           const std::string& testBkgFile) const
+{
+    // Read once; every trial scores the same rows
+    EventMatrix m;
+    m.vars = fTrainVars;
+    m.Append(testSignalFile, "tree", "sample_weight", true);
+    m.Append(testBkgFile,    "tree", "sample_weight", false);
+    std::cout << "[BDTTrainModule] Loaded " << m.Size() << " test events for in-process ROC evaluation\n";
+    return m;
+}
+
 std::string BDTTrainModule::BuildMethodString(int nTrees,
                                       int maxDepth,
                                       double learningRate,
@@ -227,6 +254,7 @@ std::string BDTTrainModule::FindOptimalCut(const std::string& trainSignalFile,
     //Takes a range of possible hyperparameters and finds the optimal set based on test sample performance,
     // returning a string suitable for TMVA::Factory::BookMethod 
     std::string bestMethodString;
+    const EventMatrix test = LoadTestMatrix(testSignalFile, testBkgFile);
 
     // Loop over all combinations of hyperparameters
     double bestScore = -1.0;
@@ -238,7 +266,7 @@ std::string BDTTrainModule::FindOptimalCut(const std::string& trainSignalFile,
                     for (const auto& nCuts : nCutsVec) {
                         std::string methodString = BuildMethodString(nTrees, maxDepth, learningRate, minNodeSize, nCuts);
                         // Train BDT with these hyperparameters
-                        double score = TrainBDT(trainSignalFile, trainBkgFile, testSignalFile, testBkgFile, methodString);
+                        double score = TrainBDT(trainSignalFile, trainBkgFile, testSignalFile, testBkgFile, methodString, &test);
                         // Evaluate performance on test set, e.g. via AUC or significance
                         if (score > bestScore) {
                             bestScore = score;
@@ -301,7 +329,8 @@ double BDTTrainModule::TrainBDT(const std::string& trainSignalFile,
                               const std::string& trainBkgFile,
                               const std::string& testSignalFile,
                               const std::string& testBkgFile,
-                              std::string methodString) const
+                              std::string methodString,
+                              const EventMatrix* test) const
 {
     //Trains the BDT and returns a figure of merit (e.g. ROC) on the test set.
     // Build chains so we can control the split with SplitMode=Block
@@ -344,13 +373,18 @@ double BDTTrainModule::TrainBDT(const std::string& trainSignalFile,
         if (tProbe && tProbe->GetBranch("sample_weight")) hasSampleWeight = true;
     }
 
-    // TMVA setup
+    // TMVA setup. Trials scored in process write no TMVA output file.
     TMVA::Tools::Instance();
-    std::unique_ptr<TFile> outFile{TFile::Open("tmva_training_output.root", "RECREATE")};
+    std::unique_ptr<TFile> outFile;
+    if (!test) outFile.reset(TFile::Open("tmva_training_output.root", "RECREATE"));
 
-    TMVA::Factory factory("TMVAClassification", outFile.get(),
-                          "!V:!Silent:Color:DrawProgressBar:AnalysisType=Classification");
-    TMVA::DataLoader loader("dataset");
+    auto factoryPtr = test
+        ? std::make_unique<TMVA::Factory>(fJobName,
+                                          "!V:Silent:Color:!DrawProgressBar:AnalysisType=Classification")
+        : std::make_unique<TMVA::Factory>(fJobName, outFile.get(),
+                                          "!V:!Silent:Color:DrawProgressBar:AnalysisType=Classification");
+    TMVA::Factory& factory = *factoryPtr;
+    TMVA::DataLoader loader(fDatasetName.c_str());
 
     // Register training variables from fTrainVars
     std::cout << "[BDTTrainModule] Registering training variables:\n";
@@ -380,17 +414,45 @@ double BDTTrainModule::TrainBDT(const std::string& trainSignalFile,
     // Book a simple BDTG. You can later move these options into the TEnv cfg.
     //"!H:!V:NTrees=200:MinNodeSize=2.5%:MaxDepth=3:BoostType=Grad:"
                        //"Shrinkage=0.1:nCuts=20"
-    factory.BookMethod(&loader, TMVA::Types::kBDT, "BDTG",
+    factory.BookMethod(&loader, TMVA::Types::kBDT, fMethodName.c_str(),
                          methodString.c_str());
 
+    const auto t0 = std::chrono::steady_clock::now();
     factory.TrainAllMethods();
+    const auto t1 = std::chrono::steady_clock::now();
+
+    if (test) {
+        // Score the in-memory test rows with the weights just written
+        const std::size_t nVars = fTrainVars.size();
+        std::vector<float> row(nVars);
+        TMVA::Reader reader("!Color:Silent");
+        for (std::size_t k = 0; k < nVars; ++k) reader.AddVariable(fTrainVars[k].c_str(), &row[k]);
+        reader.BookMVA(fMethodName.c_str(), WeightsXML().c_str());
+
+        const std::size_t n = test->Size();
+        std::vector<float> score(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            std::copy_n(test->Row(i), nVars, row.begin());
+            score[i] = static_cast<float>(reader.EvaluateMVA(fMethodName.c_str()));
+        }
+        const RocCurve roc(score, test->weights, test->isSignal);
+        const auto t2 = std::chrono::steady_clock::now();
+
+        std::cout << "[BDTTrainModule] AUC = " << roc.AUC();
+        for (double effB : fBkgEfficiencies)
+            std::cout << ", effS(effB=" << effB << ") = " << roc.SignalEfficiencyAt(effB);
+        std::cout << "  (train " << std::chrono::duration<double>(t1 - t0).count() << " s, evaluate "
+                  << std::chrono::duration<double>(t2 - t1).count() << " s)" << std::endl;
+        return roc.AUC();
+    }
+
     factory.TestAllMethods();
     factory.EvaluateAllMethods();
     // Retrieve a figure of merit on the test set
-    double fom = factory.GetROCIntegral(&loader, "BDTG", /*iClass=*/0, TMVA::Types::kTesting);
+    double fom = factory.GetROCIntegral(&loader, fMethodName.c_str(), /*iClass=*/0, TMVA::Types::kTesting);
     return fom;
 
-    // XML weights will be in: dataset/weights/TMVAClassification_BDTG.weights.xml
+    // XML weights will be in WeightsXML()
 }
 
 
@@ -403,6 +465,12 @@ Long64_t BDTTrainModule::EntryCount() const
 //------------------------------------------------------------------------------
 void BDTTrainModule::Initialise()
 {
+    // Training needs the full sample in one process
+    if (ShardSpec::FromConfig(Cfg()).Active())
+        throw std::runtime_error("[BDTTrainModule] Cannot run sharded - run the training unsharded on the merged files.");
+    if (PreviewSpec::FromConfig(Cfg()).Active())
+        std::cout << "[BDTTrainModule] Global.Preview ignored: training always uses the full sample\n";
+
     auto dfVec = BuildDataFrames(fInputFiles, fTreeName);
 
     std::vector<ROOT::RDF::RNode> nodes;
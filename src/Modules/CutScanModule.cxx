@@ -0,0 +1,247 @@
+#include "Modules/CutScanModule.hxx"
+#include "Utils/Plotter.hxx"
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RDFHelpers.hxx>
+#include <TFile.h>
+#include <TH1D.h>
+#include <TH2D.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+namespace {
+
+std::vector<double> ParseRange(const TEnv& cfg, const char* key)
+{
+    std::vector<double> range;
+    std::stringstream ss{cfg.GetValue(key, "")};
+    double v;
+    while (ss >> v) range.push_back(v);
+    if (!range.empty() && (range.size() != 2 || !(range[1] > range[0])))
+        throw std::runtime_error(std::string("[CutScan] ") + key + " must be \"min max\" with max > min");
+    return range;
+}
+
+std::pair<double, double> MinMax(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double lo = 0., hi = 0.;
+    bool any = false;
+    for (const auto* v : {&a, &b}) {
+        if (v->empty()) continue;
+        const auto [mn, mx] = std::minmax_element(v->begin(), v->end());
+        lo  = any ? std::min(lo, *mn) : *mn;
+        hi  = any ? std::max(hi, *mx) : *mx;
+        any = true;
+    }
+    return {lo, hi};
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+CutScanModule::CutScanModule(const TEnv& cfg)
+    : Module(cfg)
+    , fTreeName     (cfg.GetValue("CutScan.TreeName", "nuselection/NeutrinoSelectionFilter"))
+    , fVariable     (cfg.GetValue("CutScan.Variable", "bdt_score"))
+    , fYVariable    (cfg.GetValue("CutScan.YVariable", ""))
+    , fSelection    (cfg.GetValue("CutScan.Selection", ""))
+    , fNThresholds  (cfg.GetValue("CutScan.NThresholds", 10000))
+    , fNThresholds2D(cfg.GetValue("CutScan.NThresholds2D", 200))
+    , fRange        (ParseRange(cfg, "CutScan.Range"))
+    , fYRange       (ParseRange(cfg, "CutScan.YRange"))
+    , fFoM          (CutScan::ParseFoM(cfg.GetValue("CutScan.FigureOfMerit", "asimov")))
+    , fPunziSigma   (cfg.GetValue("CutScan.PunziSigma", 5.0))
+    , fOutputFile   (cfg.GetValue("CutScan.OutputFile", "cut_scan.root"))
+{
+    std::stringstream ssInput{cfg.GetValue("CutScan.InputFiles", "")};
+    std::string item;
+    while (ssInput >> item) {
+        if (item.back()==',') item.pop_back();
+        fInputFiles.push_back(item);
+    }
+
+    std::stringstream ssLabels{cfg.GetValue("CutScan.SampleLabels", "")};
+    while (ssLabels >> item) {
+        if (item.back()==',') item.pop_back();
+        fSampleLabels.push_back(item);
+    }
+
+    std::stringstream ssWeights{cfg.GetValue("CutScan.SampleWeights", "")};
+    double weight;
+    while (ssWeights >> weight) {
+        fSampleWeights.push_back(weight);
+    }
+
+    std::stringstream ssWeightCols{cfg.GetValue("CutScan.SampleWeightColumns", "")};
+    while (ssWeightCols >> item) {
+        if (item.back()==',') item.pop_back();
+        fSampleWeightColumns.push_back(item == "-" ? "" : item);
+    }
+
+    if (fInputFiles.empty())
+        throw std::runtime_error("[CutScan] No CutScan.InputFiles given.");
+    if (fSampleLabels.size() != fInputFiles.size())
+        throw std::runtime_error("[CutScan] CutScan.SampleLabels needs one label per input file.");
+    if (fNThresholds < 1 || fNThresholds2D < 1)
+        throw std::runtime_error("[CutScan] CutScan.NThresholds must be positive.");
+}
+
+//------------------------------------------------------------------------------
+std::pair<ScoredEvents, ScoredEvents> CutScanModule::Extract() const
+{
+    // Each sample is booked lazily, then all of them run together
+    std::vector<std::unique_ptr<ROOT::RDataFrame>> frames;
+    std::vector<ROOT::RDF::RResultPtr<std::vector<double>>> xs, ys, ws;
+    std::vector<ROOT::RDF::RResultHandle> handles;
+    std::vector<bool> isSignal;
+
+    for (std::size_t i = 0; i < fInputFiles.size(); ++i) {
+        std::string lower = fSampleLabels[i];
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower.find("data") != std::string::npos) continue;
+        isSignal.push_back(lower.find("signal") != std::string::npos);
+
+        frames.push_back(std::make_unique<ROOT::RDataFrame>(fTreeName, fInputFiles[i]));
+        ROOT::RDF::RNode node = *frames.back();
+        if (!fSelection.empty()) node = node.Filter(fSelection, "CutScan.Selection");
+
+        const std::string weightExpr = i < fSampleWeightColumns.size() ? fSampleWeightColumns[i] : "";
+        const double      scale      = i < fSampleWeights.size() ? fSampleWeights[i] : 1.0;
+        std::string weightCol = Plotter::WeightColumn(node, "cutscan_" + fSampleLabels[i], weightExpr, scale);
+        if (weightCol.empty()) {
+            weightCol = "cutscan_unit_weight";
+            node = node.Define(weightCol, "1.0");
+        }
+
+        node = node.Define("cutscan_x", "static_cast<double>(" + fVariable + ")");
+        xs.push_back(node.Take<double>("cutscan_x"));
+        ws.push_back(node.Take<double>(weightCol));
+        handles.emplace_back(xs.back());
+        handles.emplace_back(ws.back());
+        if (!fYVariable.empty()) {
+            node = node.Define("cutscan_y", "static_cast<double>(" + fYVariable + ")");
+            ys.push_back(node.Take<double>("cutscan_y"));
+            handles.emplace_back(ys.back());
+        }
+    }
+    if (handles.empty())
+        throw std::runtime_error("[CutScan] Only data samples given; nothing to scan.");
+    ROOT::RDF::RunGraphs(handles);
+
+    ScoredEvents sig, bkg;
+    for (std::size_t k = 0; k < xs.size(); ++k) {
+        ScoredEvents ev;
+        ev.x = std::move(*xs[k]);
+        ev.w = std::move(*ws[k]);
+        if (!ys.empty()) ev.y = std::move(*ys[k]);
+        (isSignal[k] ? sig : bkg).Append(ev);
+    }
+    return {std::move(sig), std::move(bkg)};
+}
+
+//------------------------------------------------------------------------------
+void CutScanModule::Initialise()
+{
+    auto t0 = std::chrono::steady_clock::now();
+    auto [sig, bkg] = Extract();
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "[CutScan] Read " << sig.Size() << " signal and " << bkg.Size()
+              << " background events in " << std::chrono::duration<double>(t1 - t0).count() << " s\n";
+    if (sig.Size() == 0)
+        throw std::runtime_error("[CutScan] No signal events; a signal sample label must contain \"signal\".");
+
+    // Default cut ranges span the events
+    std::vector<double> yRange = fYRange;
+    if (!fYVariable.empty() && yRange.empty()) {
+        const auto [lo, hi] = MinMax(sig.y, bkg.y);
+        yRange = {lo, hi};
+    }
+    const CutScan scan(std::move(sig), std::move(bkg));
+    std::vector<double> range = fRange;
+    if (range.empty()) {
+        const auto [lo, hi] = scan.Range();
+        range = {lo, hi};
+    }
+
+    const bool twoD = !fYVariable.empty();
+    const int  nX   = twoD ? fNThresholds2D : fNThresholds;
+    const auto cutsX = CutScan::Thresholds(nX, range[0], range[1]);
+
+    auto out = std::unique_ptr<TFile>(TFile::Open(fOutputFile.c_str(), "RECREATE"));
+    if (!out || out->IsZombie())
+        throw std::runtime_error("[CutScan] Cannot create " + fOutputFile);
+
+    const CutScan::Point* best = nullptr;
+    std::vector<CutScan::Point> points;
+    t0 = std::chrono::steady_clock::now();
+    if (!twoD) {
+        points = scan.Scan(cutsX, fFoM, fPunziSigma);
+        t1 = std::chrono::steady_clock::now();
+
+        // Bin i starts at threshold i: its content is the yield passing that cut
+        TH1D hS("cut_scan_s", (";" + fVariable + " cut;Signal passing").c_str(), nX, range[0], range[1]);
+        TH1D hB("cut_scan_b", (";" + fVariable + " cut;Background passing").c_str(), nX, range[0], range[1]);
+        TH1D hF("cut_scan_fom", (";" + fVariable + " cut;Figure of merit").c_str(), nX, range[0], range[1]);
+        for (int i = 0; i < nX; ++i) {
+            const auto& p = points[i];
+            hS.SetBinContent(i + 1, p.s);
+            hB.SetBinContent(i + 1, p.b);
+            hB.SetBinError(i + 1, std::sqrt(p.sumw2B));
+            hF.SetBinContent(i + 1, p.fom);
+        }
+        out->cd();
+        hS.Write();
+        hB.Write();
+        hF.Write();
+        Plotter::SaveHist(&hF, "cut_scan_fom");
+    }
+    else {
+        if (yRange.size() != 2 || !(yRange[1] > yRange[0]))
+            throw std::runtime_error("[CutScan] Empty range of " + fYVariable + "; set CutScan.YRange.");
+        const auto cutsY = CutScan::Thresholds(fNThresholds2D, yRange[0], yRange[1]);
+        points = scan.Scan2D(cutsX, cutsY, fFoM, fPunziSigma);
+        t1 = std::chrono::steady_clock::now();
+
+        const std::string axes = ";" + fVariable + " cut;" + fYVariable + " cut";
+        TH2D hF("cut_scan_fom_2d", (axes + ";Figure of merit").c_str(),
+                nX, range[0], range[1], fNThresholds2D, yRange[0], yRange[1]);
+        TH2D hS("cut_scan_s_2d", (axes + ";Signal passing").c_str(),
+                nX, range[0], range[1], fNThresholds2D, yRange[0], yRange[1]);
+        TH2D hB("cut_scan_b_2d", (axes + ";Background passing").c_str(),
+                nX, range[0], range[1], fNThresholds2D, yRange[0], yRange[1]);
+        for (int ix = 0; ix < nX; ++ix) {
+            for (int iy = 0; iy < fNThresholds2D; ++iy) {
+                const auto& p = points[ix * fNThresholds2D + iy];
+                hS.SetBinContent(ix + 1, iy + 1, p.s);
+                hB.SetBinContent(ix + 1, iy + 1, p.b);
+                hF.SetBinContent(ix + 1, iy + 1, p.fom);
+            }
+        }
+        out->cd();
+        hS.Write();
+        hB.Write();
+        hF.Write();
+        Plotter::SaveHist(&hF, "cut_scan_fom_2d");
+    }
+    out->Close();
+
+    for (const auto& p : points)
+        if (!best || p.fom > best->fom) best = &p;
+
+    std::cout << "[CutScan] Scanned " << points.size() << " cuts in "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n"
+              << "[CutScan] Best: " << fVariable << " > " << best->cut;
+    if (twoD) std::cout << ", " << fYVariable << " > " << best->cutY;
+    std::cout << "  s = " << best->s << "  b = " << best->b << " +- " << std::sqrt(best->sumw2B)
+              << "  FoM = " << best->fom << " (of total s = " << scan.TotalSignal()
+              << ", b = " << scan.TotalBackground() << ")\n";
+}
@@ -0,0 +1,162 @@
+#include "Modules/EventLookupModule.hxx"
+
+#include <TFile.h>
+#include <TNamed.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+//------------------------------------------------------------------------------
+EventLookupModule::EventLookupModule(const TEnv& cfg)
+    : Module(cfg)
+    , fTreeName   (cfg.GetValue("EventLookup.TreeName", "nuselection/NeutrinoSelectionFilter"))
+    , fOutputFile (cfg.GetValue("EventLookup.OutputFile", ""))
+    , fMatchOutput(cfg.GetValue("EventLookup.MatchOutput", ""))
+{
+    std::string item;
+    std::stringstream ssFiles{cfg.GetValue("EventLookup.Files", "")};
+    while (ssFiles >> item) {
+        if (item.back()==',') item.pop_back();
+        fFiles.push_back(item);
+    }
+
+    std::stringstream ssMatch{cfg.GetValue("EventLookup.MatchFiles", "")};
+    while (ssMatch >> item) {
+        if (item.back()==',') item.pop_back();
+        fMatchFiles.push_back(item);
+    }
+
+    std::stringstream ssKeys{cfg.GetValue("Global.EventIndexColumns", "run sub evt")};
+    while (ssKeys >> item) {
+        if (item.back()==',') item.pop_back();
+        fKeyColumns.push_back(item);
+    }
+
+    std::stringstream ssEvents{cfg.GetValue("EventLookup.Events", "")};
+    while (ssEvents >> item) {
+        if (item.back()==',') item.pop_back();
+        fEvents.push_back(EventKey::Parse(item));
+    }
+
+    const std::string list = cfg.GetValue("EventLookup.EventList", "");
+    if (!list.empty()) {
+        std::ifstream in(list);
+        if (!in) throw std::runtime_error("[EventLookup] Cannot open " + list);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            fEvents.push_back(EventKey::Parse(line));
+        }
+    }
+
+    if (fFiles.empty())
+        throw std::runtime_error("[EventLookup] No EventLookup.Files given.");
+    if (fEvents.empty() && fMatchFiles.empty())
+        throw std::runtime_error("[EventLookup] Nothing to do: give EventLookup.Events/EventList or MatchFiles.");
+}
+
+//------------------------------------------------------------------------------
+EventIndex EventLookupModule::LoadIndex(const std::vector<std::string>& files) const
+{
+    namespace fs = std::filesystem;
+    EventIndex merged;
+    for (const auto& file : files) {
+        const std::string sidecar = EventIndex::SidecarPath(file);
+        std::error_code ec;
+        const bool fresh = fs::exists(sidecar, ec)
+                           && fs::last_write_time(sidecar, ec) >= fs::last_write_time(file, ec) && !ec;
+        if (!fresh) {
+            std::cout << "[EventLookup] Indexing " << file << "\n";
+            EventIndex::WriteSidecar(file, fTreeName, fKeyColumns);
+        }
+        merged.Merge(EventIndex::Read(sidecar));
+    }
+    return merged;
+}
+
+//------------------------------------------------------------------------------
+void EventLookupModule::Extract(const std::vector<EventIndex::Location>& locs) const
+{
+    std::map<std::string, std::vector<long long>> byFile;
+    for (const auto& l : locs) byFile[l.file].push_back(l.entry);
+
+    std::unique_ptr<TFile> out{TFile::Open(fOutputFile.c_str(), "RECREATE")};
+    if (!out || out->IsZombie())
+        throw std::runtime_error("[EventLookup] Cannot create " + fOutputFile);
+
+    int k = 0;
+    for (auto& [file, entries] : byFile) {
+        std::unique_ptr<TFile> in{TFile::Open(file.c_str(), "READ")};
+        auto* tree = in ? in->Get<TTree>(fTreeName.c_str()) : nullptr;
+        if (!tree) throw std::runtime_error("[EventLookup] Cannot read " + fTreeName + " from " + file);
+
+        // One directory per source file: the samples' branches may differ
+        auto* dir = out->mkdir(("file" + std::to_string(k++)).c_str());
+        dir->cd();
+        TNamed("source", file.c_str()).Write();
+        TTree* mini = tree->CloneTree(0);
+        mini->SetName("events");
+        std::sort(entries.begin(), entries.end());
+        for (const auto e : entries) {
+            tree->GetEntry(e);
+            mini->Fill();
+        }
+        mini->Write();
+    }
+    out->Close();
+    std::cout << "[EventLookup] Wrote " << locs.size() << " entries to " << fOutputFile << "\n";
+}
+
+//------------------------------------------------------------------------------
+void EventLookupModule::Initialise()
+{
+    auto t0 = std::chrono::steady_clock::now();
+    const EventIndex index = LoadIndex(fFiles);
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "[EventLookup] Index of " << index.Size() << " entries in " << index.Files().size()
+              << " file(s) loaded in " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+
+    // Look up the listed events
+    std::vector<EventIndex::Location> found;
+    for (const auto& key : fEvents) {
+        const auto locs = index.Find(key);
+        std::cout << "    " << key.run << ":" << key.sub << ":" << key.evt;
+        if (locs.empty()) std::cout << "  not found";
+        for (const auto& l : locs) std::cout << "  " << l.file << " #" << l.entry;
+        std::cout << "\n";
+        found.insert(found.end(), locs.begin(), locs.end());
+    }
+    if (!fEvents.empty()) {
+        t0 = std::chrono::steady_clock::now();
+        std::cout << "[EventLookup] " << fEvents.size() << " lookups in "
+                  << std::chrono::duration<double, std::milli>(t0 - t1).count() << " ms\n";
+    }
+    if (!fOutputFile.empty() && !found.empty()) Extract(found);
+
+    // Cross-stage matching: which events (the list, or all of Files) are in MatchFiles
+    if (!fMatchFiles.empty()) {
+        const EventIndex later = LoadIndex(fMatchFiles);
+        const std::vector<EventKey> keys = fEvents.empty() ? index.Keys() : fEvents;
+        std::vector<EventKey> matched;
+        for (const auto& key : keys)
+            if (later.Contains(key)) matched.push_back(key);
+        std::cout << "[EventLookup] " << matched.size() << " of " << keys.size()
+                  << " events are in the match files\n";
+
+        if (!fMatchOutput.empty()) {
+            std::ofstream out(fMatchOutput);
+            if (!out) throw std::runtime_error("[EventLookup] Cannot write " + fMatchOutput);
+            for (const auto& key : matched) out << key.run << ":" << key.sub << ":" << key.evt << "\n";
+        }
+    }
+}
@@ -0,0 +1,168 @@
+#include "Modules/FeatureSelectionModule.hxx"
+#include "Utils/Plotter.hxx"
+#include "Utils/RocCurve.hxx"
+
+#include <TH2D.h>
+#include <TMVA/Reader.h>
+#include <TMVA/Tools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+//------------------------------------------------------------------------------
+FeatureSelectionModule::FeatureSelectionModule(const TEnv& cfg)
+    : Module(cfg)
+    , fTestSignalFile(cfg.GetValue("FeatureSelection.TestSignalFile", "bdt_test_signal.root"))
+    , fTestBkgFile   (cfg.GetValue("FeatureSelection.TestBkgFile", "bdt_test_bkg.root"))
+    , fWeightsXML    (cfg.GetValue("FeatureSelection.WeightsXML",
+                                   "dataset/weights/TMVAClassification_BDTG.weights.xml"))
+    , fMinImportance (cfg.GetValue("FeatureSelection.MinImportance", 0.001))
+    , fMaxCorrelation(cfg.GetValue("FeatureSelection.MaxCorrelation", 0.9))
+    , fSeed          (cfg.GetValue("FeatureSelection.Seed", 1))
+    , fOutputFile    (cfg.GetValue("FeatureSelection.OutputFile", "selected_vars.cfg"))
+{
+    std::stringstream ssVars{cfg.GetValue("FeatureSelection.Vars", cfg.GetValue("BDTTrainModule.TrainVars", ""))};
+    std::string var;
+    while (ssVars >> var) {
+        if (var.back()==',') var.pop_back();
+        fVars.push_back(var);
+    }
+    if (fVars.empty())
+        throw std::runtime_error("[FeatureSelection] No variables: set FeatureSelection.Vars or BDTTrainModule.TrainVars.");
+}
+
+//------------------------------------------------------------------------------
+double FeatureSelectionModule::Score(const EventMatrix& m) const
+{
+    const std::size_t nVars = m.NVars();
+    std::vector<float> row(nVars);
+    TMVA::Reader reader("!Color:Silent");
+    for (std::size_t k = 0; k < nVars; ++k) reader.AddVariable(m.vars[k].c_str(), &row[k]);
+    reader.BookMVA("BDTG", fWeightsXML.c_str());
+
+    std::vector<float> score(m.Size());
+    for (std::size_t i = 0; i < m.Size(); ++i) {
+        std::copy_n(m.Row(i), nVars, row.begin());
+        score[i] = static_cast<float>(reader.EvaluateMVA("BDTG"));
+    }
+    return RocCurve(score, m.weights, m.isSignal).AUC();
+}
+
+//------------------------------------------------------------------------------
+std::vector<double> FeatureSelectionModule::Correlations(const EventMatrix& m)
+{
+    const std::size_t nVars = m.NVars();
+    std::vector<double> mean(nVars, 0.), cov(nVars * nVars, 0.);
+    double sumW = 0.;
+    for (std::size_t i = 0; i < m.Size(); ++i) {
+        const float* x = m.Row(i);
+        sumW += m.weights[i];
+        for (std::size_t a = 0; a < nVars; ++a) mean[a] += m.weights[i] * x[a];
+    }
+    if (sumW <= 0.) throw std::runtime_error("[FeatureSelection] Test events have no total weight");
+    for (auto& v : mean) v /= sumW;
+
+    for (std::size_t i = 0; i < m.Size(); ++i) {
+        const float* x = m.Row(i);
+        const double w = m.weights[i];
+        for (std::size_t a = 0; a < nVars; ++a) {
+            const double da = x[a] - mean[a];
+            for (std::size_t b = a; b < nVars; ++b) cov[a * nVars + b] += w * da * (x[b] - mean[b]);
+        }
+    }
+
+    std::vector<double> rho(nVars * nVars, 0.);
+    for (std::size_t a = 0; a < nVars; ++a) {
+        for (std::size_t b = a; b < nVars; ++b) {
+            const double norm = std::sqrt(cov[a * nVars + a] * cov[b * nVars + b]);
+            const double r = a == b ? 1. : (norm > 0. ? cov[a * nVars + b] / norm : 0.);
+            rho[a * nVars + b] = rho[b * nVars + a] = r;
+        }
+    }
+    return rho;
+}
+
+//------------------------------------------------------------------------------
+void FeatureSelectionModule::Initialise()
+{
+    TMVA::Tools::Instance();
+
+    EventMatrix m;
+    m.vars = fVars;
+    m.Append(fTestSignalFile, "tree", "sample_weight", true);
+    m.Append(fTestBkgFile,    "tree", "sample_weight", false);
+    const std::size_t nVars = m.NVars();
+    std::cout << "[FeatureSelection] " << m.Size() << " test events, " << nVars << " variables\n";
+
+    // Permutation importance: shuffle one column at a time, rescore, restore
+    const double baseAUC = Score(m);
+    std::vector<double> importance(nVars);
+    std::mt19937_64 rng(fSeed);
+    std::vector<float> saved(m.Size());
+    for (std::size_t k = 0; k < nVars; ++k) {
+        for (std::size_t i = 0; i < m.Size(); ++i) saved[i] = m.values[i * nVars + k];
+        std::vector<float> shuffled = saved;
+        std::shuffle(shuffled.begin(), shuffled.end(), rng);
+        for (std::size_t i = 0; i < m.Size(); ++i) m.values[i * nVars + k] = shuffled[i];
+        importance[k] = baseAUC - Score(m);
+        for (std::size_t i = 0; i < m.Size(); ++i) m.values[i * nVars + k] = saved[i];
+    }
+
+    const auto rho = Correlations(m);
+
+    // Most important first; a variable correlated with a kept one joins its cluster
+    std::vector<std::size_t> order(nVars);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&importance](std::size_t a, std::size_t b) { return importance[a] > importance[b]; });
+
+    std::vector<std::size_t> kept;
+    std::cout << "[FeatureSelection] Baseline AUC " << baseAUC << "; AUC drop when shuffled:\n";
+    for (const std::size_t k : order) {
+        std::string verdict = "keep";
+        for (const std::size_t c : kept) {
+            if (std::abs(rho[k * nVars + c]) >= fMaxCorrelation) {
+                std::ostringstream why;
+                why << "drop (rho = " << std::setprecision(3) << rho[k * nVars + c] << " with " << fVars[c] << ")";
+                verdict = why.str();
+                break;
+            }
+        }
+        if (verdict == "keep" && importance[k] < fMinImportance) verdict = "drop (unimportant)";
+        if (verdict == "keep") kept.push_back(k);
+        std::cout << "    " << std::setw(24) << std::left << fVars[k] << std::right
+                  << std::setw(12) << importance[k] << "  " << verdict << "\n";
+    }
+
+    // Keep the configured order in the proposal
+    std::sort(kept.begin(), kept.end());
+    std::string list;
+    for (const std::size_t k : kept) list += (list.empty() ? "" : " ") + fVars[k];
+    std::cout << "[FeatureSelection] Proposed " << kept.size() << " of " << nVars << " variables: " << list << "\n";
+
+    std::ofstream out(fOutputFile);
+    if (!out)
+        throw std::runtime_error("[FeatureSelection] Cannot write " + fOutputFile);
+    out << "# Written by FeatureSelection (baseline AUC " << baseAUC << ").\n"
+        << "# Add this file to Global.ConfigOverlays to apply it, then retrain.\n"
+        << "BDTTrainModule.TrainVars " << list << "\n"
+        << "BDTEvalModule.EvalVars " << list << "\n";
+
+    TH2D hRho("feature_correlation", ";;", nVars, 0, nVars, nVars, 0, nVars);
+    hRho.SetDirectory(nullptr);
+    for (std::size_t a = 0; a < nVars; ++a) {
+        hRho.GetXaxis()->SetBinLabel(a + 1, fVars[a].c_str());
+        hRho.GetYaxis()->SetBinLabel(a + 1, fVars[a].c_str());
+        for (std::size_t b = 0; b < nVars; ++b) hRho.SetBinContent(a + 1, b + 1, rho[a * nVars + b]);
+    }
+    Plotter::SaveHist(&hRho, "feature_correlation");
+}
@@ -0,0 +1,206 @@
+#include "Modules/LimitModule.hxx"
+
+#include <TFile.h>
+#include <TGraph.h>
+#include <TH1D.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace Analysis;
+
+//------------------------------------------------------------------------------
+LimitModule::LimitModule(const TEnv& cfg)
+    : Module(cfg)
+    , fInputFile   (cfg.GetValue("Limit.InputFile", "plotter_hists.root"))
+    , fSignalSample(cfg.GetValue("Limit.SignalSample", ""))
+    , fDataSample  (cfg.GetValue("Limit.DataSample", ""))
+    , fNToys       (cfg.GetValue("Limit.NToys", 1000))
+    , fMuSteps     (cfg.GetValue("Limit.MuSteps", 40))
+    , fMuMax       (cfg.GetValue("Limit.MuMax", 0.0))
+    , fCL          (cfg.GetValue("Limit.CL", 0.95))
+    , fSeed        (cfg.GetValue("Limit.Seed", 1))
+    , fNThreads    (cfg.GetValue("Limit.NThreads", 0))
+    , fOutputFile  (cfg.GetValue("Limit.OutputFile", "limits.root"))
+{
+    std::stringstream ssBkg{cfg.GetValue("Limit.BackgroundSamples", "")};
+    std::string item;
+    while (ssBkg >> item) {
+        if (item.back()==',') item.pop_back();
+        fBackgroundSamples.push_back(item);
+    }
+
+    std::stringstream ssGrid{cfg.GetValue("Limit.GridPoints", "")};
+    while (ssGrid >> item) {
+        if (item.back()==',') item.pop_back();
+        fGridPoints.push_back(item);
+    }
+
+    if (fSignalSample.empty() || fBackgroundSamples.empty())
+        throw std::runtime_error("[Limit] Need Limit.SignalSample and Limit.BackgroundSamples.");
+    if (fNToys < 10 || fMuSteps < 2)
+        throw std::runtime_error("[Limit] Need at least 10 toys (Limit.NToys) and 2 mu steps (Limit.MuSteps).");
+    if (!(fCL > 0. && fCL < 1.))
+        throw std::runtime_error("[Limit] Limit.CL must be in (0, 1).");
+}
+
+//------------------------------------------------------------------------------
+ToyLimit LimitModule::LoadModel(const std::string& point) const
+{
+    std::unique_ptr<TFile> in{TFile::Open(fInputFile.c_str(), "READ")};
+    if (!in || in->IsZombie())
+        throw std::runtime_error("[Limit] Cannot open " + fInputFile);
+
+    // Grid histograms are logit_bdt_<point>_<sample>, nominal ones logit_bdt_<sample>
+    const std::string prefix = point.empty() ? "logit_bdt_" : "logit_bdt_" + point + "_";
+    auto bins = [&](const std::string& sample) {
+        auto* h = in->Get<TH1D>((prefix + sample).c_str());
+        if (!h) throw std::runtime_error("[Limit] No histogram " + prefix + sample + " in " + fInputFile);
+        std::vector<double> v(h->GetNbinsX());
+        for (int b = 1; b <= h->GetNbinsX(); ++b) v[b - 1] = h->GetBinContent(b);
+        return v;
+    };
+
+    std::vector<double> s = bins(fSignalSample);
+    std::vector<double> b(s.size(), 0.);
+    for (const auto& sample : fBackgroundSamples) {
+        const auto v = bins(sample);
+        if (v.size() != b.size())
+            throw std::runtime_error("[Limit] Binning of " + prefix + sample + " differs from the signal");
+        for (std::size_t i = 0; i < b.size(); ++i) b[i] += v[i];
+    }
+    std::vector<double> data;
+    if (!fDataSample.empty()) {
+        // Data histograms are unweighted counts
+        data = bins(fDataSample);
+        for (auto& n : data) n = std::round(n);
+    }
+    return ToyLimit(std::move(s), std::move(b), std::move(data));
+}
+
+//------------------------------------------------------------------------------
+void LimitModule::Initialise()
+{
+    const std::vector<std::string> points = fGridPoints.empty() ? std::vector<std::string>{""} : fGridPoints;
+    const std::size_t nPoints = points.size();
+
+    // mu scan per point; by default up to where the signal clearly dominates
+    std::vector<ToyLimit> models;
+    std::vector<std::vector<double>> mus(nPoints);
+    for (std::size_t p = 0; p < nPoints; ++p) {
+        models.push_back(LoadModel(points[p]));
+        const double muMax = fMuMax > 0. ? fMuMax
+            : (5. + 5. * std::sqrt(models[p].TotalBackground())) / models[p].TotalSignal();
+        for (int j = 0; j < fMuSteps; ++j) mus[p].push_back(muMax * (j + 1) / fMuSteps);
+    }
+
+    // One task per (point, mu); every task seeds its own stream
+    const std::size_t nTasks = nPoints * fMuSteps;
+    std::vector<ToyLimit::ToySet> sets(nTasks);
+    std::atomic<std::size_t> next{0};
+    std::mutex mtx;
+    std::vector<std::string> errors;
+
+    auto worker = [&]() {
+        for (std::size_t t = next++; t < nTasks; t = next++) {
+            const std::size_t p = t / fMuSteps, j = t % fMuSteps;
+            try {
+                std::seed_seq seq{static_cast<std::uint32_t>(fSeed), static_cast<std::uint32_t>(p),
+                                  static_cast<std::uint32_t>(j)};
+                std::uint32_t words[2];
+                seq.generate(words, words + 2);
+                const std::uint64_t seed = (static_cast<std::uint64_t>(words[0]) << 32) | words[1];
+                sets[t] = models[p].Toys(mus[p][j], fNToys, seed);
+            }
+            catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(mtx);
+                errors.emplace_back(e.what());
+            }
+        }
+    };
+
+    const int nThreads = fNThreads > 0 ? fNThreads : std::max(1u, std::thread::hardware_concurrency());
+    const int nWorkers = std::max(1, std::min<int>(nThreads, static_cast<int>(nTasks)));
+    std::cout << "[Limit] " << nPoints << " point(s) x " << fMuSteps << " mu values x 2 x "
+              << fNToys << " toys on " << nWorkers << " thread(s)\n";
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int w = 0; w < nWorkers; ++w) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    for (const auto& e : errors) std::cerr << e << "\n";
+    if (!errors.empty())
+        throw std::runtime_error("[Limit] " + std::to_string(errors.size()) + " toy task(s) failed.");
+
+    const double nToysTotal = 2. * fNToys * static_cast<double>(nTasks);
+    std::cout << "[Limit] " << nToysTotal << " toys in " << std::fixed << std::setprecision(2) << seconds
+              << " s (" << std::setprecision(0) << nToysTotal / std::max(seconds, 1e-9) << " toys/s)\n"
+              << std::defaultfloat << std::setprecision(6);
+
+    // Limits per point, one histogram bin per point
+    const double alpha = 1. - fCL;
+    const char* bandNames[] = {"exp_m2", "exp_m1", "exp", "exp_p1", "exp_p2"};
+    TH1D hObs("limit_obs", ";Grid point;Upper limit on #mu", nPoints, 0, nPoints);
+    std::vector<TH1D> hExp;
+    hExp.reserve(std::size(bandNames));
+    for (const char* n : bandNames)
+        hExp.emplace_back(("limit_" + std::string(n)).c_str(), ";Grid point;Upper limit on #mu", nPoints, 0, nPoints);
+
+    std::unique_ptr<TFile> out{TFile::Open(fOutputFile.c_str(), "RECREATE")};
+    if (!out || out->IsZombie())
+        throw std::runtime_error("[Limit] Cannot create " + fOutputFile);
+
+    std::cout << "[Limit] " << fCL * 100 << "% CLs upper limits on mu:\n";
+    for (std::size_t p = 0; p < nPoints; ++p) {
+        const std::string label = points[p].empty() ? "nominal" : points[p];
+        std::vector<double> obs(fMuSteps);
+        std::vector<std::vector<double>> expected(hExp.size(), std::vector<double>(fMuSteps));
+        for (int j = 0; j < fMuSteps; ++j) {
+            const auto& set = sets[p * fMuSteps + j];
+            obs[j] = ToyLimit::ObservedCLs(set);
+            for (std::size_t k = 0; k < expected.size(); ++k) expected[k][j] = ToyLimit::ExpectedCLs(set, k);
+        }
+
+        std::cout << "    " << std::setw(10) << label;
+        if (models[p].HasData()) {
+            const double lim = ToyLimit::Crossing(mus[p], obs, alpha);
+            hObs.SetBinContent(p + 1, lim);
+            std::cout << "  observed " << lim;
+        }
+        for (std::size_t k = 0; k < expected.size(); ++k) {
+            const double lim = ToyLimit::Crossing(mus[p], expected[k], alpha);
+            hExp[k].SetBinContent(p + 1, lim);
+            if (k == 2) std::cout << "  expected " << lim;
+        }
+        std::cout << "  [" << hExp[0].GetBinContent(p + 1) << ", " << hExp[4].GetBinContent(p + 1) << "]\n";
+        if (expected[2].back() >= alpha)
+            std::cout << "    [Limit] Warning: expected CLs never falls below " << alpha
+                      << " for " << label << "; raise Limit.MuMax\n";
+
+        hObs.GetXaxis()->SetBinLabel(p + 1, label.c_str());
+        for (auto& h : hExp) h.GetXaxis()->SetBinLabel(p + 1, label.c_str());
+
+        TGraph gObs(fMuSteps, mus[p].data(), obs.data());
+        TGraph gExp(fMuSteps, mus[p].data(), expected[2].data());
+        out->cd();
+        if (models[p].HasData()) gObs.Write(("cls_obs_" + label).c_str());
+        gExp.Write(("cls_exp_" + label).c_str());
+    }
+    out->cd();
+    if (!fDataSample.empty()) hObs.Write();
+    for (auto& h : hExp) h.Write();
+    out->Close();
+}
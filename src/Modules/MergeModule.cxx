@@ -0,0 +1,120 @@
+#include "Modules/MergeModule.hxx"
+#include "Utils/Plotter.hxx"
+
+#include <TFileMerger.h>
+#include <TROOT.h>
+#include <TSystem.h>
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace Analysis;
+
+//------------------------------------------------------------------------------
+MergeModule::MergeModule(const TEnv& cfg)
+    : Module(cfg)
+    , fShardCount  (cfg.GetValue("Merge.ShardCount", 1))
+    , fNThreads    (cfg.GetValue("Merge.NThreads", 4))
+    , fRender      (cfg.GetValue("Merge.Render", true))
+    , fRemoveShards(cfg.GetValue("Merge.RemoveShards", false))
+    , fHistFile    (ShardSpec::HistogramFile(cfg))
+{
+    std::stringstream ss{cfg.GetValue("Merge.Targets", "")};
+    std::string item;
+    while (ss >> item) {
+        if (item.back()==',') item.pop_back();
+        fTargets.push_back(item);
+    }
+    fTargets.push_back(fHistFile);
+
+    if (fShardCount < 2)
+        throw std::runtime_error("[Merge] Need Merge.ShardCount (or --shards N) of at least 2.");
+}
+
+//------------------------------------------------------------------------------
+bool MergeModule::MergeOne(const std::string& target) const
+{
+    const ShardSpec naming(0, fShardCount);
+    std::vector<std::string> parts;
+    for (int i = 0; i < fShardCount; ++i) {
+        const std::string part = naming.OutputName(target, i);
+        if (!gSystem->AccessPathName(part.c_str())) parts.push_back(part);
+    }
+
+    // Files-mode outputs are written whole by one shard and need no merging
+    if (parts.empty()) {
+        if (gSystem->AccessPathName(target.c_str()))
+            throw std::runtime_error("[Merge] No shards found for " + target);
+        return false;
+    }
+    if (static_cast<int>(parts.size()) != fShardCount)
+        throw std::runtime_error("[Merge] Only " + std::to_string(parts.size()) + " of "
+                                 + std::to_string(fShardCount) + " shards present for " + target);
+
+    // Fast merging copies compressed baskets without unzipping; trees are
+    // concatenated in the order the files are added, histograms are summed.
+    TFileMerger merger(kFALSE, kFALSE);
+    merger.SetFastMethod(kTRUE);
+    merger.SetPrintLevel(0);
+    if (!merger.OutputFile(target.c_str(), "RECREATE"))
+        throw std::runtime_error("[Merge] Cannot create " + target);
+    for (const auto& p : parts) merger.AddFile(p.c_str(), kFALSE);
+    if (!merger.Merge())
+        throw std::runtime_error("[Merge] Merging failed for " + target);
+
+    if (fRemoveShards)
+        for (const auto& p : parts) std::remove(p.c_str());
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void MergeModule::Initialise()
+{
+    ROOT::EnableThreadSafety();
+
+    std::cout << "[Merge] Merging " << fTargets.size() << " target(s) from "
+              << fShardCount << " shards on " << fNThreads << " thread(s)\n";
+
+    // Targets are independent, so a few merges run side by side
+    std::atomic<std::size_t> next{0};
+    std::mutex mtx;
+    std::vector<std::string> errors;
+    bool mergedHists = false;
+
+    auto worker = [&]() {
+        for (std::size_t t = next++; t < fTargets.size(); t = next++) {
+            const auto& target = fTargets[t];
+            try {
+                const bool merged = MergeOne(target);
+                std::lock_guard<std::mutex> lock(mtx);
+                std::cout << "[Merge] " << (merged ? "Wrote " : "Already complete: ") << target << "\n";
+                if (merged && target == fHistFile) mergedHists = true;
+            }
+            catch (const std::exception& e) {
+                // A sharded run without any plots writes no histogram file
+                if (target == fHistFile && gSystem->AccessPathName(target.c_str())) continue;
+                std::lock_guard<std::mutex> lock(mtx);
+                errors.emplace_back(e.what());
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    const int nWorkers = std::max(1, std::min<int>(fNThreads, static_cast<int>(fTargets.size())));
+    for (int w = 0; w < nWorkers; ++w) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+
+    for (const auto& e : errors) std::cerr << e << "\n";
+    if (!errors.empty())
+        throw std::runtime_error("[Merge] " + std::to_string(errors.size()) + " target(s) failed to merge.");
+
+    if (fRender && mergedHists) {
+        std::cout << "[Merge] Drawing summed histograms from " << fHistFile << "\n";
+        Plotter::RenderFromFile(fHistFile);
+    }
+}
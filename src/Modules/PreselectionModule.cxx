@@ -1,11 +1,16 @@
 #include "Modules/PreselectionModule.hxx"
+#include "Utils/EventIndex.hxx"
 #include "Utils/Plotter.hxx"
+#include "Utils/HistCache.hxx"
+#include "Utils/PlotBook.hxx"
 
+#include <ROOT/RDFHelpers.hxx>
 #include <TEnv.h>
 #include <TFile.h>
 #include <TString.h>
 #include <TH1D.h>
 #include <algorithm>
+#include <iomanip>
 #include <sstream>
 
 using namespace Analysis;
@@ -15,6 +20,10 @@ PreselectionModule::PreselectionModule(const TEnv& cfg)
     : Module(cfg)
     , fTreeName     (cfg.GetValue("Preselection.TreeName","nuselection/NeutrinoSelectionFilter"  ))
     , fRunLabel     (cfg.GetValue("Global.RunLabel","run_x") )
+    , fShard        (ShardSpec::FromConfig(cfg).ByEntries())
+    , fPreview      (PreviewSpec::FromConfig(cfg))
+    , fPlots        (PlotBook::FromConfig(cfg, "Preselection"))
+    , fEventIndex   (cfg.GetValue("Global.EventIndex", 0) != 0)
 {
     
         // --------------------------------------------------------------------
@@ -55,6 +64,20 @@ PreselectionModule::PreselectionModule(const TEnv& cfg)
         fVarsToKeep.push_back(keepItem); 
     }
 
+    std::stringstream ssIndex{cfg.GetValue("Global.EventIndexColumns", "run sub evt")};
+    while (ssIndex >> keepItem) {
+        if (keepItem.back()==',') keepItem.pop_back();
+        fIndexColumns.push_back(keepItem);
+    }
+
+    std::stringstream ssZone{cfg.GetValue("Global.ZoneMapColumns", "")};
+    while (ssZone >> keepItem) {
+        if (keepItem.back()==',') keepItem.pop_back();
+        fZoneMapColumns.push_back(keepItem);
+    }
+    if (cfg.GetValue("Global.UseZoneMaps", 1) != 0)
+        fZoneTerms = ZoneMap::ParseCuts(cuts);
+
     std::stringstream ssInput{cfg.GetValue("Preselection.InputFiles", "")};
     std::string inputItem;
     while (ssInput >> inputItem) {
@@ -82,6 +105,13 @@ PreselectionModule::PreselectionModule(const TEnv& cfg)
         fSampleWeights.push_back(weight);
     }
 
+    std::stringstream ssWeightCols{cfg.GetValue("Preselection.SampleWeightColumns", "")};
+    std::string weightCol;
+    while (ssWeightCols >> weightCol) {
+        if (weightCol.back()==',') weightCol.pop_back();
+        fSampleWeightColumns.push_back(weightCol == "-" ? "" : weightCol);
+    }
+
     if (fVarsToKeep.empty()) {
         throw std::runtime_error("[Preselection] No variables to keep specified!");
     }
@@ -89,7 +119,8 @@ PreselectionModule::PreselectionModule(const TEnv& cfg)
 
 std::vector<std::unique_ptr<ROOT::RDataFrame>>
 PreselectionModule::BuildDataFrames(const std::vector<std::string>& files,
-                                     const std::string& treeName) const
+                                     const std::string& treeName,
+                                     std::vector<ReadPlan>* plans) const
 {
     std::vector<std::unique_ptr<ROOT::RDataFrame>> dfVec;
     for (const auto& fname : files) {
@@ -101,6 +132,8 @@ PreselectionModule::BuildDataFrames(const std::vector<std::string>& files,
         if (!tree) {
             throw std::runtime_error("[Preselection] Cannot find tree: " + treeName);
         }
+        const ReadPlan plan = ReadPlan::Apply(*tree, fname, treeName, fShard, fPreview, fZoneTerms);
+        if (plans) plans->push_back(plan);
         auto RDF = std::make_unique<ROOT::RDataFrame>(*tree);
         dfVec.push_back(std::move(RDF));
     }
@@ -110,23 +143,37 @@ PreselectionModule::BuildDataFrames(const std::vector<std::string>& files,
     return dfVec;
 }
 
+std::vector<std::string> PreselectionModule::Outputs() const
+{
+    std::vector<std::string> out;
+    if (!fPreview.Active())
+        for (const auto& f : fOutFiles) out.push_back(fShard.OutputName(f));
+    if (!fPlots.OutputFile().empty()) out.push_back(fShard.OutputName(fPlots.OutputFile()));
+    return out;
+}
+
 Long64_t PreselectionModule::EntryCount() const
 {
-    
+    if (Plotter::RenderOnly()) return 1;   // nothing was read
+
     if (dfVec.size() == 0) {
         throw std::runtime_error("[Preselection] DataFrames not initialised!");
     }
 
-    Long64_t totalEntries = 0;
-    for (const auto& df : dfVec) {
-        totalEntries += df->Count().GetValue();
-    }
-    return totalEntries;
+    // Counted in the event loop of Initialise(), before any cut
+    return fNEntries;
 }
 
 void PreselectionModule::Initialise()
 {
-    dfVec = BuildDataFrames(fInputFiles, fTreeName);
+    // Render-only: histograms come from the cache and no ntuple is opened
+    const bool renderOnly = Plotter::RenderOnly();
+    std::vector<ReadPlan> plans;
+    if (!renderOnly)
+        dfVec = BuildDataFrames(fInputFiles, fTreeName, &plans);
+    // A preview is for the cut flows and plots; partial ntuples would be taken for the real ones
+    if (fPreview.Active())
+        std::cout << "[Preselection] Preview of " << fPreview.Fraction() * 100 << "% of the clusters, no ntuples written\n";
 
      // One RNode per sample, initially pointing at the un-filtered DataFrame
      // This again feels messy because we initialise a set of pointers to rdataframes, but then RDF::Filter returns RNodes
@@ -134,179 +181,97 @@ void PreselectionModule::Initialise()
      
     std::vector<ROOT::RDF::RNode> nodes;
     nodes.reserve(dfVec.size());
-    for (auto &dfPtr : dfVec) nodes.emplace_back(*dfPtr);
-
-    // Apply every cut in sequence
-    for (const auto &cut : cuts) {
-        std::cout << "\n[Preselection] Cut: " << cut << '\n';
+    for (std::size_t i = 0; i < dfVec.size(); ++i)
+        nodes.emplace_back(plans[i].entryList ? ROOT::RDF::RNode(*dfVec[i])
+                                              : fShard.Restrict(*dfVec[i], fInputFiles[i], fTreeName));
 
-        for (std::size_t i = 0; i < nodes.size(); ++i) {
-            auto before = nodes[i].Count().GetValue();
-            std::cout << "    " << fSampleLabels[i] << " before: " << before << '\n';
+    // Everything below is booked lazily and filled in one event loop per
+    // sample: the cut flow counts, the snapshot and every configured plot.
+    std::vector<ROOT::RDF::RResultHandle> handles;
 
-            nodes[i] = nodes[i].Filter(cut);      
-            auto after  = nodes[i].Count().GetValue();
-            std::cout << "    " << fSampleLabels[i] << " after : " << after  << '\n';
+    // Apply every cut in sequence, counting before the first and after each
+    std::vector<std::vector<ROOT::RDF::RResultPtr<ULong64_t>>> cutflow(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        cutflow[i].push_back(nodes[i].Count());
+        for (const auto& cut : cuts) {
+            nodes[i] = nodes[i].Filter(cut);
+            cutflow[i].push_back(nodes[i].Count());
         }
+        for (const auto& c : cutflow[i]) handles.emplace_back(c);
     }
 
     ROOT::RDF::RSnapshotOptions opt;
     opt.fMode = "RECREATE";
     opt.fCompressionAlgorithm = ROOT::kZLIB;
     opt.fCompressionLevel     = 4;
+    opt.fLazy = true;
+
+    std::string allCuts;
+    for (const auto& cut : cuts) allCuts += cut + "\n";
+
+    std::vector<PlotBook::Booking> bookings;
+    for (std::size_t i = 0; i < fInputFiles.size(); ++i) {
+        const std::string weightExpr = i < fSampleWeightColumns.size() ? fSampleWeightColumns[i] : "";
+        const double      sampleW    = i < fSampleWeights.size() ? fSampleWeights[i] : 1.0;
+        const double      preview    = i < plans.size() ? plans[i].weightScale : 1.0;
+        const double      scale      = sampleW * preview;
+
+        // Everything that determines this sample's histograms, for the histogram cache.
+        // Not the preview's weight scale: the file, shard and preview tag fix it, and a
+        // render-only run, which has no read plans, must build the same key.
+        std::ostringstream ctx;
+        ctx << std::setprecision(17) << HistCache::FileIdentity({fInputFiles[i]})
+            << fTreeName << "\n" << allCuts << fShard.Tag() << fPreview.Tag() << "\n"
+            << "weight (" << weightExpr << ") * " << sampleW;
+
+        ROOT::RDF::RNode* node = nullptr;
+        std::string w;
+        if (!renderOnly) {
+            // Now we can write each filtered RNode to a new TTree in the output file
+            const std::string outFile = fShard.OutputName(fOutFiles[i]);
+            std::cout << "[Preselection] " << fSampleLabels[i] << " -> " << outFile << '\n';
+            if (!fPreview.Active())
+                handles.emplace_back(nodes[i].Snapshot(fTreeName, outFile, fVarsToKeep, opt));
+
+            // Per-event weight times the POT scale, applied while filling
+            w = Plotter::WeightColumn(nodes[i], "preselection_" + fSampleLabels[i], weightExpr, scale);
+            node = &nodes[i];
+        }
+        bookings.push_back(fPlots.Book(node, "preselection", fSampleLabels[i], w, ctx.str()));
+        for (auto& h : PlotBook::Handles(bookings.back())) handles.push_back(h);
+    }
 
-    // Now we can write each filtered RNode to a new TTree in the output file
-
-    std::vector<TH1D> preSelectednpfpsVec;
-    std::vector<TH1D> preSelectedNuE2Vec;
-    std::vector<TH1D> preSelectedFlashMatchScoreVec;
-    std::vector<TH1D> preSelectedTopologicalScoreVec;
-    std::vector<TH1D> preSelectedShrPhivVec;
-    std::vector<TH1D> preSelectedShrFitPzFracVec;
-    std::vector<TH1D> preSelectedShrFitThetaVec;
-
-    for (std::size_t i = 0; i < nodes.size(); ++i) {
-        std::cout << "\n[Preselection] Writing output for sample: " << fSampleLabels[i] << '\n';
-        std::cout << "    to file: " << fOutFiles[i] << '\n';
-        nodes[i].Snapshot(fTreeName, fOutFiles[i], fVarsToKeep, opt);
-
-
-        //ROOT::RDF::TH1DModel NuE2Model(
-        //    ("pre_hist_" + fSampleLabels[i]).c_str(),
-        //    ";Neutrino Energy [MeV];Count",
-        //    20, 0.0, 500.0);
-
-        //ROOT::RDF::TH1DModel FlashMatchScoreModel(
-        //    ("pre_hist_" + fSampleLabels[i]).c_str(),
-        //    ";Flash Match Score;Count",
-        //    20, 0.0, 15.0);
-
-        //ROOT::RDF::TH1DModel TopologicalScoreModel(
-        //    ("pre_hist_" + fSampleLabels[i]).c_str(),
-        //    ";Topological Score;Count",
-        //    30, 0.0, 1.0);
-
-        //preSelectedHistVec.push_back(
-            //nodes[i].Histo1D(enModel, "NeutrinoEnergy2").GetPtr());
-        //TH1D histNuE2 = nodes[i].Histo1D(NuE2Model, "NeutrinoEnergy2").GetValue();
-        //histNuE2.SetName(("preselection_hist_" + fSampleLabels[i]).c_str());
-        //preSelectedNuE2Vec.push_back(histNuE2);
-        //TH1D histFlashMatchScore = nodes[i].Histo1D(FlashMatchScoreModel, "nu_flashmatch_score").GetValue();
-        //histFlashMatchScore.SetName(("preselection_hist_" + fSampleLabels[i]).c_str());
-        //preSelectedFlashMatchScoreVec.push_back(histFlashMatchScore);
-        //TH1D histTopoScore = nodes[i].Histo1D(TopologicalScoreModel, "topological_score").GetValue();
-
-        preSelectednpfpsVec.push_back(
-            Plotter::CreateTH1DFromRNode(
-                nodes[i],
-                ("preselection_hist_npfps_" + fSampleLabels[i]).c_str(),
-                "n_pfps", 
-                "Number of PFParticles",
-                "Count",
-                5, 0.5, 5.5));
-
-        preSelectedNuE2Vec.push_back(
-            Plotter::CreateTH1DFromRNode(
-                nodes[i],
-                ("preselection_hist_NeutrinoEnergy2_" + fSampleLabels[i]).c_str(),
-                "NeutrinoEnergy2",
-                "Neutrino Energy [MeV]",
-                "Count",
-                20, 0.0, 500.0));
-
-        preSelectedFlashMatchScoreVec.push_back(
-            Plotter::CreateTH1DFromRNode(
-                nodes[i],
-                ("preselection_hist_FlashMatchScore_" + fSampleLabels[i]).c_str(),
-                "nu_flashmatch_score", 
-                "Flash Match Score",
-                "Count",
-                20, 0.0, 15.0));
-
-        preSelectedTopologicalScoreVec.push_back(
-            Plotter::CreateTH1DFromRNode(
-                nodes[i],
-                ("preselection_hist_TopologicalScore_" + fSampleLabels[i]).c_str(),
-                "topological_score", 
-                "Topological Score",
-                "Count",
-                30, 0.0, 1.0));
-
-        preSelectedShrPhivVec.push_back(
-            Plotter::CreateTH1DFromRNode(
-                nodes[i],
-                ("preselection_hist_ShrPhiv_" + fSampleLabels[i]).c_str(),
-                "shr_phi_v", 
-                "Shr Phi [rad]",
-                "Count",
-                20, -3.14, 3.14,
-                true)); // remove vector duplicates by taking first element only
-
-        preSelectedShrFitPzFracVec.push_back(
-            Plotter::CreateTH1DFromRNode(
-                nodes[i],
-                ("preselection_hist_ShrFitPzFrac_" + fSampleLabels[i]).c_str(),
-                "shr_pz_v",
-                "Shr Fit Pz Frac",
-                "Count",
-                20, -1.0, 1.0,
-                true)); // remove vector duplicates by taking first element only
-
-        preSelectedShrFitThetaVec.push_back(
-            Plotter::CreateTH1DFromRNode(
-                nodes[i],
-                ("preselection_hist_ShrFitTheta_" + fSampleLabels[i]).c_str(),
-                "shr_theta_v",
-                "Shr Fit Theta [rad]",
-                "Count",
-                20, 0.0, 3.14,
-                true)); // remove vector duplicates by taking first element only
-
+    // One loop per sample, the samples concurrently
+    if (!handles.empty()) ROOT::RDF::RunGraphs(handles);
+
+    // Sidecars for run_eventlookup, e.g. to match against the slimmed events
+    if (fEventIndex && !renderOnly && !fPreview.Active())
+        for (const auto& out : fOutFiles)
+            EventIndex::WriteSidecar(fShard.OutputName(out), fTreeName, fIndexColumns);
+
+    // Zone maps of the outputs, for the readers of the next stage
+    if (!fZoneMapColumns.empty() && !renderOnly && !fPreview.Active())
+        for (const auto& out : fOutFiles)
+            ZoneMap::WriteSidecar(fShard.OutputName(out), fTreeName, fZoneMapColumns);
+
+    fNEntries = 0;
+    for (std::size_t i = 0; i < cutflow.size(); ++i) {
+        std::cout << "\n[Preselection] Cut flow for " << fSampleLabels[i] << '\n';
+        if (plans[i].zoneSkipped > 0)
+            std::cout << "    " << std::left << std::setw(40) << "(skipped by zone map)" << plans[i].zoneSkipped << '\n';
+        // In a preview, each row also gets its full-sample estimate and precision
+        for (std::size_t c = 0; c <= cuts.size(); ++c) {
+            const ULong64_t n = *cutflow[i][c];
+            std::cout << "    " << std::left << std::setw(40) << (c == 0 ? "(all)" : cuts[c - 1]) << n;
+            if (fPreview.Active()) std::cout << "  " << PreviewSpec::Estimate(n, plans[i].weightScale);
+            std::cout << '\n';
+        }
+        fNEntries += *cutflow[i][0];
     }
 
-    // Example of creating a stacked histogram
-
-    Plotter::FullDataMCSignalPlot(preSelectednpfpsVec,
-                        fSampleLabels,
-                        "preselection_full_hist_npfps",
-                        false, // logy
-                        fSampleWeights);
-
-    Plotter::FullDataMCSignalPlot(preSelectedNuE2Vec,
-                         fSampleLabels,
-                         "preselection_full_hist_NeutrinoEnergy2",
-                         false, // logy
-                         fSampleWeights);
-
-    Plotter::FullDataMCSignalPlot(preSelectedFlashMatchScoreVec,
-                         fSampleLabels,
-                         "preselection_full_hist_FlashMatchScore",
-                         false, // logy
-                         fSampleWeights);
-
-    Plotter::FullDataMCSignalPlot(preSelectedShrPhivVec,
-                            fSampleLabels,
-                            "preselection_full_hist_ShrPhiv",
-                            false, // logy
-                            fSampleWeights);
-
-    Plotter::FullDataMCSignalPlot(preSelectedTopologicalScoreVec,
-                         fSampleLabels,
-                         "preselection_full_hist_TopologicalScore",
-                         false, // logy
-                         fSampleWeights);
-
-    Plotter::FullDataMCSignalPlot(preSelectedShrFitPzFracVec,
-                            fSampleLabels,
-                            "preselection_full_hist_ShrFitPzFrac",
-                            false, // logy
-                            fSampleWeights);
-
-    Plotter::FullDataMCSignalPlot(preSelectedShrFitThetaVec,
-                            fSampleLabels,
-                            "preselection_full_hist_ShrFitTheta",
-                            false, // logy
-                            fSampleWeights);
+    for (auto& b : bookings) fPlots.Collect(b, "preselection");
+    const std::string plotFile = fPlots.OutputFile();
+    fPlots.Draw(bookings, fSampleLabels, "preselection", plotFile.empty() ? "" : fShard.OutputName(plotFile));
 }
 
 void PreselectionModule::Finalise()
@@ -1,19 +1,45 @@
 #include "Modules/SlimmerModule.hxx"
 #include "Utils/Plotter.hxx"
+#include "Utils/Kernels.hxx"
+#include "Framework/Checkpoint.hxx"
+#include "Framework/Preview.hxx"
+#include "Utils/EventIndex.hxx"
+#include "Utils/EventFilter.hxx"
+#include "Utils/ZoneMap.hxx"
 
 #include <TEnv.h>
 #include <TFile.h>
 #include <TString.h>
+#include <TTree.h>
 #include <algorithm>
+#include <memory>
 #include <sstream>
 
 using namespace Analysis;
 
+namespace {
+
+Long64_t TreeEntries(const std::string& fileName, const std::string& treeName)
+{
+    std::unique_ptr<TFile> file{TFile::Open(fileName.c_str(), "READ")};
+    auto* tree = file && !file->IsZombie() ? file->Get<TTree>(treeName.c_str()) : nullptr;
+    if (!tree) throw std::runtime_error("[Slimmer] Cannot find tree: " + treeName + " in " + fileName);
+    return tree->GetEntries();
+}
+
+} // namespace
+
 //------------------------------------------------------------------------------
 SlimmerModule::SlimmerModule(const TEnv& cfg)
     : Module(cfg)
     , fTreeName     (cfg.GetValue("Slimmer.TreeName","nuselection/NeutrinoSelectionFilter"  ))
     , fRunLabel     (cfg.GetValue("Global.RunLabel","run_x") )
+    , fShard        (ShardSpec::FromConfig(cfg))
+    , fCheckpointEntries(cfg.GetValue("Global.CheckpointEntries", 0))
+    , fResume       (cfg.GetValue("Global.Resume", false))
+    , fEventIndex   (cfg.GetValue("Global.EventIndex", 0) != 0)
+    , fRemoveDuplicates (cfg.GetValue("Slimmer.RemoveDuplicates", 0) != 0)
+    , fDuplicateMemoryMB(cfg.GetValue("Slimmer.DuplicateMemoryMB", 512))
 {
 
     std::stringstream ssInput{cfg.GetValue("Slimmer.InputFiles", "")};
@@ -36,11 +62,30 @@ SlimmerModule::SlimmerModule(const TEnv& cfg)
         if (item.back()==',') item.pop_back();
         fVarsToKeep.push_back(item); 
     }
+
+    std::stringstream ssIndex{cfg.GetValue("Global.EventIndexColumns", "run sub evt")};
+    while (ssIndex >> item) {
+        if (item.back()==',') item.pop_back();
+        fIndexColumns.push_back(item);
+    }
+
+    std::stringstream ssGRL{cfg.GetValue("Slimmer.GoodRunLists", "")};
+    while (ssGRL >> item) {
+        if (item.back()==',') item.pop_back();
+        fGoodRunLists.push_back(item);
+    }
+
+    std::stringstream ssZone{cfg.GetValue("Global.ZoneMapColumns", "")};
+    while (ssZone >> item) {
+        if (item.back()==',') item.pop_back();
+        fZoneMapColumns.push_back(item);
+    }
 }
 
 std::vector<std::unique_ptr<ROOT::RDataFrame>>
 SlimmerModule::BuildDataFrames(const std::vector<std::string>& files,
-                                     const std::string& treeName) const
+                                     const std::string& treeName,
+                                     std::vector<ReadPlan>* plans) const
 {
     // Create a vector of unique pointers to RDataFrames, one per input file.
 
@@ -55,6 +100,9 @@ SlimmerModule::BuildDataFrames(const std::vector<std::string>& files,
         if (!tree) {
             throw std::runtime_error("[Slimmer] Cannot find tree: " + treeName);
         }
+        // The shard's entries as an entry list: slimmed ntuples take no preview or zone-map cuts
+        const ReadPlan plan = ReadPlan::Apply(*tree, fname, treeName, fShard, PreviewSpec(), {});
+        if (plans) plans->push_back(plan);
         auto RDF = std::make_unique<ROOT::RDataFrame>(*tree);
         dfVec.push_back(std::move(RDF));
     }
@@ -64,9 +112,90 @@ SlimmerModule::BuildDataFrames(const std::vector<std::string>& files,
     return dfVec;
 }
 
+Checkpoint::NodeBuilder
+SlimmerModule::EventFilters(const std::string& inFile, std::size_t k) const
+{
+    std::shared_ptr<const DuplicateFilter> dups;
+    if (fRemoveDuplicates) {
+        dups = std::make_shared<const DuplicateFilter>(
+            DuplicateFilter::Scan(inFile, fTreeName, fIndexColumns, static_cast<std::size_t>(fDuplicateMemoryMB)));
+        std::cout << "[Slimmer] " << dups->NDuplicates() << " duplicate entries of " << dups->NEntries()
+                  << (dups->UsedBloom() ? " (Bloom filter, confirmed)" : " (hash set)") << '\n';
+        if (dups->NDuplicates() == 0) dups.reset();
+    }
+
+    std::shared_ptr<const GoodRunList> grl;
+    const std::string grlPath = k < fGoodRunLists.size() ? fGoodRunLists[k] : "-";
+    if (grlPath != "-") {
+        if (fIndexColumns.size() != 3)
+            throw std::runtime_error("[Slimmer] Global.EventIndexColumns must name the run, subrun and event columns");
+        grl = std::make_shared<const GoodRunList>(GoodRunList::FromFile(grlPath));
+        std::cout << "[Slimmer] Good-run list " << grlPath << ": " << grl->NRuns() << " runs\n";
+    }
+
+    // Both filters only read the key columns, so rejected entries read nothing else.
+    // Duplicates are decided by key: rdfentry_ is not the tree entry under implicit MT.
+    const std::vector<std::string> keys = fIndexColumns;
+    return [dups, grl, keys](ROOT::RDF::RNode node, Long64_t first, Long64_t last) {
+        if (dups) {
+            // The pass refers to *dups, which the filter keeps alive along with it
+            auto pass = std::make_shared<DuplicateFilter::Pass>(*dups, first, last);
+            node = node.Define("dup_run", "static_cast<unsigned int>(" + keys[0] + ")")
+                       .Define("dup_sub", "static_cast<unsigned int>(" + keys[1] + ")")
+                       .Define("dup_evt", "static_cast<unsigned int>(" + keys[2] + ")")
+                       .Filter([dups, pass](unsigned int run, unsigned int sub, unsigned int evt) {
+                                   return pass->Keep(run, sub, evt); },
+                               {"dup_run", "dup_sub", "dup_evt"}, "duplicates");
+        }
+        if (grl)
+            node = node.Define("grl_run", "static_cast<unsigned int>(" + keys[0] + ")")
+                       .Define("grl_sub", "static_cast<unsigned int>(" + keys[1] + ")")
+                       .Filter([grl](unsigned int run, unsigned int sub) { return grl->Contains(run, sub); },
+                               {"grl_run", "grl_sub"}, "good_runs");
+        return node;
+    };
+}
+
+ROOT::RDF::RNode SlimmerModule::DefineDerived(ROOT::RDF::RNode node)
+{
+    // Fiducial variables to assess containment (taken from HNL analysis). The whole mess with big and small
+    // values is because in ext files the trk_sce_start_x_v vectors can be empty if there is no neutrino slice.
+    // In overlay this doesn't happen, but need to for data/ext files I think, so I set min/max to values outside the fiducial volume
+    // (see Utils/Kernels.hxx).
+    return node
+        .Define("min_x", Kernels::MinOfPair, {"trk_sce_start_x_v", "trk_sce_end_x_v"})
+        .Define("max_x", Kernels::MaxOfPair, {"trk_sce_start_x_v", "trk_sce_end_x_v"})
+        .Define("min_y", Kernels::MinOfPair, {"trk_sce_start_y_v", "trk_sce_end_y_v"})
+        .Define("max_y", Kernels::MaxOfPair, {"trk_sce_start_y_v", "trk_sce_end_y_v"})
+        .Define("min_z", Kernels::MinOfPair, {"trk_sce_start_z_v", "trk_sce_end_z_v"})
+        .Define("max_z", Kernels::MaxOfPair, {"trk_sce_start_z_v", "trk_sce_end_z_v"});
+	  //.Filter("swtrig==1"); // keep only events passing the software trigger
+}
+
+std::vector<std::string> SlimmerModule::Inputs() const
+{
+    std::vector<std::string> in;
+    for (auto k : fShard.SelectFiles(fInputFiles.size())) in.push_back(fInputFiles[k]);
+    // The good-run lists, so the stage cache reruns when one changes
+    for (auto k : fShard.SelectFiles(fInputFiles.size()))
+        if (k < fGoodRunLists.size() && fGoodRunLists[k] != "-"
+            && std::find(in.begin(), in.end(), fGoodRunLists[k]) == in.end())
+            in.push_back(fGoodRunLists[k]);
+    return in;
+}
+
+std::vector<std::string> SlimmerModule::Outputs() const
+{
+    std::vector<std::string> out;
+    for (auto k : fShard.SelectFiles(fOutputFiles.size())) out.push_back(fShard.OutputName(fOutputFiles[k]));
+    return out;
+}
+
 Long64_t SlimmerModule::EntryCount() const
 {
-    
+    // A files-mode shard can be left with no files when N exceeds the file count
+    if (fShard.Active() && fShard.SelectFiles(fInputFiles.size()).empty()) return 1;
+
     if (dfVec.size() == 0) {
         throw std::runtime_error("[Slimmer] DataFrames not initialised!");
     }
@@ -85,16 +214,36 @@ void SlimmerModule::Initialise()
               //<< " and output file: " << fOutFile << "\n";
     //fChain = BuildInputChain(fInputFiles, fTreeName);
 
+    if (fOutputFiles.size() != fInputFiles.size())
+        throw std::runtime_error("[Slimmer] Need one output file per input file!");
+    if (!fGoodRunLists.empty() && fGoodRunLists.size() != fInputFiles.size())
+        throw std::runtime_error("[Slimmer] Need one Slimmer.GoodRunLists entry per input file (- for none)!");
+    // The slimmed ntuples feed every later stage, so they are always complete
+    if (PreviewSpec::FromConfig(Cfg()).Active())
+        std::cout << "[Slimmer] Global.Preview ignored: slimmed ntuples are always written in full\n";
+
+    // Only the files / entry ranges assigned to this shard (all of them if not sharded)
+    const auto selected = fShard.SelectFiles(fInputFiles.size());
+    if (selected.empty()) {
+        std::cout << "[Slimmer] No input files assigned to shard " << fShard.Index() << ", nothing to do.\n";
+        return;
+    }
+    std::vector<std::string> inputs;
+    for (auto k : selected) inputs.push_back(fInputFiles[k]);
+
     std::cout << "[Slimmer] Initialising with input files: \n";
-    for (const auto& file : fInputFiles) {
+    for (const auto& file : inputs) {
         std::cout << "  " << file << "\n";
     }
-    dfVec = BuildDataFrames(fInputFiles, fTreeName);
+    std::vector<ReadPlan> plans;
+    dfVec = BuildDataFrames(inputs, fTreeName, &plans);
 
     //Silly games to convert vector of unique_ptr<RDataFrame> to vector of RNodes
     std::vector<ROOT::RDF::RNode> nodes;
     nodes.reserve(dfVec.size());
-    for (auto &dfPtr : dfVec) nodes.emplace_back(*dfPtr);
+    for (std::size_t j = 0; j < dfVec.size(); ++j)
+        nodes.emplace_back(plans[j].entryList ? ROOT::RDF::RNode(*dfVec[j])
+                                              : fShard.Restrict(*dfVec[j], inputs[j], fTreeName));
 
     // RDataFrame takes ownership of the TChain pointer
     //fRDF = std::make_unique<ROOT::RDataFrame>(*fChain);
@@ -105,77 +254,39 @@ void SlimmerModule::Initialise()
     int fileIndex = 0;
     for (auto df : nodes) {
         std::cout << "[Slimmer] Number of entries in input file: " << df.Count().GetValue() << '\n';
-        std::string fOutFile = fOutputFiles[fileIndex];
+        std::string fOutFile = fShard.OutputName(fOutputFiles[selected[fileIndex]]);
         std::cout << "[Slimmer] Will write slimmed tree to: " << fOutFile << '\n';
+        const auto filters = EventFilters(inputs[fileIndex], selected[fileIndex]);
+        auto slim = [&filters](ROOT::RDF::RNode node, Long64_t first, Long64_t last) {
+            return DefineDerived(filters(node, first, last));
+        };
+        const auto [first, last] = fShard.EntryRange(TreeEntries(inputs[fileIndex], fTreeName));
+        auto df1 = slim(df, first, last);
 
-
-        // Fiducial variables to assess containment (taken from HNL analysis). The whole mess with big and small
-        // values is because in ext files the trk_sce_start_x_v vectors can be empty if there is no neutrino slice.
-        // In overlay this doesn't happen, but need to for data/ext files I think, so I set min/max to values outside the fiducial volume.
-
-        using VecF = const std::vector<float>&;
-
-        auto df1 = df
-        .Define("min_x",
-            [](VecF a, VecF b) {
-                const float small = -9999;
-                float aMin = a.empty() ? small : *std::min_element(a.begin(), a.end());
-                float bMin = b.empty() ? small : *std::min_element(b.begin(), b.end());
-                return std::min(aMin, bMin);
-            },
-            {"trk_sce_start_x_v", "trk_sce_end_x_v"})
-        .Define("max_x",
-                [](VecF a, VecF b) {
-                    const float big = 9999;
-                    float aMax = a.empty() ? big : *std::max_element(a.begin(), a.end());
-                    float bMax = b.empty() ? big : *std::max_element(b.begin(), b.end());
-                    return std::max(aMax, bMax);
-                },
-                {"trk_sce_start_x_v", "trk_sce_end_x_v"})
-        .Define("min_y",
-                [](VecF a, VecF b) {
-                    const float small = -9999;
-                    float aMin = a.empty() ? small : *std::min_element(a.begin(), a.end());
-                    float bMin = b.empty() ? small : *std::min_element(b.begin(), b.end());
-                    return std::min(aMin, bMin);
-                },
-                {"trk_sce_start_y_v", "trk_sce_end_y_v"})
-        .Define("max_y",
-                [](VecF a, VecF b) {
-                    const float big = 9999;
-                    float aMax = a.empty() ? big : *std::max_element(a.begin(), a.end());
-                    float bMax = b.empty() ? big : *std::max_element(b.begin(), b.end());
-                    return std::max(aMax, bMax);
-                },
-                {"trk_sce_start_y_v", "trk_sce_end_y_v"})
-        .Define("min_z",
-                [](VecF a, VecF b) {
-                    const float small = -9999;
-                    float aMin = a.empty() ? small : *std::min_element(a.begin(), a.end());
-                    float bMin = b.empty() ? small : *std::min_element(b.begin(), b.end());
-                    return std::min(aMin, bMin);
-                },
-                {"trk_sce_start_z_v", "trk_sce_end_z_v"})
-        .Define("max_z",
-                [](VecF a, VecF b) {
-                    const float big = 9999;
-                    float aMax = a.empty() ? big : *std::max_element(a.begin(), a.end());
-                    float bMax = b.empty() ? big : *std::max_element(b.begin(), b.end());
-                    return std::max(aMax, bMax);
-                },
-                {"trk_sce_start_z_v", "trk_sce_end_z_v"});
-	  //.Filter("swtrig==1"); // keep only events passing the software trigger
+        // Booked ahead of the snapshot so both share its event loop: the
+        // duplicate filter keeps each repeated key once per loop
+        auto subHist = df1.Histo1D({"sub_hist", ";run_number;Count", 50, 0, 600}, "sub");
 
         ROOT::RDF::RSnapshotOptions opt;
         opt.fMode = "RECREATE";
         opt.fCompressionAlgorithm = ROOT::kZLIB;
         opt.fCompressionLevel     = 4;
 
-        df1.Snapshot(fTreeName, fOutFile, fVarsToKeep, opt);
+        if (fCheckpointEntries > 0)
+            Checkpoint::SnapshotInChunks(slim, inputs[fileIndex], fTreeName, fShard,
+                                         fCheckpointEntries, fOutFile, fVarsToKeep, opt, fResume);
+        else
+            df1.Snapshot(fTreeName, fOutFile, fVarsToKeep, opt);
+
+        // Sidecar for run_eventlookup, indexing the entries as written
+        if (fEventIndex)
+            EventIndex::WriteSidecar(fOutFile, fTreeName, fIndexColumns);
+
+        // Per-cluster ranges for the Preselection and Plotter to skip clusters by
+        if (!fZoneMapColumns.empty())
+            ZoneMap::WriteSidecar(fOutFile, fTreeName, fZoneMapColumns);
 
-        Plotter::SaveHist(
-            df1.Histo1D({"sub_hist", ";run_number;Count", 50, 0, 600}, "sub").GetPtr(),
-            "slimmer_"+fRunLabel+"_run_histogram" , "prelim");
+        Plotter::SaveHist(subHist.GetPtr(), "slimmer_"+fRunLabel+"_run_histogram" , "prelim");
 
         fileIndex++;
     }
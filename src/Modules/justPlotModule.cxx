@@ -1,5 +1,9 @@
 #include "Modules/justPlotModule.hxx"
 #include "Utils/Plotter.hxx"
+#include "Utils/Kernels.hxx"
+#include "Utils/UniverseHist.hxx"
+#include "Utils/HistCache.hxx"
+#include "Utils/PlotBook.hxx"
 
 #include <TEnv.h>
 #include <TFile.h>
@@ -9,9 +13,14 @@
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <iomanip>
 #include <ROOT/RDataFrame.hxx>
+#include <ROOT/RDFHelpers.hxx>
 #include <TTree.h>
 #include <TH1D.h>
+#include <TH2D.h>
+#include <memory>
+#include <stdexcept>
 
 using namespace Analysis;
 
@@ -19,6 +28,13 @@ using namespace Analysis;
 PlotterModule::PlotterModule(const TEnv& cfg)
     : Module(cfg)
     , fTreeName   (cfg.GetValue("Plotter.TreeName", "nuselection/NeutrinoSelectionFilter"))
+    , fShard      (ShardSpec::FromConfig(cfg).ByEntries())
+    , fPreview    (PreviewSpec::FromConfig(cfg))
+    , fSystWeightType (cfg.GetValue("Plotter.SystWeightType", "ushort"))
+    , fSystWeightScale(cfg.GetValue("Plotter.SystWeightScale", fSystWeightType == "ushort" ? 1e-3 : 1.0))
+    , fSystFile       (cfg.GetValue("Plotter.SystOutputFile", "bdt_score_syst.root"))
+    , fHistOutputFile (cfg.GetValue("Plotter.HistOutputFile", ""))
+    , fPlots          (PlotBook::FromConfig(cfg, "Plotter"))
 {
     
     std::stringstream ssInput{cfg.GetValue("Plotter.InputFiles", "")};
@@ -40,12 +56,77 @@ PlotterModule::PlotterModule(const TEnv& cfg)
     while (ssWeights >> weight) {
         fSampleWeights.push_back(weight);
     }
+
+    std::stringstream ssWeightCols{cfg.GetValue("Plotter.SampleWeightColumns", "")};
+    while (ssWeightCols >> inputItem) {
+        if (inputItem.back()==',') inputItem.pop_back();
+        fSampleWeightColumns.push_back(inputItem == "-" ? "" : inputItem);
+    }
+
+    std::stringstream ssSyst{cfg.GetValue("Plotter.SystWeights", "")};
+    while (ssSyst >> inputItem) {
+        if (inputItem.back()==',') inputItem.pop_back();
+        fSystWeights.push_back(inputItem);
+    }
+
+    std::stringstream ssSystSamples{cfg.GetValue("Plotter.SystSamples", "")};
+    while (ssSystSamples >> label) {
+        if (label.back()==',') label.pop_back();
+        fSystSamples.push_back(label);
+    }
+
+    if (fSystWeightType != "ushort" && fSystWeightType != "float" && fSystWeightType != "double")
+        throw std::runtime_error("[Plotter] Unknown Plotter.SystWeightType: " + fSystWeightType);
+
+    std::stringstream ssGrid{cfg.GetValue("Plotter.GridPoints", "")};
+    while (ssGrid >> inputItem) {
+        if (inputItem.back()==',') inputItem.pop_back();
+        fGridPoints.push_back(inputItem);
+    }
+    std::stringstream ssGridFiles{cfg.GetValue("Plotter.GridSignalFiles", "")};
+    while (ssGridFiles >> inputItem) {
+        if (inputItem.back()==',') inputItem.pop_back();
+        fGridSignalFiles.push_back(inputItem);
+    }
+    fGridSignalSample = cfg.GetValue("Plotter.GridSignalSample", "");
+    fGridScoreColumn  = cfg.GetValue("Plotter.GridScoreColumn", "bdt_score_{point}");
+    if (!fGridPoints.empty()) {
+        if (fGridSignalFiles.size() != fGridPoints.size())
+            throw std::runtime_error("[Plotter] Plotter.GridSignalFiles needs one file per grid point");
+        if (std::find(fSampleLabels.begin(), fSampleLabels.end(), fGridSignalSample) == fSampleLabels.end())
+            throw std::runtime_error("[Plotter] Plotter.GridSignalSample is not a sample label: " + fGridSignalSample);
+    }
+
+    // Comma-separated like Preselection.Cuts, all of them applied
+    std::stringstream ssCuts{cfg.GetValue("Plotter.Cuts", "")};
+    std::string cut;
+    while (std::getline(ssCuts, cut, ',')) {
+        cut.erase(0, cut.find_first_not_of(" \t\n\r"));
+        cut.erase(cut.find_last_not_of(" \t\n\r") + 1);
+        if (!cut.empty()) fCuts.push_back(cut);
+    }
+    if (cfg.GetValue("Global.UseZoneMaps", 1) != 0)
+        fZoneTerms = ZoneMap::ParseCuts(fCuts);
+}
+
+//------------------------------------------------------------------------------
+ROOT::RDF::RResultPtr<UniverseHist>
+PlotterModule::BookUniverses(ROOT::RDF::RNode node, const std::string& name,
+                             const std::string& cvWeightCol, const std::string& wCol,
+                             int nBins, double xMin, double xMax) const
+{
+    if (fSystWeightType == "float")
+        return Analysis::BookUniverses<float>(node, name, "logit_bdt", cvWeightCol, wCol, nBins, xMin, xMax, fSystWeightScale);
+    if (fSystWeightType == "double")
+        return Analysis::BookUniverses<double>(node, name, "logit_bdt", cvWeightCol, wCol, nBins, xMin, xMax, fSystWeightScale);
+    return Analysis::BookUniverses<unsigned short>(node, name, "logit_bdt", cvWeightCol, wCol, nBins, xMin, xMax, fSystWeightScale);
 }
 
 //------------------------------------------------------------------------------
 std::vector<std::unique_ptr<ROOT::RDataFrame>>
 PlotterModule::BuildDataFrames(const std::vector<std::string>& files,
-                               const std::string& treeName) const
+                               const std::string& treeName,
+                               std::vector<ReadPlan>* plans) const
 {
     std::vector<std::unique_ptr<ROOT::RDataFrame>> dfVec;
     for (const auto& fname : files) {
@@ -57,6 +138,8 @@ PlotterModule::BuildDataFrames(const std::vector<std::string>& files,
         if (!tree) {
             throw std::runtime_error("[Plotter] Cannot find tree: " + treeName);
         }
+        const ReadPlan plan = ReadPlan::Apply(*tree, fname, treeName, fShard, fPreview, fZoneTerms);
+        if (plans) plans->push_back(plan);
         auto RDF = std::make_unique<ROOT::RDataFrame>(*tree);
         dfVec.push_back(std::move(RDF));
     }
@@ -66,8 +149,123 @@ PlotterModule::BuildDataFrames(const std::vector<std::string>& files,
     return dfVec;
 }
 
+//------------------------------------------------------------------------------
+ROOT::RDF::RNode PlotterModule::SampleNode(ROOT::RDataFrame& df, const std::string& file, const ReadPlan& plan) const
+{
+    // A read plan's entry list already covers only this shard's entries
+    ROOT::RDF::RNode node = plan.entryList ? ROOT::RDF::RNode(df) : fShard.Restrict(df, file, fTreeName);
+    for (const auto& cut : fCuts) node = node.Filter(cut);
+    return node;
+}
+
+
+
+//------------------------------------------------------------------------------
+PlotterModule::GridBooking
+PlotterModule::BookGrid(std::vector<ROOT::RDF::RNode>& nodes,
+                        const std::vector<std::string>& weightCols,
+                        const std::vector<std::string>& contexts,
+                        int nBins, double xMin, double xMax, bool renderOnly) const
+{
+    // Every point's background histograms are booked on the existing sample
+    // nodes, so the backgrounds are read once for the whole grid; each point
+    // brings only its own signal file.
+    const std::size_t sig = std::find(fSampleLabels.begin(), fSampleLabels.end(), fGridSignalSample)
+                            - fSampleLabels.begin();
+    const std::string sigWeightExpr = sig < fSampleWeightColumns.size() ? fSampleWeightColumns[sig] : "";
+    const double      sigScale      = sig < fSampleWeights.size() ? fSampleWeights[sig] : 1.0;
+    const std::size_t nSamples = fInputFiles.size();
+
+    GridBooking grid;
+    grid.lazy.assign(fGridPoints.size(), std::vector<ROOT::RDF::RResultPtr<TH1D>>(nSamples));
+    grid.hists.assign(fGridPoints.size(), std::vector<TH1D>(nSamples));
+    grid.keys.assign(fGridPoints.size(), std::vector<std::string>(nSamples));
+    grid.signalFrames.resize(fGridPoints.size());
+
+    HistCache* cache = Plotter::Cache();
+    for (std::size_t g = 0; g < fGridPoints.size(); ++g) {
+        const std::string& point = fGridPoints[g];
+        std::string scoreCol = fGridScoreColumn;
+        const auto at = scoreCol.find("{point}");
+        if (at != std::string::npos) scoreCol.replace(at, 7, point);
+        const std::string logitCol = "logit_" + scoreCol;
+
+        for (std::size_t i = 0; i < nSamples; ++i) {
+            std::string context = contexts[i];
+            if (i == sig) {
+                std::ostringstream ctx;
+                ctx << std::setprecision(17) << HistCache::FileIdentity({fGridSignalFiles[g]})
+                    << fTreeName << "\n" << fShard.Tag() << fPreview.Tag() << "\n";
+                for (const auto& cut : fCuts) ctx << cut << "\n";
+                ctx << "weight (" << sigWeightExpr << ") * " << sigScale;
+                context = ctx.str();
+            }
+            grid.keys[g][i] = HistCache::Key(context, logitCol, nBins, xMin, xMax);
+            if (cache) {
+                if (auto h = cache->Get<TH1D>(grid.keys[g][i])) {
+                    grid.hists[g][i] = *h;
+                    continue;
+                }
+            }
+            if (renderOnly)
+                throw std::runtime_error("[Plotter] Grid point " + point + " of " + fSampleLabels[i]
+                                         + " is not in the histogram cache; run once without --render-only");
+
+            ROOT::RDF::RNode node = nodes[i];
+            std::string weightCol = weightCols[i];
+            if (i == sig) {
+                // This point's signal, in its own data frame
+                std::vector<ReadPlan> plans;
+                auto frames = BuildDataFrames({fGridSignalFiles[g]}, fTreeName, &plans);
+                grid.signalFrames[g] = std::move(frames[0]);
+                node = SampleNode(*grid.signalFrames[g], fGridSignalFiles[g], plans[0]);
+                weightCol = Plotter::WeightColumn(node, "grid_" + point, sigWeightExpr,
+                                                  sigScale * plans[0].weightScale);
+            }
+            node = node.Define(logitCol, Kernels::Logit, {scoreCol});
+
+            const std::string name = "logit_bdt_" + point + "_" + (i == sig ? fGridSignalSample + "_" + point
+                                                                             : fSampleLabels[i]);
+            ROOT::RDF::TH1DModel model(name.c_str(), ";Logit BDT Score;Count", nBins, xMin, xMax);
+            grid.lazy[g][i] = weightCol.empty() ? node.Histo1D(model, logitCol)
+                                                : node.Histo1D(model, logitCol, weightCol);
+        }
+    }
+    return grid;
+}
+
+//------------------------------------------------------------------------------
+void PlotterModule::DrawGrid(GridBooking& grid) const
+{
+    // Loops that have not run yet (the signal files, or backgrounds whose
+    // nominal histograms came from the cache) run together
+    std::vector<ROOT::RDF::RResultHandle> handles;
+    for (const auto& point : grid.lazy)
+        for (const auto& r : point)
+            if (r) handles.emplace_back(r);
+    if (!handles.empty()) ROOT::RDF::RunGraphs(handles);
+
+    const std::size_t sig = std::find(fSampleLabels.begin(), fSampleLabels.end(), fGridSignalSample)
+                            - fSampleLabels.begin();
+    HistCache* cache = Plotter::Cache();
+    for (std::size_t g = 0; g < fGridPoints.size(); ++g) {
+        for (std::size_t i = 0; i < fInputFiles.size(); ++i) {
+            if (!grid.lazy[g][i]) continue;
+            grid.hists[g][i] = *grid.lazy[g][i];
+            grid.hists[g][i].SetDirectory(nullptr);
+            if (cache) cache->Put(grid.keys[g][i], grid.hists[g][i]);
+            grid.lazy[g][i] = ROOT::RDF::RResultPtr<TH1D>();
+        }
 
+        // The signal keeps "signal" in its label for the plot styling
+        std::vector<std::string> labels = fSampleLabels;
+        labels[sig] = fGridSignalSample + "_" + fGridPoints[g];
+        Plotter::FullDataMCSignalPlot(grid.hists[g], labels, "bdt_score_full_hist_" + fGridPoints[g],
+                                      false, {});
+    }
+}
 
+//------------------------------------------------------------------------------
 Long64_t PlotterModule::EntryCount() const
 {
     return 1; // Dummy, nothing per-event
@@ -76,41 +274,179 @@ Long64_t PlotterModule::EntryCount() const
 //------------------------------------------------------------------------------
 void PlotterModule::Initialise()
 {
-    auto dfVec = BuildDataFrames(fInputFiles, fTreeName);
+    // Render-only: histograms come from the cache and no ntuple is opened
+    const bool renderOnly = Plotter::RenderOnly();
+    std::vector<std::unique_ptr<ROOT::RDataFrame>> dfVec;
+    std::vector<ReadPlan> plans;
+    if (!renderOnly)
+        dfVec = BuildDataFrames(fInputFiles, fTreeName, &plans);
 
     std::vector<ROOT::RDF::RNode> nodes;
     nodes.reserve(dfVec.size());
-    for (auto &dfPtr : dfVec) nodes.emplace_back(*dfPtr);
+    for (std::size_t i = 0; i < dfVec.size(); ++i)
+        nodes.emplace_back(SampleNode(*dfVec[i], fInputFiles[i], plans[i]));
 
+    // Counted lazily, in the same event loop as the histograms
+    std::vector<ROOT::RDF::RResultPtr<ULong64_t>> counts;
     for (std::size_t i = 0; i < nodes.size(); ++i) {
-        auto before = nodes[i].Count().GetValue();
-        std::cout << "    " << fSampleLabels[i] << " before: " << before << '\n';
+        counts.push_back(nodes[i].Count());
+        nodes[i] = nodes[i].Define("logit_bdt", Kernels::Logit, {"bdt_score"});
+    }
+
+    // Per-event weight times the POT scale, shared by the nominal fill and the universes
+    std::vector<std::string> weightCols(fInputFiles.size());
+    std::vector<std::string> contexts(fInputFiles.size());
+    std::string allContexts;
+    for (std::size_t i = 0; i < fInputFiles.size(); ++i) {
+        const std::string weightExpr = i < fSampleWeightColumns.size() ? fSampleWeightColumns[i] : "";
+        const double      sampleW    = i < fSampleWeights.size() ? fSampleWeights[i] : 1.0;
+        const double      preview    = i < plans.size() ? plans[i].weightScale : 1.0;
+        if (!renderOnly)
+            weightCols[i] = Plotter::WeightColumn(nodes[i], "logit_bdt_" + fSampleLabels[i], weightExpr,
+                                                  sampleW * preview);
 
-        nodes[i] = nodes[i].Define("logit_bdt",
-            [](float score) {
-                const float eps = 1e-6f;
-                const float s = std::min(std::max(score, eps), 1.0f - eps);
-                return std::log(s / (1.0f - s));
-            },
-            {"bdt_score"});
+        // The cache context leaves out the preview's weight scale, as the grid
+        // points do: the file, shard and preview tag fix it, and a render-only
+        // run, which has no read plans, must build the same key
+        std::ostringstream ctx;
+        ctx << std::setprecision(17) << HistCache::FileIdentity({fInputFiles[i]})
+            << fTreeName << "\n" << fShard.Tag() << fPreview.Tag() << "\n";
+        for (const auto& cut : fCuts) ctx << cut << "\n";
+        ctx << "weight (" << weightExpr << ") * " << sampleW;
+        contexts[i] = ctx.str();
+        allContexts += contexts[i] + "\n";
     }
 
+    const int nBins = 11;
+    const double xMin = -5.0, xMax = 6.0;
+
+    // The total systematic covariance is cached alongside the histograms
+    std::unique_ptr<TH2D> bkgCov;
+    std::string covKey;
+    if (!fSystWeights.empty() && Plotter::Cache()) {
+        std::ostringstream syst;
+        syst << std::setprecision(17) << allContexts << "syst";
+        for (const auto& w : fSystWeights) syst << " " << w;
+        syst << " samples";
+        for (const auto& l : fSystSamples) syst << " " << l;
+        syst << " " << fSystWeightType << " " << fSystWeightScale;
+        covKey = HistCache::Key(syst.str(), "logit_bdt", nBins, xMin, xMax);
+        bkgCov = Plotter::Cache()->Get<TH2D>(covKey);
+    }
+    if (renderOnly && !fSystWeights.empty() && !bkgCov)
+        std::cerr << "[Plotter] Systematic covariance not in the histogram cache; drawing stat. band only\n";
+
+    // Universes are booked lazily before the nominal histogram, so every
+    // weight set of a sample is filled in that sample's single event loop.
+    // Histogramming in sharded runs is summed later, covariances are not.
+    const bool doSyst = !fSystWeights.empty() && !fShard.Active() && !renderOnly && !bkgCov;
+    std::vector<std::vector<ROOT::RDF::RResultPtr<UniverseHist>>> universes(nodes.size());
+    for (size_t i = 0; doSyst && i < nodes.size(); ++i) {
+        if (std::find(fSystSamples.begin(), fSystSamples.end(), fSampleLabels[i]) == fSystSamples.end())
+            continue;
+        for (const auto& w : fSystWeights)
+            universes[i].push_back(BookUniverses(nodes[i], w + "_" + fSampleLabels[i], weightCols[i], w,
+                                                 nBins, xMin, xMax));
+    }
+
+    // Config-driven plots (Plotter.Plots) are booked on the same nodes
+    std::vector<PlotBook::Booking> bookings;
+    for (size_t i = 0; i < fInputFiles.size() && !fPlots.Empty(); ++i)
+        bookings.push_back(fPlots.Book(renderOnly ? nullptr : &nodes[i], "plotter", fSampleLabels[i],
+                                       weightCols[i], contexts[i]));
+
+    // Signal grid points are booked on the same nodes too
+    GridBooking grid;
+    if (!fGridPoints.empty())
+        grid = BookGrid(nodes, weightCols, contexts, nBins, xMin, xMax, renderOnly);
+
     std::vector<TH1D> bdtScoreVec;
-    for (size_t i = 0; i < nodes.size(); ++i)
+    for (size_t i = 0; i < fInputFiles.size(); ++i)
         bdtScoreVec.push_back(
-            Plotter::CreateTH1DFromRNode(
-                nodes[i],
+            Plotter::CachedTH1D(
+                contexts[i], renderOnly ? nullptr : &nodes[i],
                 ("logit_bdt_" + fSampleLabels[i]).c_str(),
                 "logit_bdt", 
                 "Logit BDT Score",
                 "Count",
-                11, -5.0, 6.0)); 
+                nBins, xMin, xMax,
+                false, weightCols[i]));
+
+    // Sum the samples universe by universe (same universe index = same
+    // throw), then sum the covariances of the independent weight sets.
+    // Samples without weights shift no universe and add no covariance.
+    if (doSyst) {
+        std::unique_ptr<TFile> out{TFile::Open(fSystFile.c_str(), "RECREATE")};
+        if (!out || out->IsZombie())
+            throw std::runtime_error("[Plotter] Cannot create file: " + fSystFile);
+
+        for (size_t k = 0; k < fSystWeights.size(); ++k) {
+            UniverseHist total;
+            for (size_t i = 0; i < nodes.size(); ++i)
+                if (!universes[i].empty()) total.Add(*universes[i][k]);
+            if (total.NUniverses() == 0) continue;
+            std::cout << "[Plotter] " << fSystWeights[k] << ": " << total.NUniverses() << " universes\n";
+
+            TH2D cov = total.Covariance();
+            TH1D band = total.ErrorBand();
+            cov.SetName(("cov_" + fSystWeights[k]).c_str());
+            band.SetName(("band_" + fSystWeights[k]).c_str());
+            out->cd();
+            cov.Write();
+            band.Write();
+
+            if (!bkgCov) {
+                bkgCov.reset(static_cast<TH2D*>(cov.Clone("cov_total")));
+                bkgCov->SetDirectory(nullptr);
+            }
+            else {
+                bkgCov->Add(&cov);
+            }
+        }
+        if (bkgCov) {
+            out->cd();
+            bkgCov->Write();
+            if (Plotter::Cache()) Plotter::Cache()->Put(covKey, *bkgCov);
+        }
+        out->Close();
+    }
+
+    for (auto& b : bookings) fPlots.Collect(b, "plotter");
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        std::cout << "    " << fSampleLabels[i] << (fCuts.empty() ? " before: " : " after Plotter.Cuts: ")
+                  << *counts[i];
+        if (fPreview.Active()) std::cout << "  " << PreviewSpec::Estimate(*counts[i], plans[i].weightScale);
+        std::cout << '\n';
+    }
 
     Plotter::FullDataMCSignalPlot(bdtScoreVec,
                         fSampleLabels,
                         "bdt_score_full_hist",
                         false, // logy
-                        fSampleWeights);
+                        {},    // weights already applied per event
+                        bkgCov.get());
+
+    if (!fGridPoints.empty()) DrawGrid(grid);
+
+    // Histograms by sample (and grid point) for LimitModule
+    if (!fHistOutputFile.empty()) {
+        const std::string histFile = fShard.OutputName(fHistOutputFile);
+        std::unique_ptr<TFile> out{TFile::Open(histFile.c_str(), "RECREATE")};
+        if (!out || out->IsZombie())
+            throw std::runtime_error("[Plotter] Cannot create file: " + histFile);
+        out->cd();
+        for (std::size_t i = 0; i < bdtScoreVec.size(); ++i)
+            bdtScoreVec[i].Write(("logit_bdt_" + fSampleLabels[i]).c_str());
+        for (std::size_t g = 0; g < grid.hists.size(); ++g)
+            for (std::size_t i = 0; i < grid.hists[g].size(); ++i)
+                grid.hists[g][i].Write(("logit_bdt_" + fGridPoints[g] + "_" + fSampleLabels[i]).c_str());
+        out->Close();
+    }
+
+    if (!bookings.empty()) {
+        const std::string plotFile = fPlots.OutputFile();
+        fPlots.Draw(bookings, fSampleLabels, "plotter", plotFile.empty() ? "" : fShard.OutputName(plotFile));
+    }
     
 }
 
@@ -0,0 +1,195 @@
+#include "Utils/CutScan.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+using namespace Analysis;
+
+// ----------------------------------------------------------------------//
+void ScoredEvents::Append(const ScoredEvents& other)
+{
+    x.insert(x.end(), other.x.begin(), other.x.end());
+    y.insert(y.end(), other.y.begin(), other.y.end());
+    w.insert(w.end(), other.w.begin(), other.w.end());
+}
+
+// ----------------------------------------------------------------------//
+CutScan::Sorted::Sorted(ScoredEvents ev)
+{
+    const std::size_t n = ev.Size();
+    if (ev.w.size() != n || (!ev.y.empty() && ev.y.size() != n))
+        throw std::runtime_error("[CutScan] x, y and weight arrays differ in length");
+
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&ev](std::size_t a, std::size_t b) { return ev.x[a] > ev.x[b]; });
+
+    x.resize(n);
+    w.resize(n);
+    if (!ev.y.empty()) y.resize(n);
+    cumW.assign(n + 1, 0.);
+    cumW2.assign(n + 1, 0.);
+    for (std::size_t k = 0; k < n; ++k) {
+        const std::size_t i = order[k];
+        x[k] = ev.x[i];
+        w[k] = ev.w[i];
+        if (!y.empty()) y[k] = ev.y[i];
+        cumW[k + 1]  = cumW[k]  + w[k];
+        cumW2[k + 1] = cumW2[k] + w[k] * w[k];
+    }
+}
+
+// ----------------------------------------------------------------------//
+std::size_t CutScan::Sorted::Above(double cut) const
+{
+    // x is descending: the events passing x > cut are a prefix
+    return std::partition_point(x.begin(), x.end(), [cut](double v) { return v > cut; }) - x.begin();
+}
+
+// ----------------------------------------------------------------------//
+CutScan::FoM CutScan::ParseFoM(const std::string& name)
+{
+    if (name == "s_over_sqrtb") return FoM::SOverSqrtB;
+    if (name == "asimov")       return FoM::Asimov;
+    if (name == "punzi")        return FoM::Punzi;
+    throw std::runtime_error("[CutScan] Unknown figure of merit: " + name
+                             + " (s_over_sqrtb | asimov | punzi)");
+}
+
+// ----------------------------------------------------------------------//
+double CutScan::Evaluate(FoM fom, double s, double b, double sTotal, double punziSigma)
+{
+    switch (fom) {
+    case FoM::SOverSqrtB:
+        return b > 0. ? s / std::sqrt(b) : 0.;
+    case FoM::Asimov:
+        // Median discovery significance for known b (Cowan et al.)
+        if (b <= 0. || s <= 0.) return 0.;
+        return std::sqrt(2. * ((s + b) * std::log1p(s / b) - s));
+    case FoM::Punzi: {
+        const double eff = sTotal > 0. ? s / sTotal : 0.;
+        return eff / (0.5 * punziSigma + std::sqrt(std::max(b, 0.)));
+    }
+    }
+    return 0.;
+}
+
+// ----------------------------------------------------------------------//
+CutScan::CutScan(ScoredEvents sig, ScoredEvents bkg)
+    : fSig(std::move(sig)), fBkg(std::move(bkg)) {}
+
+// ----------------------------------------------------------------------//
+std::vector<double> CutScan::Thresholds(int nThresholds, double min, double max)
+{
+    if (nThresholds <= 0 || !(max > min))
+        throw std::runtime_error("[CutScan] Invalid threshold range");
+    std::vector<double> cuts(nThresholds);
+    const double step = (max - min) / nThresholds;
+    for (int i = 0; i < nThresholds; ++i) cuts[i] = min + i * step;
+    return cuts;
+}
+
+// ----------------------------------------------------------------------//
+std::pair<double, double> CutScan::Range() const
+{
+    double lo = 0., hi = 0.;
+    bool any = false;
+    for (const Sorted* ev : {&fSig, &fBkg}) {
+        if (ev->x.empty()) continue;
+        lo  = any ? std::min(lo, ev->x.back())  : ev->x.back();
+        hi  = any ? std::max(hi, ev->x.front()) : ev->x.front();
+        any = true;
+    }
+    return {lo, hi};
+}
+
+// ----------------------------------------------------------------------//
+std::vector<CutScan::Point> CutScan::Scan(const std::vector<double>& cuts, FoM fom, double punziSigma) const
+{
+    const double sTotal = fSig.Total();
+    std::vector<Point> out(cuts.size());
+    for (std::size_t i = 0; i < cuts.size(); ++i) {
+        const std::size_t ks = fSig.Above(cuts[i]);
+        const std::size_t kb = fBkg.Above(cuts[i]);
+        Point& p = out[i];
+        p.cut    = cuts[i];
+        p.s      = fSig.cumW[ks];
+        p.b      = fBkg.cumW[kb];
+        p.sumw2B = fBkg.cumW2[kb];
+        p.fom    = Evaluate(fom, p.s, p.b, sTotal, punziSigma);
+    }
+    return out;
+}
+
+// ----------------------------------------------------------------------//
+template <typename Row>
+void CutScan::Sweep(const Sorted& ev, const std::vector<double>& cutsX,
+                    const std::vector<double>& cutsY, Row&& row)
+{
+    const std::size_t nY = cutsY.size();
+
+    // y cuts in ascending order; an event with rank p passes the first p of them
+    std::vector<std::size_t> orderY(nY);
+    std::iota(orderY.begin(), orderY.end(), 0);
+    std::sort(orderY.begin(), orderY.end(), [&cutsY](std::size_t a, std::size_t b) { return cutsY[a] < cutsY[b]; });
+    std::vector<double> sortedY(nY);
+    for (std::size_t r = 0; r < nY; ++r) sortedY[r] = cutsY[orderY[r]];
+
+    std::vector<std::size_t> orderX(cutsX.size());
+    std::iota(orderX.begin(), orderX.end(), 0);
+    std::sort(orderX.begin(), orderX.end(), [&cutsX](std::size_t a, std::size_t b) { return cutsX[a] > cutsX[b]; });
+
+    std::vector<double> histW(nY + 1, 0.), histW2(nY + 1, 0.);
+    std::vector<double> sumW(nY), sumW2(nY);
+    std::size_t k = 0;
+    for (const std::size_t ix : orderX) {
+        for (; k < ev.x.size() && ev.x[k] > cutsX[ix]; ++k) {
+            const std::size_t p = std::lower_bound(sortedY.begin(), sortedY.end(), ev.y[k]) - sortedY.begin();
+            histW[p]  += ev.w[k];
+            histW2[p] += ev.w[k] * ev.w[k];
+        }
+        // Passing y cut r means rank > r: suffix sums from the top
+        double accW = 0., accW2 = 0.;
+        for (std::size_t r = nY; r-- > 0;) {
+            accW  += histW[r + 1];
+            accW2 += histW2[r + 1];
+            sumW[orderY[r]]  = accW;
+            sumW2[orderY[r]] = accW2;
+        }
+        row(ix, sumW, sumW2);
+    }
+}
+
+// ----------------------------------------------------------------------//
+std::vector<CutScan::Point> CutScan::Scan2D(const std::vector<double>& cutsX, const std::vector<double>& cutsY,
+                                            FoM fom, double punziSigma) const
+{
+    if (fSig.y.size() != fSig.x.size() || fBkg.y.size() != fBkg.x.size())
+        throw std::runtime_error("[CutScan] 2D scan needs y values for every event");
+
+    const std::size_t nY = cutsY.size();
+    std::vector<Point> out(cutsX.size() * nY);
+    Sweep(fSig, cutsX, cutsY, [&](std::size_t ix, const std::vector<double>& w, const std::vector<double>&) {
+        for (std::size_t iy = 0; iy < nY; ++iy) out[ix * nY + iy].s = w[iy];
+    });
+    Sweep(fBkg, cutsX, cutsY, [&](std::size_t ix, const std::vector<double>& w, const std::vector<double>& w2) {
+        for (std::size_t iy = 0; iy < nY; ++iy) {
+            out[ix * nY + iy].b      = w[iy];
+            out[ix * nY + iy].sumw2B = w2[iy];
+        }
+    });
+
+    const double sTotal = fSig.Total();
+    for (std::size_t ix = 0; ix < cutsX.size(); ++ix) {
+        for (std::size_t iy = 0; iy < nY; ++iy) {
+            Point& p = out[ix * nY + iy];
+            p.cut  = cutsX[ix];
+            p.cutY = cutsY[iy];
+            p.fom  = Evaluate(fom, p.s, p.b, sTotal, punziSigma);
+        }
+    }
+    return out;
+}
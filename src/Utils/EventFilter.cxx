@@ -0,0 +1,232 @@
+#include "Utils/EventFilter.hxx"
+#include "Utils/TreeScan.hxx"
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace Analysis;
+
+namespace {
+
+// splitmix64 finaliser
+std::uint64_t Mix(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+struct KeyHash {
+    std::size_t operator()(const EventKey& k) const
+    {
+        return Mix(((static_cast<std::uint64_t>(k.run) << 32) | k.sub) ^ Mix(k.evt));
+    }
+};
+
+constexpr std::size_t kShards       = 64;   ///< hash-set shards, each with its own lock
+constexpr std::size_t kBytesPerKey  = 64;   ///< unordered_map node and bucket, roughly
+constexpr int         kBloomHashes  = 4;
+
+} // namespace
+
+// ----------------------------------------------------------------------//
+GoodRunList GoodRunList::FromFile(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("[GoodRunList] Cannot open " + path);
+
+    struct Range { std::uint32_t run, first, last; bool all; };
+    std::vector<Range> ranges;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        long long run;
+        if (!(ss >> run)) continue;
+        if (run < 0) throw std::runtime_error("[GoodRunList] Negative run in " + path);
+        std::string subs;
+        Range r{static_cast<std::uint32_t>(run), 0, 0, !(ss >> subs)};
+        if (!r.all) {
+            const auto dash = subs.find('-');
+            try {
+                r.first = static_cast<std::uint32_t>(std::stoul(subs.substr(0, dash)));
+                r.last  = dash == std::string::npos ? r.first
+                                                    : static_cast<std::uint32_t>(std::stoul(subs.substr(dash + 1)));
+            }
+            catch (const std::exception&) {
+                throw std::runtime_error("[GoodRunList] Bad subrun range '" + subs + "' in " + path);
+            }
+            if (r.last < r.first)
+                throw std::runtime_error("[GoodRunList] Empty subrun range '" + subs + "' in " + path);
+        }
+        ranges.push_back(r);
+    }
+    if (ranges.empty()) throw std::runtime_error("[GoodRunList] No runs in " + path);
+
+    const auto [lo, hi] = std::minmax_element(ranges.begin(), ranges.end(),
+                                              [](const Range& a, const Range& b) { return a.run < b.run; });
+    GoodRunList grl;
+    grl.fFirstRun = lo->run;
+    grl.fSlot.assign(static_cast<std::size_t>(hi->run - lo->run) + 1, kBad);
+    for (const auto& r : ranges) {
+        auto& slot = grl.fSlot[r.run - grl.fFirstRun];
+        if (slot == kAllSubruns) continue;
+        if (r.all) {
+            slot = kAllSubruns;
+            continue;
+        }
+        if (slot == kBad) {
+            slot = static_cast<std::int32_t>(grl.fSubruns.size());
+            grl.fSubruns.emplace_back();
+        }
+        auto& bits = grl.fSubruns[slot];
+        if (bits.size() <= r.last / 64) bits.resize(r.last / 64 + 1, 0);
+        for (std::uint32_t s = r.first; s <= r.last; ++s) bits[s / 64] |= std::uint64_t{1} << (s % 64);
+    }
+    return grl;
+}
+
+// ----------------------------------------------------------------------//
+std::size_t GoodRunList::NRuns() const
+{
+    return static_cast<std::size_t>(std::count_if(fSlot.begin(), fSlot.end(),
+                                                  [](std::int32_t s) { return s != kBad; }));
+}
+
+// ----------------------------------------------------------------------//
+DuplicateFilter DuplicateFilter::Scan(const std::string& file, const std::string& treeName,
+                                      const std::vector<std::string>& keyColumns, std::size_t memoryMB)
+{
+    if (keyColumns.size() != 3)
+        throw std::runtime_error("[DuplicateFilter] Need the run, subrun and event columns");
+
+    DuplicateFilter filter;
+    {
+        std::unique_ptr<TFile> f{TFile::Open(file.c_str(), "READ")};
+        auto* tree = f && !f->IsZombie() ? f->Get<TTree>(treeName.c_str()) : nullptr;
+        if (!tree) throw std::runtime_error("[DuplicateFilter] Cannot read " + treeName + " from " + file);
+        filter.fEntries = tree->GetEntries();
+    }
+
+    auto keyOf = [](const TreeScan::Values& v) {
+        return EventKey{static_cast<std::uint32_t>(v.Get(0)), static_cast<std::uint32_t>(v.Get(1)),
+                        static_cast<std::uint32_t>(v.Get(2))};
+    };
+    const std::size_t budget = memoryMB << 20;
+
+    if (static_cast<std::size_t>(filter.fEntries) * kBytesPerKey <= budget) {
+        // Exact: every key with its lowest entry and number of copies
+        struct Seen {
+            Long64_t      first  = 0;
+            std::uint32_t copies = 0;
+        };
+        struct Shard {
+            std::mutex                                   mtx;
+            std::unordered_map<EventKey, Seen, KeyHash>  keys;
+        };
+        std::vector<Shard> shards(kShards);
+        for (auto& s : shards) s.keys.reserve(static_cast<std::size_t>(filter.fEntries) / kShards + 1);
+
+        TreeScan::ForEach(file, treeName, keyColumns, 0, filter.fEntries,
+                          [&](std::size_t, Long64_t entry, const TreeScan::Values& v) {
+            const EventKey key = keyOf(v);
+            auto& shard = shards[(KeyHash{}(key) >> 32) % kShards];
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            auto& seen = shard.keys.try_emplace(key, Seen{entry, 0}).first->second;
+            seen.first = std::min(seen.first, entry);
+            ++seen.copies;
+        });
+
+        for (const auto& s : shards)
+            for (const auto& [key, seen] : s.keys)
+                if (seen.copies > 1) {
+                    filter.fRepeated.push_back({key, seen.first});
+                    filter.fNDuplicates += seen.copies - 1;
+                }
+    }
+    else {
+        // Bloom filters of the keys seen at least once and at least twice. The
+        // fetch_or orders the two copies of a key on every bit, so the second
+        // always marks "twice", whichever thread it runs on.
+        filter.fBloom = true;
+        const std::size_t words = std::max<std::size_t>(1, budget / (2 * sizeof(std::uint64_t)));
+        const std::uint64_t nBits = static_cast<std::uint64_t>(words) * 64;
+        std::vector<std::atomic<std::uint64_t>> once(words), twice(words);
+
+        auto bitsOf = [nBits](const EventKey& key, std::uint64_t* bits) {
+            const std::uint64_t h1 = KeyHash{}(key), h2 = Mix(h1) | 1;
+            for (int i = 0; i < kBloomHashes; ++i) bits[i] = (h1 + i * h2) % nBits;
+        };
+
+        TreeScan::ForEach(file, treeName, keyColumns, 0, filter.fEntries,
+                          [&](std::size_t, Long64_t, const TreeScan::Values& v) {
+            std::uint64_t bits[kBloomHashes];
+            bitsOf(keyOf(v), bits);
+            for (const auto b : bits) {
+                const std::uint64_t mask = std::uint64_t{1} << (b % 64);
+                if (once[b / 64].fetch_or(mask, std::memory_order_relaxed) & mask)
+                    twice[b / 64].fetch_or(mask, std::memory_order_relaxed);
+            }
+        });
+
+        // Exact confirmation over the flagged keys only: true copies plus false positives
+        std::vector<std::vector<std::pair<EventKey, Long64_t>>> perTask(TreeScan::MaxTasks());
+        TreeScan::ForEach(file, treeName, keyColumns, 0, filter.fEntries,
+                          [&](std::size_t t, Long64_t entry, const TreeScan::Values& v) {
+            const EventKey key = keyOf(v);
+            std::uint64_t bits[kBloomHashes];
+            bitsOf(key, bits);
+            for (const auto b : bits)
+                if (!(twice[b / 64].load(std::memory_order_relaxed) & (std::uint64_t{1} << (b % 64)))) return;
+            perTask[t].emplace_back(key, entry);
+        });
+
+        std::vector<std::pair<EventKey, Long64_t>> candidates;
+        for (const auto& c : perTask) candidates.insert(candidates.end(), c.begin(), c.end());
+        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            return a.first == b.first ? a.second < b.second : a.first < b.first;
+        });
+        for (std::size_t i = 0, j = 0; i < candidates.size(); i = j) {
+            while (j < candidates.size() && candidates[j].first == candidates[i].first) ++j;
+            if (j - i < 2) continue;
+            filter.fRepeated.push_back({candidates[i].first, candidates[i].second});
+            filter.fNDuplicates += j - i - 1;
+        }
+    }
+
+    std::sort(filter.fRepeated.begin(), filter.fRepeated.end(),
+              [](const Repeated& a, const Repeated& b) { return a.key < b.key; });
+    return filter;
+}
+
+// ----------------------------------------------------------------------//
+DuplicateFilter::Pass::Pass(const DuplicateFilter& filter, Long64_t first, Long64_t last)
+    : fFilter(filter), fFirst(first), fLast(last), fKept((filter.fRepeated.size() + 63) / 64)
+{
+}
+
+// ----------------------------------------------------------------------//
+bool DuplicateFilter::Pass::Keep(std::uint32_t run, std::uint32_t sub, std::uint32_t evt)
+{
+    const EventKey key{run, sub, evt};
+    const auto& repeated = fFilter.fRepeated;
+    const auto it = std::lower_bound(repeated.begin(), repeated.end(), key,
+                                     [](const Repeated& r, const EventKey& k) { return r.key < k; });
+    if (it == repeated.end() || !(it->key == key)) return true;
+    if (it->first < fFirst || it->first >= fLast) return false;
+
+    // The first copy to set the key's bit is the one kept
+    const auto i = static_cast<std::size_t>(it - repeated.begin());
+    const std::uint64_t mask = std::uint64_t{1} << (i % 64);
+    return !(fKept[i / 64].fetch_or(mask, std::memory_order_relaxed) & mask);
+}
@@ -0,0 +1,194 @@
+#include "Utils/EventIndex.hxx"
+#include "Utils/TreeScan.hxx"
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+namespace {
+
+constexpr char kMagic[8] = {'E', 'V', 'T', 'I', 'D', 'X', '0', '1'};
+
+bool RecordLess(const EventKey& a, std::uint32_t fa, std::int64_t ea,
+                const EventKey& b, std::uint32_t fb, std::int64_t eb)
+{
+    if (!(a == b)) return a < b;
+    if (fa != fb)  return fa < fb;
+    return ea < eb;
+}
+
+template <typename T>
+void Put(std::ofstream& out, const T& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+template <typename T>
+void Get(std::ifstream& in, T& v) { in.read(reinterpret_cast<char*>(&v), sizeof(T)); }
+
+} // namespace
+
+// ----------------------------------------------------------------------//
+EventKey EventKey::Parse(const std::string& text)
+{
+    EventKey k;
+    std::string s = text;
+    std::replace(s.begin(), s.end(), ':', ' ');
+    std::istringstream ss(s);
+    long long run, sub, evt;
+    if (!(ss >> run >> sub >> evt) || run < 0 || sub < 0 || evt < 0)
+        throw std::runtime_error("[EventIndex] Expected run:sub:evt, got " + text);
+    k.run = static_cast<std::uint32_t>(run);
+    k.sub = static_cast<std::uint32_t>(sub);
+    k.evt = static_cast<std::uint32_t>(evt);
+    return k;
+}
+
+// ----------------------------------------------------------------------//
+EventIndex EventIndex::Build(const std::vector<std::string>& files, const std::string& treeName,
+                             const std::vector<std::string>& keyColumns)
+{
+    if (keyColumns.size() != 3)
+        throw std::runtime_error("[EventIndex] Need the run, subrun and event columns");
+
+    EventIndex idx;
+    for (const auto& file : files) {
+        Long64_t nEntries = 0;
+        {
+            std::unique_ptr<TFile> f{TFile::Open(file.c_str(), "READ")};
+            auto* tree = (f && !f->IsZombie()) ? f->Get<TTree>(treeName.c_str()) : nullptr;
+            if (!tree) throw std::runtime_error("[EventIndex] Cannot read " + treeName + " from " + file);
+            nEntries = tree->GetEntries();
+        }
+
+        // Only the three key columns are read, straight from the tree: the
+        // record needs the tree entry, which rdfentry_ is not under implicit MT
+        const auto fileId = static_cast<std::uint32_t>(idx.fFiles.size());
+        idx.fFiles.push_back(file);
+        std::vector<std::vector<Record>> perTask(TreeScan::MaxTasks());
+        TreeScan::ForEach(file, treeName, keyColumns, 0, nEntries,
+                          [&perTask, fileId](std::size_t t, Long64_t entry, const TreeScan::Values& v) {
+            Record r;
+            r.key   = {static_cast<std::uint32_t>(v.Get(0)), static_cast<std::uint32_t>(v.Get(1)),
+                       static_cast<std::uint32_t>(v.Get(2))};
+            r.file  = fileId;
+            r.entry = static_cast<std::int64_t>(entry);
+            perTask[t].push_back(r);
+        });
+        idx.fRecords.reserve(idx.fRecords.size() + static_cast<std::size_t>(nEntries));
+        for (const auto& records : perTask)
+            idx.fRecords.insert(idx.fRecords.end(), records.begin(), records.end());
+    }
+    std::sort(idx.fRecords.begin(), idx.fRecords.end(), [](const Record& a, const Record& b) {
+        return RecordLess(a.key, a.file, a.entry, b.key, b.file, b.entry);
+    });
+    return idx;
+}
+
+// ----------------------------------------------------------------------//
+void EventIndex::WriteSidecar(const std::string& file, const std::string& treeName,
+                              const std::vector<std::string>& keyColumns)
+{
+    Build({file}, treeName, keyColumns).Write(SidecarPath(file));
+}
+
+// ----------------------------------------------------------------------//
+void EventIndex::Write(const std::string& path) const
+{
+    // magic, file count, (length, name) per file, record count, records
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("[EventIndex] Cannot write " + path);
+    out.write(kMagic, sizeof(kMagic));
+    Put(out, static_cast<std::uint32_t>(fFiles.size()));
+    for (const auto& f : fFiles) {
+        Put(out, static_cast<std::uint32_t>(f.size()));
+        out.write(f.data(), static_cast<std::streamsize>(f.size()));
+    }
+    Put(out, static_cast<std::uint64_t>(fRecords.size()));
+    out.write(reinterpret_cast<const char*>(fRecords.data()),
+              static_cast<std::streamsize>(fRecords.size() * sizeof(Record)));
+    if (!out) throw std::runtime_error("[EventIndex] Failed writing " + path);
+}
+
+// ----------------------------------------------------------------------//
+EventIndex EventIndex::Read(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("[EventIndex] Cannot open " + path);
+
+    char magic[sizeof(kMagic)];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+        throw std::runtime_error("[EventIndex] Not an event index: " + path);
+
+    EventIndex idx;
+    std::uint32_t nFiles = 0;
+    Get(in, nFiles);
+    for (std::uint32_t f = 0; f < nFiles && in; ++f) {
+        std::uint32_t len = 0;
+        Get(in, len);
+        std::string name(len, '\0');
+        in.read(name.data(), len);
+        idx.fFiles.push_back(std::move(name));
+    }
+    std::uint64_t nRecords = 0;
+    Get(in, nRecords);
+    idx.fRecords.resize(nRecords);
+    in.read(reinterpret_cast<char*>(idx.fRecords.data()), static_cast<std::streamsize>(nRecords * sizeof(Record)));
+    if (!in) throw std::runtime_error("[EventIndex] Truncated index: " + path);
+    return idx;
+}
+
+// ----------------------------------------------------------------------//
+void EventIndex::Merge(const EventIndex& other)
+{
+    const auto offset = static_cast<std::uint32_t>(fFiles.size());
+    fFiles.insert(fFiles.end(), other.fFiles.begin(), other.fFiles.end());
+
+    const std::size_t mid = fRecords.size();
+    fRecords.reserve(mid + other.fRecords.size());
+    for (Record r : other.fRecords) {
+        r.file += offset;
+        fRecords.push_back(r);
+    }
+    // Both halves are sorted, and every file id of the second exceeds the first's
+    std::inplace_merge(fRecords.begin(), fRecords.begin() + mid, fRecords.end(),
+                       [](const Record& a, const Record& b) {
+                           return RecordLess(a.key, a.file, a.entry, b.key, b.file, b.entry);
+                       });
+}
+
+// ----------------------------------------------------------------------//
+std::vector<EventIndex::Location> EventIndex::Find(const EventKey& key) const
+{
+    struct KeyLess {
+        bool operator()(const Record& r, const EventKey& k) const { return r.key < k; }
+        bool operator()(const EventKey& k, const Record& r) const { return k < r.key; }
+    };
+    const auto [lo, hi] = std::equal_range(fRecords.begin(), fRecords.end(), key, KeyLess{});
+    std::vector<Location> out;
+    for (auto it = lo; it != hi; ++it) out.push_back({fFiles[it->file], it->entry});
+    return out;
+}
+
+// ----------------------------------------------------------------------//
+bool EventIndex::Contains(const EventKey& key) const
+{
+    const auto it = std::lower_bound(fRecords.begin(), fRecords.end(), key,
+                                     [](const Record& r, const EventKey& k) { return r.key < k; });
+    return it != fRecords.end() && it->key == key;
+}
+
+// ----------------------------------------------------------------------//
+std::vector<EventKey> EventIndex::Keys() const
+{
+    std::vector<EventKey> keys;
+    for (const auto& r : fRecords)
+        if (keys.empty() || !(keys.back() == r.key)) keys.push_back(r.key);
+    return keys;
+}
@@ -0,0 +1,43 @@
+#include "Utils/EventMatrix.hxx"
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RDFHelpers.hxx>
+
+#include <stdexcept>
+
+using namespace Analysis;
+
+// ----------------------------------------------------------------------//
+void EventMatrix::Append(const std::string& file, const std::string& treeName,
+                         const std::string& weightCol, bool signal)
+{
+    if (vars.empty())
+        throw std::runtime_error("[EventMatrix] No variables to read from " + file);
+
+    // One event loop for all columns
+    ROOT::RDataFrame df(treeName, file);
+    ROOT::RDF::RNode node = df;
+    std::vector<ROOT::RDF::RResultPtr<std::vector<float>>> cols;
+    std::vector<ROOT::RDF::RResultHandle> handles;
+    for (std::size_t k = 0; k < vars.size(); ++k) {
+        const std::string col = "matrix_var_" + std::to_string(k);
+        node = node.Define(col, "static_cast<float>(" + vars[k] + ")");
+        cols.push_back(node.Take<float>(col));
+        handles.emplace_back(cols.back());
+    }
+    node = node.Define("matrix_weight", weightCol.empty() ? "1.0" : "static_cast<double>(" + weightCol + ")");
+    auto w = node.Take<double>("matrix_weight");
+    handles.emplace_back(w);
+    ROOT::RDF::RunGraphs(handles);
+
+    const std::size_t nVars = vars.size();
+    const std::size_t first = Size();
+    const std::size_t n     = w->size();
+    values.resize((first + n) * nVars);
+    for (std::size_t k = 0; k < nVars; ++k) {
+        const auto& v = *cols[k];
+        for (std::size_t i = 0; i < n; ++i) values[(first + i) * nVars + k] = v[i];
+    }
+    weights.insert(weights.end(), w->begin(), w->end());
+    isSignal.insert(isSignal.end(), n, signal ? 1 : 0);
+}
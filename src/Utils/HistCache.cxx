@@ -0,0 +1,82 @@
+#include "Utils/HistCache.hxx"
+#include "Framework/StageCache.hxx"
+
+#include <TDirectory.h>
+#include <TSystem.h>
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+// ----------------------------------------------------------------------//
+std::string HistCache::FileIdentity(const std::vector<std::string>& files)
+{
+    std::ostringstream id;
+    for (const auto& path : files) {
+        FileStat_t info;
+        if (gSystem->GetPathInfo(path.c_str(), info) != 0)
+            id << path << " missing\n";
+        else
+            id << path << " " << info.fSize << " " << info.fMtime << "\n";
+    }
+    return id.str();
+}
+
+// ----------------------------------------------------------------------//
+std::string HistCache::Key(const std::string& context,
+                           const std::string& varName,
+                           int nBins, double xMin, double xMax,
+                           bool firstElement)
+{
+    std::ostringstream key;
+    key << std::setprecision(17)
+        << context << "\n"
+        << "var " << varName << (firstElement ? "[0]" : "") << "\n"
+        << "bins " << nBins << " " << xMin << " " << xMax << "\n";
+    return StageCache::Hash(key.str());
+}
+
+// ----------------------------------------------------------------------//
+TFile* HistCache::File(bool write) const
+{
+    if (fFile && (fWritable || !write)) return fFile.get();
+
+    // Opening a file makes it the current directory; histograms created
+    // afterwards must not end up in the cache
+    TDirectory::TContext keepCurrent;
+    if (fFile) {
+        if (fFile->ReOpen("UPDATE") < 0)
+            throw std::runtime_error("[HistCache] Cannot reopen cache file for writing: " + fPath);
+        fWritable = true;
+        return fFile.get();
+    }
+    if (!write && gSystem->AccessPathName(fPath.c_str())) return nullptr;   // kTRUE = missing
+
+    fFile.reset(TFile::Open(fPath.c_str(), write ? "UPDATE" : "READ"));
+    if (!fFile || fFile->IsZombie()) {
+        fFile.reset();
+        if (write) throw std::runtime_error("[HistCache] Cannot open cache file: " + fPath);
+        return nullptr;
+    }
+    fWritable = write;
+    return fFile.get();
+}
+
+// ----------------------------------------------------------------------//
+void HistCache::Put(const std::string& key, const TObject& obj)
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    File(true)->WriteTObject(&obj, ("h" + key).c_str(), "Overwrite");
+}
+
+// ----------------------------------------------------------------------//
+void HistCache::Close()
+{
+    std::lock_guard<std::mutex> lock(fMutex);
+    if (!fFile) return;
+    fFile->Close();
+    fFile.reset();
+    fWritable = false;
+}
@@ -0,0 +1,430 @@
+#include "Utils/PlotBook.hxx"
+#include "Utils/HistCache.hxx"
+#include "Utils/Kernels.hxx"
+#include "Utils/Plotter.hxx"
+#include "Utils/SparseHist.hxx"
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TH3D.h>
+#include <THnSparse.h>
+#include <TProfile.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+namespace {
+
+std::vector<std::string> SplitList(const std::string& raw)
+{
+    std::vector<std::string> out;
+    std::stringstream ss{raw};
+    std::string item;
+    while (ss >> item) {
+        if (item.back()==',') item.pop_back();
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+std::string Identifier(std::string s)
+{
+    for (auto& ch : s)
+        if (!std::isalnum(static_cast<unsigned char>(ch))) ch = '_';
+    return s;
+}
+
+PlotBook::Axis ReadAxis(const TEnv& cfg, const std::string& key)
+{
+    PlotBook::Axis a;
+    std::stringstream ss{cfg.GetValue(key.c_str(), "")};
+    if (!(ss >> a.nBins >> a.min >> a.max) || a.nBins <= 0 || !(a.max > a.min))
+        throw std::runtime_error("[PlotBook] " + key + " must be \"nBins xMin xMax\"");
+    return a;
+}
+
+// Wrap a lazy result so it can be fetched as a detached TObject
+template <typename T>
+std::function<std::unique_ptr<TObject>()> Fetcher(ROOT::RDF::RResultPtr<T> r)
+{
+    return [r]() mutable -> std::unique_ptr<TObject> {
+        auto out = std::make_unique<T>(*r);
+        out->SetDirectory(nullptr);
+        return out;
+    };
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------//
+PlotBook PlotBook::FromConfig(const TEnv& cfg, const std::string& section)
+{
+    PlotBook book;
+
+    std::string lower = section;
+    for (auto& ch : lower) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    book.fOutputFile = cfg.GetValue((section + ".PlotFile").c_str(), (lower + "_plots.root").c_str());
+
+    for (const auto& name : SplitList(cfg.GetValue((section + ".Selections").c_str(), ""))) {
+        const std::string cut = cfg.GetValue((section + ".Selection." + name).c_str(), "");
+        book.fSelections.push_back({name, cut});
+    }
+
+    for (const auto& name : SplitList(cfg.GetValue((section + ".Plots").c_str(), ""))) {
+        const std::string key = section + ".Plot." + name;
+        Hist h;
+        h.name    = name;
+        h.exprs.push_back(cfg.GetValue((key + ".Expr").c_str(), name.c_str()));
+        const std::string yExpr = cfg.GetValue((key + ".YExpr").c_str(), "");
+        const std::string zExpr = cfg.GetValue((key + ".ZExpr").c_str(), "");
+        if (!yExpr.empty()) h.exprs.push_back(yExpr);
+        if (!zExpr.empty()) {
+            if (yExpr.empty()) throw std::runtime_error("[PlotBook] " + key + ".ZExpr needs a YExpr");
+            h.exprs.push_back(zExpr);
+        }
+
+        h.xLabel  = cfg.GetValue((key + ".XLabel").c_str(), h.exprs[0].c_str());
+        h.yLabel  = cfg.GetValue((key + ".YLabel").c_str(), h.Dim() > 1 ? yExpr.c_str() : "Count");
+        h.zLabel  = cfg.GetValue((key + ".ZLabel").c_str(), zExpr.c_str());
+        h.reduce  = cfg.GetValue((key + ".Reduce").c_str(), "");
+        h.logy    = cfg.GetValue((key + ".LogY").c_str(), 0) != 0;
+        h.profile = cfg.GetValue((key + ".Profile").c_str(), 0) != 0;
+        h.sparse  = cfg.GetValue((key + ".Sparse").c_str(), 0) != 0;
+
+        if (h.profile && h.Dim() != 2)
+            throw std::runtime_error("[PlotBook] " + key + ".Profile needs an Expr and a YExpr only");
+        if (h.sparse && (h.Dim() < 2 || h.profile))
+            throw std::runtime_error("[PlotBook] " + key + ".Sparse applies to 2D and 3D histograms");
+
+        h.axes.push_back(ReadAxis(cfg, key + ".Bins"));
+        if (h.Dim() > 1 && !h.profile) h.axes.push_back(ReadAxis(cfg, key + ".YBins"));
+        if (h.Dim() > 2)               h.axes.push_back(ReadAxis(cfg, key + ".ZBins"));
+
+        h.mask          = cfg.GetValue((key + ".Mask").c_str(), "");
+        h.leadingBy     = cfg.GetValue((key + ".LeadingBy").c_str(), "");
+        h.elementWeight = cfg.GetValue((key + ".ElementWeight").c_str(), "");
+
+        const bool named = !h.reduce.empty() && Kernels::FindReduction(h.reduce.c_str());
+        if (!h.reduce.empty() && !named && h.reduce != "leading" && h.reduce != "each")
+            throw std::runtime_error("[PlotBook] Unknown reduction for " + key + ": " + h.reduce);
+        if ((h.reduce == "leading") != !h.leadingBy.empty())
+            throw std::runtime_error("[PlotBook] " + key + ": Reduce leading goes with LeadingBy");
+        if (!h.elementWeight.empty() && h.reduce != "each")
+            throw std::runtime_error("[PlotBook] " + key + ".ElementWeight needs Reduce each");
+        if (!h.mask.empty() && h.reduce.empty())
+            throw std::runtime_error("[PlotBook] " + key + ".Mask needs a Reduce");
+        if (h.sparse && h.reduce == "each")
+            throw std::runtime_error("[PlotBook] " + key + ": sparse plots take one value per event");
+
+        h.selections = SplitList(cfg.GetValue((key + ".Selections").c_str(), ""));
+        if (h.selections.empty())
+            for (const auto& s : book.fSelections) h.selections.push_back(s.name);
+
+        const std::size_t idx = book.fHists.size();
+        if (book.fSelections.empty() && h.selections.empty()) {
+            book.fEntries.push_back({idx, -1});
+        }
+        for (const auto& sel : h.selections) {
+            auto it = std::find_if(book.fSelections.begin(), book.fSelections.end(),
+                                   [&](const Selection& s) { return s.name == sel; });
+            if (it == book.fSelections.end())
+                throw std::runtime_error("[PlotBook] " + key + " uses unknown selection: " + sel);
+            book.fEntries.push_back({idx, static_cast<int>(it - book.fSelections.begin())});
+        }
+        book.fHists.push_back(std::move(h));
+    }
+    return book;
+}
+
+// ----------------------------------------------------------------------//
+std::string PlotBook::OutputFile() const
+{
+    const bool multiDim = std::any_of(fHists.begin(), fHists.end(), [](const Hist& h) { return h.Dim() > 1; });
+    return multiDim ? fOutputFile : "";
+}
+
+// ----------------------------------------------------------------------//
+std::string PlotBook::PlotName(const Entry& e) const
+{
+    const std::string& plot = fHists[e.hist].name;
+    return e.selection < 0 ? plot : plot + "_" + fSelections[e.selection].name;
+}
+
+// ----------------------------------------------------------------------//
+std::string PlotBook::HistName(const std::string& prefix, const Entry& e, const std::string& sample) const
+{
+    return prefix + "_hist_" + PlotName(e) + "_" + sample;
+}
+
+// ----------------------------------------------------------------------//
+PlotBook::Booking PlotBook::Book(ROOT::RDF::RNode* node, const std::string& prefix, const std::string& sample,
+                                 const std::string& weightCol, const std::string& context) const
+{
+    const std::size_t n = fEntries.size();
+    Booking b;
+    b.sample = sample;
+    b.fetch.resize(n);
+    b.keys.resize(n);
+    b.objects.resize(n);
+
+    // Entries filled before with the same inputs, selection and weight come from the cache
+    HistCache* cache = Plotter::Cache();
+    std::vector<bool> todo(fHists.size(), false);
+    std::vector<bool> cached(n, false);
+    for (std::size_t k = 0; k < n; ++k) {
+        const auto& e = fEntries[k];
+        const auto& h = fHists[e.hist];
+        const std::string cut = e.selection < 0 ? "" : fSelections[e.selection].cut;
+
+        // The x binning goes through the key arguments, everything else through the variable
+        std::string var = h.exprs[0];
+        for (std::size_t d = 1; d < h.Dim(); ++d) var += " : " + h.exprs[d];
+        if (!h.reduce.empty())        var += " reduce " + h.reduce;
+        if (!h.mask.empty())          var += " mask " + h.mask;
+        if (!h.leadingBy.empty())     var += " by " + h.leadingBy;
+        if (!h.elementWeight.empty()) var += " element weight " + h.elementWeight;
+        if (h.profile)         var += " profile";
+        if (h.sparse)          var += " sparse";
+        for (std::size_t d = 1; d < h.axes.size(); ++d) {
+            std::ostringstream ss;
+            ss.precision(17);
+            ss << " bins " << h.axes[d].nBins << " " << h.axes[d].min << " " << h.axes[d].max;
+            var += ss.str();
+        }
+        b.keys[k] = HistCache::Key(context + "\nselection " + cut, var,
+                                   h.axes[0].nBins, h.axes[0].min, h.axes[0].max);
+        if (cache) {
+            auto obj = h.sparse ? std::unique_ptr<TObject>(cache->Get<THnSparseD>(b.keys[k]))
+                                : std::unique_ptr<TObject>(cache->Get<TH1>(b.keys[k]));
+            if (obj) {
+                b.objects[k] = std::move(obj);
+                cached[k] = true;
+                continue;
+            }
+        }
+        todo[e.hist] = true;
+    }
+    if (std::none_of(todo.begin(), todo.end(), [](bool t) { return t; })) return b;
+    if (!node)
+        throw std::runtime_error("[PlotBook] Histograms of " + sample
+                                 + " are not in the histogram cache; run once without --render-only");
+
+    // One column per plot axis, defined before the selections branch off
+    ROOT::RDF::RNode base = *node;
+    const auto columns = base.GetColumnNames();
+    auto columnFor = [&](const std::string& expr, const std::string& name) {
+        if (std::find(columns.begin(), columns.end(), expr) != columns.end()) return expr;
+        const std::string col = Identifier(name);
+        base = base.Define(col, expr);
+        return col;
+    };
+
+    static const char* const kAxisTag[] = {"", "_y", "_z"};
+    std::vector<std::vector<std::string>> cols(fHists.size());
+    std::vector<std::string> histWeight(fHists.size(), weightCol);
+    for (std::size_t i = 0; i < fHists.size(); ++i) {
+        if (!todo[i]) continue;
+        const auto& h = fHists[i];
+        const std::string stem = prefix + "_plot_" + h.name;
+        const std::string mask = h.mask.empty() ? "" : columnFor(h.mask, stem + "_mask");
+        const std::string score = h.leadingBy.empty() ? "" : columnFor(h.leadingBy, stem + "_score");
+
+        for (std::size_t d = 0; d < h.Dim(); ++d) {
+            std::string col = columnFor(h.exprs[d], stem + kAxisTag[d]);
+            const std::string reduced = Identifier(stem + kAxisTag[d] + "_" + h.reduce);
+            if (h.reduce == "each") {
+                // Every element is filled; a mask drops elements first
+                if (!mask.empty()) {
+                    base = base.Define(reduced, Kernels::Masked, {col, mask});
+                    col = reduced;
+                }
+            }
+            else if (h.reduce == "leading") {
+                if (mask.empty())
+                    base = base.Define(reduced, [](const Kernels::RVecF& v, const Kernels::RVecF& s) {
+                        return Kernels::LeadingBy(v, s);
+                    }, {col, score});
+                else
+                    base = base.Define(reduced, [](const Kernels::RVecF& v, const Kernels::RVecF& s,
+                                                   const Kernels::RVecI& m) {
+                        return Kernels::LeadingBy(v, s, &m);
+                    }, {col, score, mask});
+                col = reduced;
+            }
+            else if (!h.reduce.empty()) {
+                // Named reduction; "first" gives -9999 if empty (as CreateTH1DFromRNode)
+                const Kernels::Reduction fn = Kernels::FindReduction(h.reduce.c_str());
+                if (mask.empty())
+                    base = base.Define(reduced, [fn](const Kernels::RVecF& v) { return fn(v, nullptr); }, {col});
+                else
+                    base = base.Define(reduced, [fn](const Kernels::RVecF& v, const Kernels::RVecI& m) {
+                        return fn(v, &m);
+                    }, {col, mask});
+                col = reduced;
+            }
+            if (h.sparse) {
+                // The sparse action is compiled for double coordinates
+                const std::string asDouble = Identifier(stem + kAxisTag[d] + "_d");
+                base = base.Define(asDouble, "static_cast<double>(" + col + ")");
+                col = asDouble;
+            }
+            cols[i].push_back(col);
+        }
+
+        // Filling every element: one weight per element, times the event weight
+        if (h.reduce == "each" && (!h.elementWeight.empty() || !weightCol.empty())) {
+            std::string ew = h.elementWeight.empty() ? "" : columnFor(h.elementWeight, stem + "_element_weight");
+            if (!ew.empty() && !mask.empty()) {
+                const std::string masked = Identifier(stem + "_element_weight_masked");
+                base = base.Define(masked, Kernels::Masked, {ew, mask});
+                ew = masked;
+            }
+            const std::string w = Identifier(stem + "_each_weight");
+            if (ew.empty())
+                base = base.Define(w, [](const Kernels::RVecF& v, double evtW) {
+                    return Kernels::ElementWeights(v, nullptr, evtW);
+                }, {cols[i][0], weightCol});
+            else if (weightCol.empty())
+                base = base.Define(w, [](const Kernels::RVecF& v, const Kernels::RVecF& elemW) {
+                    return Kernels::ElementWeights(v, &elemW, 1.0);
+                }, {cols[i][0], ew});
+            else
+                base = base.Define(w, [](const Kernels::RVecF& v, const Kernels::RVecF& elemW, double evtW) {
+                    return Kernels::ElementWeights(v, &elemW, evtW);
+                }, {cols[i][0], ew, weightCol});
+            histWeight[i] = w;
+        }
+    }
+
+    // One filter node per selection, shared by all its plots
+    std::vector<ROOT::RDF::RNode> selNodes;
+    for (const auto& s : fSelections)
+        selNodes.push_back(s.cut.empty() ? base : base.Filter(s.cut, s.name));
+
+    for (std::size_t k = 0; k < n; ++k) {
+        if (cached[k]) continue;
+        const auto& e = fEntries[k];
+        const auto& h = fHists[e.hist];
+        ROOT::RDF::RNode sel = e.selection < 0 ? base : selNodes[e.selection];
+        const std::string name = HistName(prefix, e, sample);
+        const std::string titles = ";" + h.xLabel + ";" + h.yLabel + (h.Dim() > 2 ? ";" + h.zLabel : "");
+        const std::string& w = histWeight[e.hist];
+        std::vector<std::string> c = cols[e.hist];
+        if (!w.empty()) c.push_back(w);
+        const auto& ax = h.axes;
+
+        if (h.sparse) {
+            std::vector<SparseAxis> sa;
+            for (const auto& a : ax) sa.push_back({a.nBins, a.min, a.max});
+            auto r = BookSparse(sel, name, titles, sa, c);
+            b.handles.emplace_back(r);
+            b.fetch[k] = [r]() mutable -> std::unique_ptr<TObject> { return r->ToTHnSparse(); };
+        }
+        else if (h.profile) {
+            ROOT::RDF::TProfile1DModel model(name.c_str(), titles.c_str(), ax[0].nBins, ax[0].min, ax[0].max);
+            auto r = w.empty() ? sel.Profile1D(model, c[0], c[1]) : sel.Profile1D(model, c[0], c[1], c[2]);
+            b.handles.emplace_back(r);
+            b.fetch[k] = Fetcher(r);
+        }
+        else if (h.Dim() == 3) {
+            ROOT::RDF::TH3DModel model(name.c_str(), titles.c_str(), ax[0].nBins, ax[0].min, ax[0].max,
+                                       ax[1].nBins, ax[1].min, ax[1].max, ax[2].nBins, ax[2].min, ax[2].max);
+            auto r = w.empty() ? sel.Histo3D(model, c[0], c[1], c[2])
+                                       : sel.Histo3D(model, c[0], c[1], c[2], c[3]);
+            b.handles.emplace_back(r);
+            b.fetch[k] = Fetcher(r);
+        }
+        else if (h.Dim() == 2) {
+            ROOT::RDF::TH2DModel model(name.c_str(), titles.c_str(), ax[0].nBins, ax[0].min, ax[0].max,
+                                       ax[1].nBins, ax[1].min, ax[1].max);
+            auto r = w.empty() ? sel.Histo2D(model, c[0], c[1]) : sel.Histo2D(model, c[0], c[1], c[2]);
+            b.handles.emplace_back(r);
+            b.fetch[k] = Fetcher(r);
+        }
+        else {
+            ROOT::RDF::TH1DModel model(name.c_str(), titles.c_str(), ax[0].nBins, ax[0].min, ax[0].max);
+            auto r = w.empty() ? sel.Histo1D(model, c[0]) : sel.Histo1D(model, c[0], c[1]);
+            b.handles.emplace_back(r);
+            b.fetch[k] = Fetcher(r);
+        }
+    }
+    return b;
+}
+
+// ----------------------------------------------------------------------//
+std::vector<ROOT::RDF::RResultHandle> PlotBook::Handles(const Booking& b)
+{
+    return b.handles;
+}
+
+// ----------------------------------------------------------------------//
+void PlotBook::Collect(Booking& b, const std::string& prefix) const
+{
+    HistCache* cache = Plotter::Cache();
+    for (std::size_t k = 0; k < fEntries.size(); ++k) {
+        if (b.fetch[k]) {
+            b.objects[k] = b.fetch[k]();
+            if (cache) cache->Put(b.keys[k], *b.objects[k]);
+            b.fetch[k] = nullptr;
+        }
+        // Names and titles always follow the current config
+        const auto& e = fEntries[k];
+        const auto& h = fHists[e.hist];
+        const std::string name = HistName(prefix, e, b.sample);
+        if (auto* hist = dynamic_cast<TH1*>(b.objects[k].get())) {
+            hist->SetDirectory(nullptr);
+            hist->SetName(name.c_str());
+            hist->GetXaxis()->SetTitle(h.xLabel.c_str());
+            hist->GetYaxis()->SetTitle(h.yLabel.c_str());
+            hist->GetZaxis()->SetTitle(h.zLabel.c_str());
+        }
+        else if (auto* sparse = dynamic_cast<THnSparse*>(b.objects[k].get())) {
+            sparse->SetName(name.c_str());
+            const std::string* labels[] = {&h.xLabel, &h.yLabel, &h.zLabel};
+            for (int d = 0; d < sparse->GetNdimensions() && d < 3; ++d)
+                sparse->GetAxis(d)->SetTitle(labels[d]->c_str());
+        }
+    }
+    b.handles.clear();
+}
+
+// ----------------------------------------------------------------------//
+void PlotBook::Draw(std::vector<Booking>& samples, const std::vector<std::string>& labels,
+                    const std::string& prefix, const std::string& ndFile) const
+{
+    bool multiDim = false;
+    for (std::size_t k = 0; k < fEntries.size(); ++k) {
+        const auto& h = fHists[fEntries[k].hist];
+        if (h.Dim() > 1) {
+            multiDim = true;
+            // 2D and profiles per sample; 3D and sparse binnings only go to the file.
+            // A histogram sink (sharded run) only takes 1D plots.
+            if (h.sparse || h.Dim() > 2 || Plotter::HistogramSinkActive()) continue;
+            for (auto& s : samples)
+                Plotter::SaveHist(static_cast<TH1*>(s.objects[k].get()), HistName(prefix, fEntries[k], s.sample));
+            continue;
+        }
+        std::vector<TH1D> hists;
+        hists.reserve(samples.size());
+        for (const auto& s : samples) hists.push_back(*static_cast<TH1D*>(s.objects[k].get()));
+        Plotter::FullDataMCSignalPlot(hists, labels, prefix + "_full_hist_" + PlotName(fEntries[k]), h.logy);
+    }
+    if (!multiDim || ndFile.empty()) return;
+
+    std::unique_ptr<TFile> out{TFile::Open(ndFile.c_str(), "RECREATE")};
+    if (!out || out->IsZombie())
+        throw std::runtime_error("[PlotBook] Cannot create file: " + ndFile);
+    out->cd();
+    for (std::size_t k = 0; k < fEntries.size(); ++k) {
+        if (fHists[fEntries[k].hist].Dim() < 2) continue;
+        for (const auto& s : samples) s.objects[k]->Write();
+    }
+    out->Close();
+    std::cout << "[PlotBook] Wrote multi-dimensional plots to " << ndFile << '\n';
+}
@@ -1,7 +1,11 @@
 #include "Utils/Plotter.hxx"
+#include "Utils/Kernels.hxx"
+#include "Utils/HistCache.hxx"
 
 #include <TH1.h>
 #include <TH1D.h>
+#include <TH2D.h>
+#include <TProfile.h>
 #include <THStack.h>
 #include <TGraph.h>
 #include <TCanvas.h>
@@ -11,10 +15,273 @@
 #include <TSystem.h>
 #include <iostream>
 #include <TLine.h>
+#include <TLatex.h>
 #include <ROOT/RDataFrame.hxx>
+#include <TDirectory.h>
+#include <TKey.h>
+#include <TROOT.h>
+#include <algorithm>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <utility>
+#include <sstream>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace Analysis;
 
+// ROOT graphics (gStyle, gPad, TCanvas) is not thread-safe, so drawing is
+// serialised when modules run concurrently under the DAG scheduler.
+static std::mutex gDrawMutex;
+static std::mutex gQueueMutex;   ///< guards Plotter::fQueue
+
+namespace {
+
+// Owns every drawing object of one plot (stack, legend, lines, clones).
+// Declared before the canvas, so the canvas goes first and everything it
+// displayed is freed right after SaveAs: memory stays flat however many
+// plots a job draws. Histograms are detached from gDirectory on adoption.
+class PlotScope {
+public:
+    PlotScope() = default;
+    PlotScope(const PlotScope&) = delete;
+    PlotScope& operator=(const PlotScope&) = delete;
+    ~PlotScope() { while (!fObjects.empty()) fObjects.pop_back(); }   // reverse order of creation
+
+    template <typename T, typename... Args>
+    T* Make(Args&&... args)
+    {
+        return Adopt<T>(new T(std::forward<Args>(args)...));
+    }
+
+    template <typename T>
+    T* Adopt(TObject* obj)
+    {
+        if (auto* h = dynamic_cast<TH1*>(obj)) h->SetDirectory(nullptr);
+        fObjects.emplace_back(obj);
+        return static_cast<T*>(obj);
+    }
+
+private:
+    std::vector<std::unique_ptr<TObject>> fObjects;
+};
+
+} // namespace
+
+std::string Plotter::fHistSink;
+bool        Plotter::fSinkCreated = false;
+std::unique_ptr<HistCache> Plotter::fHistCache;
+bool        Plotter::fRenderOnly  = false;
+std::vector<std::string> Plotter::fFormats{"png", "pdf"};
+int         Plotter::fRenderWorkers = 0;
+std::vector<Plotter::PlotSpec> Plotter::fQueue;
+std::string Plotter::fAnnotation;
+
+// ----------------------------------------------------------------------//
+void Plotter::SetHistCache(const std::string& path)
+{
+    if (path.empty()) fHistCache.reset();
+    else              fHistCache = std::make_unique<HistCache>(path);
+}
+
+// ----------------------------------------------------------------------//
+void Plotter::SetOutputFormats(const std::vector<std::string>& formats)
+{
+    if (formats.empty()) throw std::runtime_error("[Plotter] No output formats given");
+    fFormats = formats;
+}
+
+// ----------------------------------------------------------------------//
+void Plotter::SaveCanvas(TCanvas& c, const std::string& basename)
+{
+    if (!fAnnotation.empty()) {
+        c.cd();
+        TLatex note;
+        note.SetNDC();
+        note.SetTextSize(0.03);
+        note.SetTextColor(kRed + 1);
+        note.DrawLatex(0.13, 0.935, fAnnotation.c_str());
+    }
+    for (const auto& fmt : fFormats)
+        c.SaveAs((basename + "." + fmt).c_str());
+}
+
+// ----------------------------------------------------------------------//
+void Plotter::Enqueue(PlotSpec spec)
+{
+    std::lock_guard<std::mutex> lock(gQueueMutex);
+    fQueue.push_back(std::move(spec));
+}
+
+// ----------------------------------------------------------------------//
+void Plotter::Render(PlotSpec& spec)
+{
+    switch (spec.kind) {
+    case PlotSpec::Kind::Single:
+        SaveHist(spec.single.get(), spec.basename, spec.style);
+        break;
+    case PlotSpec::Kind::Stacked:
+        StackedHist(spec.hists, spec.labels, spec.basename, spec.logy, spec.weights);
+        break;
+    case PlotSpec::Kind::FullDataMC:
+        FullDataMCSignalPlot(spec.hists, spec.labels, spec.basename, spec.logy, spec.weights, spec.cov.get());
+        break;
+    }
+}
+
+// ----------------------------------------------------------------------//
+void Plotter::FlushRenderQueue()
+{
+    std::vector<PlotSpec> queue;
+    {
+        std::lock_guard<std::mutex> lock(gQueueMutex);
+        queue.swap(fQueue);
+    }
+    if (queue.empty()) return;
+
+    // The plot helpers draw directly while the queue is being rendered
+    const int workers = std::min<int>(fRenderWorkers, static_cast<int>(queue.size()));
+    const int savedWorkers = fRenderWorkers;
+    fRenderWorkers = 0;
+
+    if (workers <= 1) {
+        for (auto& spec : queue) Render(spec);
+        fRenderWorkers = savedWorkers;
+        return;
+    }
+
+    // ROOT graphics is not thread-safe, so render in forked processes, each
+    // drawing every workers-th plot in batch mode. Called between modules,
+    // when no event loop is running. Flush first so buffered output is not
+    // duplicated into the children.
+    std::cout << "[Plotter] Rendering " << queue.size() << " plots in " << workers << " processes\n";
+    std::cout.flush();
+    std::fflush(nullptr);
+    gROOT->SetBatch(kTRUE);
+
+    std::vector<pid_t> pids;
+    for (int w = 0; w < workers; ++w) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            int status = 0;
+            try {
+                for (std::size_t i = w; i < queue.size(); i += workers) Render(queue[i]);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "[Plotter] Render worker " << w << ": " << e.what() << "\n";
+                status = 1;
+            }
+            std::cout.flush();
+            std::fflush(nullptr);
+            _exit(status);
+        }
+        if (pid < 0) {
+            // Could not fork: draw this worker's share here instead
+            std::cerr << "[Plotter] fork failed, rendering worker " << w << "'s plots in-process\n";
+            for (std::size_t i = w; i < queue.size(); i += workers) Render(queue[i]);
+            continue;
+        }
+        pids.push_back(pid);
+    }
+
+    int failed = 0;
+    for (const pid_t pid : pids) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failed;
+    }
+    fRenderWorkers = savedWorkers;
+    if (failed)
+        throw std::runtime_error("[Plotter] " + std::to_string(failed) + " render worker(s) failed");
+}
+
+// ----------------------------------------------------------------------//
+void Plotter::SetHistogramSink(const std::string& path)
+{
+    fHistSink    = path;
+    fSinkCreated = false;
+}
+
+// ----------------------------------------------------------------------//
+void Plotter::WriteToSink(std::vector<TH1D>& hists,
+                          const std::vector<std::string>& labels,
+                          const std::string& basename,
+                          const std::string& drawSpec,
+                          const std::vector<double>& weights)
+{
+    std::lock_guard<std::mutex> lock(gDrawMutex);
+    std::unique_ptr<TFile> f{TFile::Open(fHistSink.c_str(), fSinkCreated ? "UPDATE" : "RECREATE")};
+    if (!f || f->IsZombie())
+        throw std::runtime_error("[Plotter] Cannot open histogram sink: " + fHistSink);
+    fSinkCreated = true;
+
+    TDirectory* dir = f->GetDirectory(basename.c_str());
+    if (!dir) dir = f->mkdir(basename.c_str(), drawSpec.c_str());
+    dir->cd();
+
+    // Scale here so summing shards and drawing with unit weights is equivalent
+    for (size_t i = 0; i < hists.size(); ++i) {
+        TH1D h(hists[i]);
+        h.Sumw2();
+        if (i < weights.size() && weights[i] != 1.0) h.Scale(weights[i]);
+        const std::string key = std::to_string(i) + "_" + labels[i];
+        h.SetName(key.c_str());
+        h.Write(key.c_str(), TObject::kOverwrite);
+    }
+    f->Close();
+}
+
+// ----------------------------------------------------------------------//
+void Plotter::RenderFromFile(const std::string& path)
+{
+    std::unique_ptr<TFile> f{TFile::Open(path.c_str(), "READ")};
+    if (!f || f->IsZombie())
+        throw std::runtime_error("[Plotter] Cannot open histogram file: " + path);
+
+    // Rendering must never write back into a sink
+    const std::string savedSink = fHistSink;
+    fHistSink.clear();
+
+    for (auto* dirKey : *f->GetListOfKeys()) {
+        auto* dir = f->Get<TDirectory>(dirKey->GetName());
+        if (!dir) continue;
+
+        // Keys are "<index>_<label>"; order by index, not by key order in the file
+        std::vector<std::pair<int, std::string>> order;
+        for (auto* k : *dir->GetListOfKeys()) {
+            const std::string name = k->GetName();
+            const auto us = name.find('_');
+            if (us == std::string::npos) continue;
+            order.emplace_back(std::stoi(name.substr(0, us)), name);
+        }
+        std::sort(order.begin(), order.end());
+
+        std::vector<TH1D> hists;
+        std::vector<std::string> labels;
+        for (const auto& [idx, name] : order) {
+            auto* h = dir->Get<TH1D>(name.c_str());
+            if (!h) continue;
+            hists.push_back(*h);
+            hists.back().SetDirectory(nullptr);
+            labels.push_back(name.substr(name.find('_') + 1));
+        }
+        if (hists.empty()) continue;
+
+        std::istringstream spec(dir->GetTitle());
+        std::string kind, opt;
+        spec >> kind >> opt;
+        const std::string basename = dir->GetName();
+        std::cout << "[Plotter] Rendering " << basename << " (" << kind << ")\n";
+        if (kind == "SaveHist")            SaveHist(&hists[0], basename, opt.empty() ? "default" : opt);
+        else if (kind == "StackedHist")    StackedHist(hists, labels, basename, opt == "logy");
+        else                               FullDataMCSignalPlot(hists, labels, basename, opt == "logy");
+    }
+    fHistSink = savedSink;
+}
+
 // ----------------------------------------------------------------------//
 std::unique_ptr<TCanvas> Plotter::MakeCanvas(const std::string& title)
 {
@@ -45,6 +312,33 @@ void Plotter::ApplyStyle(const std::string& style)
     }
 }
 
+std::string Plotter::WeightColumn(ROOT::RDF::RNode& node,
+                                  const std::string& name,
+                                  const std::string& weight,
+                                  double scale)
+{
+    if (weight.empty() && scale == 1.0) return "";
+
+    const auto columns = node.GetColumnNames();
+    if (scale == 1.0 && std::find(columns.begin(), columns.end(), weight) != columns.end()
+        && node.GetColumnType(weight) == "double")
+        return weight;
+
+    // Column names must be valid identifiers for the JIT-ed expression
+    std::string col = name + "_weight";
+    for (auto& ch : col)
+        if (!std::isalnum(static_cast<unsigned char>(ch))) ch = '_';
+
+    // One product per event; the sample scale is folded in as a literal
+    std::ostringstream expr;
+    expr << std::setprecision(17);
+    if (weight.empty()) expr << scale;
+    else                expr << "(" << weight << ") * " << scale;
+    node = node.Define(col, expr.str());
+    return col;
+}
+
+// ----------------------------------------------------------------------//
 TH1D Plotter::CreateTH1DFromRNode(
     ROOT::RDF::RNode node,
     const std::string& name,
@@ -54,43 +348,111 @@ TH1D Plotter::CreateTH1DFromRNode(
     int nBins,
     double xMin,
     double xMax,
-    bool removeVectorDuplicates)
+    bool removeVectorDuplicates,
+    const std::string& weight,
+    double scale)
 {
     std::string axisString = std::string(";") + xLabel + ";" + yLabel;
     ROOT::RDF::TH1DModel model(name.c_str(), axisString.c_str(), nBins, xMin, xMax);
 
+    // Weighted fills keep the sum of squared weights, so the errors are
+    // right without rescaling afterwards
+    const std::string weightCol = WeightColumn(node, name, weight, scale);
+    auto fill = [&](ROOT::RDF::RNode n, const std::string& col) {
+        return weightCol.empty() ? n.Histo1D(model, col).GetValue()
+                                 : n.Histo1D(model, col, weightCol).GetValue();
+    };
+
     // If the variable is a vector, can remove duplicates by taking only the first element
     if (removeVectorDuplicates) {
         // Define a new column that extracts the first element of the vector,
         // if vector is empty, return default value -9999.0
         auto firstElementCol = node.Define((varName + "_first").c_str(),
-            [](const ROOT::VecOps::RVec<float>& vec) {
-                return vec.empty() ? -9999.0f : vec[0];
-            }, {varName.c_str()});
-        TH1D hist = firstElementCol.Histo1D(model, (varName + "_first").c_str()).GetValue();
+            [](const Kernels::RVecF& vec) { return Kernels::FirstOrDefault(vec); },
+            {varName.c_str()});
+        TH1D hist = fill(firstElementCol, varName + "_first");
         hist.SetDirectory(nullptr);   // decouple from any current file
         hist.SetName(name.c_str());
         return hist;
     }
 
-    TH1D hist = node.Histo1D(model, varName).GetValue();
+    TH1D hist = fill(node, varName);
     hist.SetDirectory(nullptr);   // decouple from any current file
     hist.SetName(name.c_str());
     return hist;
 }
 
+// ----------------------------------------------------------------------//
+TH1D Plotter::CachedTH1D(
+    const std::string& context,
+    ROOT::RDF::RNode* node,
+    const std::string& name,
+    const std::string& varName,
+    const std::string& xLabel,
+    const std::string& yLabel,
+    int nBins,
+    double xMin,
+    double xMax,
+    bool removeVectorDuplicates,
+    const std::string& weight,
+    double scale)
+{
+    if (!fHistCache) {
+        if (!node) throw std::runtime_error("[Plotter] No data frame and no histogram cache for " + name);
+        return CreateTH1DFromRNode(*node, name, varName, xLabel, yLabel, nBins, xMin, xMax,
+                                   removeVectorDuplicates, weight, scale);
+    }
+
+    const std::string key = HistCache::Key(context, varName, nBins, xMin, xMax, removeVectorDuplicates);
+    if (auto cached = fHistCache->Get<TH1D>(key)) {
+        TH1D hist(*cached);
+        hist.SetDirectory(nullptr);
+        hist.SetName(name.c_str());
+        hist.GetXaxis()->SetTitle(xLabel.c_str());
+        hist.GetYaxis()->SetTitle(yLabel.c_str());
+        return hist;
+    }
+    if (!node)
+        throw std::runtime_error("[Plotter] " + name + " is not in the histogram cache "
+                                 + fHistCache->Path() + "; run once without --render-only");
+
+    TH1D hist = CreateTH1DFromRNode(*node, name, varName, xLabel, yLabel, nBins, xMin, xMax,
+                                    removeVectorDuplicates, weight, scale);
+    fHistCache->Put(key, hist);
+    return hist;
+}
+
 // ----------------------------------------------------------------------//
 void Plotter::SaveHist(TH1* h,
                        const std::string& basename,
                        const std::string& style)
 {
     if (!h) return;
+    if (!fHistSink.empty()) {
+        auto* h1d = dynamic_cast<TH1D*>(h);
+        if (!h1d) throw std::runtime_error("[Plotter] Histogram sink only supports TH1D: " + basename);
+        std::vector<TH1D> one{*h1d};
+        WriteToSink(one, {"hist"}, basename, "SaveHist " + style, {});
+        return;
+    }
+    if (fRenderWorkers > 0) {
+        PlotSpec spec;
+        spec.kind = PlotSpec::Kind::Single;
+        spec.single.reset(static_cast<TH1*>(h->Clone()));
+        spec.single->SetDirectory(nullptr);
+        spec.basename = basename;
+        spec.style = style;
+        Enqueue(std::move(spec));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(gDrawMutex);
     ApplyStyle(style);
 
     auto c = MakeCanvas(basename);
-    h->Draw("HIST");
-    c->SaveAs((basename + ".png").c_str());
-    c->SaveAs((basename + ".pdf").c_str());
+    if (h->InheritsFrom(TProfile::Class()))  h->Draw("E");
+    else if (h->GetDimension() == 2)         { c->SetRightMargin(0.14); h->Draw("COLZ"); }
+    else                                     h->Draw("HIST");
+    SaveCanvas(*c, basename);
 }
 
 // ----------------------------------------------------------------------//
@@ -107,13 +469,30 @@ void Plotter::StackedHist(std::vector<TH1D>& hists,
     static const Int_t colors[] = {TColor::GetColor("#e69f00"),TColor::GetColor("#5664e9"),TColor::GetColor("#009e73"), kOrange, kViolet, kCyan, kMagenta, kYellow};
     
     if (hists.empty() || hists.size() != labels.size()) return;
+    if (!fHistSink.empty()) {
+        WriteToSink(hists, labels, basename, logy ? "StackedHist logy" : "StackedHist", weights);
+        return;
+    }
+    if (fRenderWorkers > 0) {
+        PlotSpec spec;
+        spec.kind = PlotSpec::Kind::Stacked;
+        spec.hists = hists;
+        spec.labels = labels;
+        spec.basename = basename;
+        spec.logy = logy;
+        spec.weights = weights;
+        Enqueue(std::move(spec));
+        return;
+    }
 
+    std::lock_guard<std::mutex> lock(gDrawMutex);
+    PlotScope scope;   // must outlive the canvas
     ApplyStyle("mdh_nice");
     auto c = MakeCanvas(basename);
     if (logy) c->SetLogy();
 
     std::string stackTitle = "Stacked Histogram: " + basename;
-    THStack *hs = new THStack("hs", stackTitle.c_str());
+    THStack *hs = scope.Make<THStack>((basename + "_stack").c_str(), stackTitle.c_str());
 
     std::cout << "[Plotter] Adding " << hists.size() << " histograms to stack:\n";
 
@@ -161,14 +540,13 @@ void Plotter::StackedHist(std::vector<TH1D>& hists,
     hs->GetXaxis()->SetTitle(hists[0].GetXaxis()->GetTitle());
     hs->GetYaxis()->SetTitle(hists[0].GetYaxis()->GetTitle());
     // Legend
-    auto leg = new TLegend(0.7, 0.7, 0.88, 0.88);
+    auto leg = scope.Make<TLegend>(0.7, 0.7, 0.88, 0.88);
     for (size_t i = 0; i < hists.size(); ++i)
         leg->AddEntry(&hists[i], labels[i].c_str(), "l");   // pass pointer
 
     leg->Draw();
 
-    c->SaveAs((basename + ".png").c_str());
-    c->SaveAs((basename + ".pdf").c_str());
+    SaveCanvas(*c, basename);
 }
 
 // ----------------------------------------------------------------------//
@@ -177,7 +555,8 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
                       const std::vector<std::string>& labels,
                       const std::string& basename,
                       bool logy,
-                      const std::vector<double> weights)
+                      const std::vector<double> weights,
+                      const TH2D* bkgCovariance)
 {
     // I am using TH1D objects rather than pointers because the pointers returned by RDataFrame are
     // smart pointers, which I think are deallocated before we can use them here. Had a bunch of seg faults...
@@ -185,17 +564,41 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
     std::cout << "[Plotter] Creating full stacked histogram: " << basename << std::endl;
     static const Int_t colors[] = {TColor::GetColor("#e69f00"),TColor::GetColor("#5664e9"),TColor::GetColor("#009e73"), kOrange, kViolet, kCyan, kMagenta, kYellow};
     
-    std::cout << "Number of entries in " << labels[0] << ": " << hists.back().GetEntries() << std::endl;
     std::cout << "Hists size: " << hists.size() << ", Labels size: " << labels.size() << std::endl;
     if (hists.empty() || hists.size() != labels.size()) return;
+    std::cout << "Number of entries in " << labels[0] << ": " << hists.back().GetEntries() << std::endl;
     std::cout << "Number of histograms: " << hists.size() << std::endl;
+    if (!fHistSink.empty()) {
+        // Covariances do not add across shards; the band is stat.-only after the merge
+        if (bkgCovariance)
+            std::cerr << "[Plotter] Systematic covariance is not stored in the histogram sink: " << basename << "\n";
+        WriteToSink(hists, labels, basename, logy ? "FullDataMCSignalPlot logy" : "FullDataMCSignalPlot", weights);
+        return;
+    }
+    if (fRenderWorkers > 0) {
+        PlotSpec spec;
+        spec.kind = PlotSpec::Kind::FullDataMC;
+        spec.hists = hists;
+        spec.labels = labels;
+        spec.basename = basename;
+        spec.logy = logy;
+        spec.weights = weights;
+        if (bkgCovariance) {
+            spec.cov.reset(static_cast<TH2D*>(bkgCovariance->Clone()));
+            spec.cov->SetDirectory(nullptr);
+        }
+        Enqueue(std::move(spec));
+        return;
+    }
 
+    std::lock_guard<std::mutex> lock(gDrawMutex);
+    PlotScope scope;   // must outlive the canvas
     ApplyStyle("prelim");
     auto c = MakeCanvas(basename);
     if (logy) c->SetLogy();
 
     std::string stackTitle = "Stacked Histogram: " + basename;
-    THStack *hs = new THStack("hs", stackTitle.c_str());
+    THStack *hs = scope.Make<THStack>((basename + "_stack").c_str(), stackTitle.c_str());
 
     std::cout << "[Plotter] Adding " << hists.size() << " histograms to stack:\n";
 
@@ -203,15 +606,36 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
     std::vector<TH1D*> dataHists;
     std::vector<TH1D*> bkgHists;
 
-    //TCanvas *stackCanvas = new TCanvas("stackCanvas","MC Stack with Signal and Data",800,800);
-    c->Divide(1,2);
+    // Samples without data or without background (e.g. signal-only grid
+    // configs) get no ratio panel
+    auto isKind = [&labels](std::size_t i, const char* kind) {
+        std::string l = labels[i];
+        std::transform(l.begin(), l.end(), l.begin(), ::tolower);
+        return l.find(kind) != std::string::npos;
+    };
+    bool anyData = false, anyBkg = false;
+    for (size_t i = 0; i < hists.size(); ++i) {
+        const bool isSignal = isKind(i, "signal"), isData = isKind(i, "data");
+        anyData = anyData || (isData && !isSignal);
+        anyBkg  = anyBkg  || (!isData && !isSignal);
+    }
+    const bool ratioPanel = anyData && anyBkg;
 
-    // Top pad: main plot                                                             
-    c->cd(1);
-    gPad->UseCurrentStyle();
-    gPad->SetPad(0.0, 0.3, 1.0, 1.0);
-    gPad->SetBottomMargin(0.1);
-    gPad->SetLeftMargin(0.15);
+    //TCanvas *stackCanvas = new TCanvas("stackCanvas","MC Stack with Signal and Data",800,800);
+    if (ratioPanel) {
+        c->Divide(1,2);
+
+        // Top pad: main plot
+        c->cd(1);
+        gPad->UseCurrentStyle();
+        gPad->SetPad(0.0, 0.3, 1.0, 1.0);
+        gPad->SetBottomMargin(0.1);
+        gPad->SetLeftMargin(0.15);
+    }
+    else {
+        c->cd();
+        gPad->SetLeftMargin(0.15);
+    }
 
     for (size_t i = 0; i < hists.size(); ++i) {
         auto& hist = hists[i];
@@ -288,18 +712,34 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
     }
 
 
-    // Draw the stacked backgrounds first
-    hs->Draw("HIST");
+    // Draw the stacked backgrounds first; without any, an empty frame carries the axes
+    TH1D* frame = nullptr;
+    if (bkgHists.empty()) {
+        frame = scope.Adopt<TH1D>(hists[0].Clone((basename + "_frame").c_str()));
+        frame->Reset();
+        frame->SetTitle(stackTitle.c_str());
+    }
+    else {
+        hs->Draw("HIST");
+    }
 
     // Build total background histogram and its statistical uncertainty band
     TH1D* hBkgTotal = nullptr;
     if (!bkgHists.empty()) {
-        hBkgTotal = (TH1D*)bkgHists[0]->Clone((std::string(basename) + "_bkg_total").c_str());
-        hBkgTotal->SetDirectory(nullptr);
+        hBkgTotal = scope.Adopt<TH1D>(bkgHists[0]->Clone((basename + "_bkg_total").c_str()));
         hBkgTotal->Sumw2();
         for (size_t ib = 1; ib < bkgHists.size(); ++ib) {
             hBkgTotal->Add(bkgHists[ib]);
         }
+        if (bkgCovariance) {
+            if (bkgCovariance->GetNbinsX() != hBkgTotal->GetNbinsX())
+                throw std::runtime_error("[Plotter] Covariance binning does not match " + basename);
+            for (int b = 1; b <= hBkgTotal->GetNbinsX(); ++b) {
+                const double stat = hBkgTotal->GetBinError(b);
+                const double syst = std::max(0.0, bkgCovariance->GetBinContent(b, b));
+                hBkgTotal->SetBinError(b, std::sqrt(stat * stat + syst));
+            }
+        }
     }
 
     double yMax = hs->GetMaximum();
@@ -314,11 +754,14 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
         yMax = std::max(yMax, yBandMax);
     }
     hs->SetMaximum(1.2 * yMax);
+    if (frame) {
+        frame->SetMaximum(1.2 * yMax);
+        frame->Draw("AXIS");
+    }
 
     // Draw statistical uncertainty band for the total background
     if (hBkgTotal) {
-        TH1D* hBkgBand = (TH1D*)hBkgTotal->Clone((std::string(basename) + "_bkg_band").c_str());
-        hBkgBand->SetDirectory(nullptr);
+        TH1D* hBkgBand = scope.Adopt<TH1D>(hBkgTotal->Clone((basename + "_bkg_band").c_str()));
         hBkgBand->SetFillColorAlpha(kGray+1, 0.5);
         //hBkgBand->SetFillStyle(3001); // hatched/transparent style
         hBkgBand->SetLineColor(kGray+2);
@@ -332,10 +775,12 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
     for (auto* dh : dataHists)   dh->Draw("E SAME");
 
     // Axis titles come from the first histogram
-    hs->GetXaxis()->SetTitle(hists[0].GetXaxis()->GetTitle());
-    hs->GetYaxis()->SetTitle(hists[0].GetYaxis()->GetTitle());
+    TAxis* xAxis = frame ? frame->GetXaxis() : hs->GetXaxis();
+    TAxis* yAxis = frame ? frame->GetYaxis() : hs->GetYaxis();
+    xAxis->SetTitle(hists[0].GetXaxis()->GetTitle());
+    yAxis->SetTitle(hists[0].GetYaxis()->GetTitle());
 
-    auto leg = new TLegend(0.7, 0.7, 0.88, 0.88);
+    auto leg = scope.Make<TLegend>(0.7, 0.7, 0.88, 0.88);
     for (size_t i = 0; i < hists.size(); ++i) {
         auto lower = [](std::string s){ std::transform(s.begin(), s.end(), s.begin(), ::tolower); return s; };
         const std::string llbl = lower(labels[i]);
@@ -346,16 +791,22 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
     }
     if (hBkgTotal) {
         // Add a dummy clone for legend styling consistency
-        TH1D* hBkgBandLegend = (TH1D*)hBkgTotal->Clone((std::string(basename) + "_bkg_band_legend").c_str());
+        TH1D* hBkgBandLegend = scope.Adopt<TH1D>(hBkgTotal->Clone((basename + "_bkg_band_legend").c_str()));
         hBkgBandLegend->SetFillColor(kGray+1);
         hBkgBandLegend->SetFillStyle(3002);
         hBkgBandLegend->SetLineColor(kGray+2);
         hBkgBandLegend->SetMarkerSize(0);
-        leg->AddEntry(hBkgBandLegend, "Bkg. stat. unc.", "f");
+        leg->AddEntry(hBkgBandLegend, bkgCovariance ? "Bkg. stat.+syst. unc." : "Bkg. stat. unc.", "f");
     }
 
     leg->Draw();
 
+    if (!ratioPanel) {
+        c->Update();
+        SaveCanvas(*c, basename);
+        return;
+    }
+
     // Bottom pad: ratio panel                                                        
     c->cd(2);
     gPad->UseCurrentStyle();
@@ -365,8 +816,7 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
     gPad->SetLeftMargin(0.15);
 
     // Build and draw ratio histogram                                                 
-    TH1D *ratio = (TH1D*)dataHists[0]->Clone("ratio");
-    ratio->SetDirectory(0);
+    TH1D *ratio = scope.Adopt<TH1D>(dataHists[0]->Clone((basename + "_ratio").c_str()));
     ratio->SetTitle("");
     ratio->Sumw2();
     ratio->Divide(hBkgTotal);
@@ -387,8 +837,7 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
     ratio->GetYaxis()->SetLabelSize(0.08);
 
     // Draw MC statistical uncertainty band in ratio panel                            
-    TH1D *ratioMC = (TH1D*)hBkgTotal->Clone("ratioMC");
-    ratioMC->SetDirectory(0);
+    TH1D *ratioMC = scope.Adopt<TH1D>(hBkgTotal->Clone((basename + "_ratioMC").c_str()));
     ratioMC->SetTitle("");
     ratioMC->GetYaxis()->SetTitleOffset(0.5);
     ratioMC->GetXaxis()->SetTitle(hists[0].GetXaxis()->GetTitle());
@@ -411,12 +860,11 @@ void Plotter::FullDataMCSignalPlot(std::vector<TH1D>& hists,
     // Horizontal line at 1
     double xlow = ratio->GetXaxis()->GetXmin();
     double xhigh = ratio->GetXaxis()->GetXmax();                                                           
-    TLine *unity = new TLine(xlow,1.0,xhigh,1.0);
+    TLine *unity = scope.Make<TLine>(xlow,1.0,xhigh,1.0);
     unity->SetLineStyle(2);
     unity->SetLineColor(kRed);
     unity->Draw();
     c->Update();
 
-    c->SaveAs((basename + ".png").c_str());
-    c->SaveAs((basename + ".pdf").c_str());
+    SaveCanvas(*c, basename);
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "Utils/RocCurve.hxx"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+using namespace Analysis;
+
+// ----------------------------------------------------------------------//
+RocCurve::RocCurve(const std::vector<float>& score, const std::vector<double>& weight,
+                   const std::vector<char>& isSignal)
+{
+    const std::size_t n = score.size();
+    if (weight.size() != n || isSignal.size() != n)
+        throw std::runtime_error("[RocCurve] Score, weight and class arrays differ in length");
+
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&score](std::size_t a, std::size_t b) { return score[a] > score[b]; });
+
+    double totS = 0., totB = 0.;
+    for (std::size_t i = 0; i < n; ++i) (isSignal[i] ? totS : totB) += weight[i];
+    if (totS <= 0. || totB <= 0.)
+        throw std::runtime_error("[RocCurve] Need signal and background events with positive total weight");
+
+    fEffS.push_back(0.);
+    fEffB.push_back(0.);
+    double sumS = 0., sumB = 0.;
+    for (std::size_t k = 0; k < n;) {
+        // Everything at this score passes or fails together
+        const float s = score[order[k]];
+        for (; k < n && score[order[k]] == s; ++k)
+            (isSignal[order[k]] ? sumS : sumB) += weight[order[k]];
+        fEffS.push_back(sumS / totS);
+        fEffB.push_back(sumB / totB);
+        fAUC += 0.5 * (fEffS.back() + fEffS[fEffS.size() - 2]) * (fEffB.back() - fEffB[fEffB.size() - 2]);
+    }
+}
+
+// ----------------------------------------------------------------------//
+double RocCurve::SignalEfficiencyAt(double effB) const
+{
+    // effB is non-decreasing along the curve (for non-negative weights)
+    const auto it = std::lower_bound(fEffB.begin(), fEffB.end(), effB);
+    if (it == fEffB.begin()) return fEffS.front();
+    if (it == fEffB.end())   return fEffS.back();
+    const std::size_t j = it - fEffB.begin();
+    const double dB = fEffB[j] - fEffB[j - 1];
+    if (dB <= 0.) return fEffS[j];
+    return fEffS[j - 1] + (effB - fEffB[j - 1]) / dB * (fEffS[j] - fEffS[j - 1]);
+}
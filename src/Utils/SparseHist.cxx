@@ -0,0 +1,100 @@
+#include "Utils/SparseHist.hxx"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace Analysis;
+
+// ----------------------------------------------------------------------//
+SparseHist::SparseHist(const std::string& name, const std::string& title,
+                       const std::vector<SparseAxis>& axes, unsigned nSlots)
+    : fName(name), fTitle(title), fAxes(axes)
+    , fSlots(nSlots), fSlotEntries(nSlots, 0)
+{
+    if (axes.empty() || axes.size() > 3)
+        throw std::runtime_error("[SparseHist] " + name + ": 1 to 3 axes supported");
+
+    // The global bin index must fit in 64 bits
+    double total = 1.;
+    for (const auto& a : axes) {
+        if (a.nBins <= 0 || !(a.max > a.min))
+            throw std::runtime_error("[SparseHist] Invalid binning for " + name);
+        total *= a.nBins + 2.;
+    }
+    if (total >= static_cast<double>(std::numeric_limits<std::uint64_t>::max()))
+        throw std::runtime_error("[SparseHist] " + name + ": too many bins");
+}
+
+// ----------------------------------------------------------------------//
+void SparseHist::Merge()
+{
+    for (std::size_t s = 1; s < fSlots.size(); ++s) {
+        for (const auto& [bin, c] : fSlots[s]) {
+            auto& dst = fSlots[0][bin];
+            dst.sumw  += c.sumw;
+            dst.sumw2 += c.sumw2;
+        }
+        fSlotEntries[0] += fSlotEntries[s];
+    }
+    fSlots.resize(1);
+    fSlotEntries.resize(1);
+}
+
+// ----------------------------------------------------------------------//
+std::unique_ptr<THnSparseD> SparseHist::ToTHnSparse() const
+{
+    const int dim = static_cast<int>(fAxes.size());
+    std::vector<Int_t> nBins(dim);
+    std::vector<Double_t> xMin(dim), xMax(dim);
+    for (int d = 0; d < dim; ++d) {
+        nBins[d] = fAxes[d].nBins;
+        xMin[d]  = fAxes[d].min;
+        xMax[d]  = fAxes[d].max;
+    }
+    auto h = std::make_unique<THnSparseD>(fName.c_str(), fTitle.c_str(), dim, nBins.data(), xMin.data(), xMax.data());
+    h->Sumw2();
+    if (fSlots.empty()) return h;
+
+    std::vector<Int_t> coord(dim);
+    for (const auto& [bin, c] : fSlots[0]) {
+        std::uint64_t rest = bin;
+        for (int d = dim - 1; d >= 0; --d) {
+            const auto n = static_cast<std::uint64_t>(fAxes[d].nBins + 2);
+            coord[d] = static_cast<Int_t>(rest % n);
+            rest /= n;
+        }
+        h->SetBinContent(coord.data(), c.sumw);
+        h->SetBinError(coord.data(), std::sqrt(c.sumw2));
+    }
+    h->SetEntries(static_cast<Double_t>(fSlotEntries[0]));
+    return h;
+}
+
+// ----------------------------------------------------------------------//
+ROOT::RDF::RResultPtr<SparseHist> Analysis::BookSparse(ROOT::RDF::RNode node,
+                                                       const std::string& name,
+                                                       const std::string& title,
+                                                       const std::vector<SparseAxis>& axes,
+                                                       const std::vector<std::string>& cols)
+{
+    const unsigned nSlots = node.GetNSlots();
+    const bool weighted = cols.size() == axes.size() + 1;
+    if (!weighted && cols.size() != axes.size())
+        throw std::runtime_error("[SparseHist] " + name + ": expected one column per axis (+ weight)");
+
+    switch (axes.size()) {
+    case 1:
+        if (weighted) return node.Book<double, double>(SparseFillHelper<1>(name, title, axes, nSlots), cols);
+        return node.Book<double>(SparseFillHelper<1>(name, title, axes, nSlots), cols);
+    case 2:
+        if (weighted) return node.Book<double, double, double>(SparseFillHelper<2>(name, title, axes, nSlots), cols);
+        return node.Book<double, double>(SparseFillHelper<2>(name, title, axes, nSlots), cols);
+    case 3:
+        if (weighted)
+            return node.Book<double, double, double, double>(SparseFillHelper<3>(name, title, axes, nSlots), cols);
+        return node.Book<double, double, double>(SparseFillHelper<3>(name, title, axes, nSlots), cols);
+    default:
+        throw std::runtime_error("[SparseHist] " + name + ": 1 to 3 axes supported");
+    }
+}
@@ -0,0 +1,161 @@
+#include "Utils/ToyLimit.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+using namespace Analysis;
+
+namespace {
+
+// Background floor: a bin with b = 0 and n > 0 would pin muhat away from 0
+constexpr double kMinBkg = 1e-6;
+
+// Fraction of the sorted values v at or above x
+double TailFraction(const std::vector<double>& v, double x)
+{
+    if (v.empty()) return 0.;
+    const auto it = std::lower_bound(v.begin(), v.end(), x);
+    return static_cast<double>(v.end() - it) / static_cast<double>(v.size());
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------//
+ToyLimit::ToyLimit(std::vector<double> s, std::vector<double> b, std::vector<double> data)
+    : fS(std::move(s)), fB(std::move(b)), fData(std::move(data))
+{
+    if (fS.size() != fB.size() || (!fData.empty() && fData.size() != fS.size()))
+        throw std::runtime_error("[ToyLimit] Signal, background and data binnings differ");
+    for (auto& v : fS) v = std::max(v, 0.);
+    for (auto& v : fB) v = std::max(v, kMinBkg);
+    if (TotalSignal() <= 0.)
+        throw std::runtime_error("[ToyLimit] No signal expected");
+}
+
+// ----------------------------------------------------------------------//
+double ToyLimit::TotalSignal() const
+{
+    return std::accumulate(fS.begin(), fS.end(), 0.);
+}
+
+// ----------------------------------------------------------------------//
+double ToyLimit::TotalBackground() const
+{
+    return std::accumulate(fB.begin(), fB.end(), 0.);
+}
+
+// ----------------------------------------------------------------------//
+double ToyLimit::NLL(double mu, const double* n) const
+{
+    // Constant ln(n!) terms dropped
+    double nll = 0.;
+    for (std::size_t i = 0; i < fS.size(); ++i) {
+        const double nu = mu * fS[i] + fB[i];
+        nll += nu - n[i] * std::log(nu);
+    }
+    return nll;
+}
+
+// ----------------------------------------------------------------------//
+double ToyLimit::MuHat(const double* n) const
+{
+    // dNLL/dmu = sum s - sum n s / (mu s + b) is increasing in mu
+    auto grad = [&](double mu, double& curv) {
+        double g = 0.;
+        curv = 0.;
+        for (std::size_t i = 0; i < fS.size(); ++i) {
+            const double nu = mu * fS[i] + fB[i];
+            const double r  = n[i] * fS[i] / nu;
+            g    += fS[i] - r;
+            curv += r * fS[i] / nu;
+        }
+        return g;
+    };
+
+    double curv;
+    if (grad(0., curv) >= 0.) return 0.;
+
+    // Bracket the root, then Newton steps kept inside the bracket
+    double lo = 0., hi = 1.;
+    while (grad(hi, curv) < 0.) {
+        lo = hi;
+        hi *= 2.;
+    }
+    double mu = 0.5 * (lo + hi);
+    for (int it = 0; it < 100; ++it) {
+        const double g = grad(mu, curv);
+        if (g < 0.) lo = mu;
+        else        hi = mu;
+        double next = curv > 0. ? mu - g / curv : 0.5 * (lo + hi);
+        if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+        if (std::abs(next - mu) <= 1e-10 * std::max(1., mu)) return next;
+        mu = next;
+    }
+    return mu;
+}
+
+// ----------------------------------------------------------------------//
+double ToyLimit::QMu(double mu, const double* n) const
+{
+    const double muHat = MuHat(n);
+    if (muHat >= mu) return 0.;
+    return std::max(0., 2. * (NLL(mu, n) - NLL(muHat, n)));
+}
+
+// ----------------------------------------------------------------------//
+ToyLimit::ToySet ToyLimit::Toys(double mu, int nToys, std::uint64_t seed) const
+{
+    ToySet t;
+    t.mu = mu;
+    if (HasData()) t.qObs = QMu(mu, fData.data());
+
+    std::mt19937_64 rng(seed);
+    std::vector<std::poisson_distribution<long>> sb, b;
+    for (std::size_t i = 0; i < fS.size(); ++i) {
+        sb.emplace_back(mu * fS[i] + fB[i]);
+        b.emplace_back(fB[i]);
+    }
+
+    std::vector<double> n(fS.size());
+    t.qSB.resize(nToys);
+    t.qB.resize(nToys);
+    for (int k = 0; k < nToys; ++k) {
+        for (std::size_t i = 0; i < n.size(); ++i) n[i] = static_cast<double>(sb[i](rng));
+        t.qSB[k] = QMu(mu, n.data());
+        for (std::size_t i = 0; i < n.size(); ++i) n[i] = static_cast<double>(b[i](rng));
+        t.qB[k] = QMu(mu, n.data());
+    }
+    std::sort(t.qSB.begin(), t.qSB.end());
+    std::sort(t.qB.begin(), t.qB.end());
+    return t;
+}
+
+// ----------------------------------------------------------------------//
+double ToyLimit::CLs(const ToySet& t, double qRef)
+{
+    const double clb = TailFraction(t.qB, qRef);
+    return clb > 0. ? TailFraction(t.qSB, qRef) / clb : 0.;
+}
+
+// ----------------------------------------------------------------------//
+double ToyLimit::ExpectedCLs(const ToySet& t, std::size_t k)
+{
+    if (t.qB.empty()) return 0.;
+    const auto idx = static_cast<std::size_t>(kBandQuantiles[k] * (t.qB.size() - 1) + 0.5);
+    return CLs(t, t.qB[idx]);
+}
+
+// ----------------------------------------------------------------------//
+double ToyLimit::Crossing(const std::vector<double>& mus, const std::vector<double>& cls, double alpha)
+{
+    for (std::size_t j = 0; j < mus.size(); ++j) {
+        if (cls[j] >= alpha) continue;
+        if (j == 0) return mus[0];
+        const double f = (cls[j - 1] - alpha) / (cls[j - 1] - cls[j]);
+        return mus[j - 1] + f * (mus[j] - mus[j - 1]);
+    }
+    return mus.empty() ? 0. : mus.back();
+}
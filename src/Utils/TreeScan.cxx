@@ -0,0 +1,127 @@
+#include "Utils/TreeScan.hxx"
+
+#include <TFile.h>
+#include <TROOT.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace Analysis;
+
+namespace {
+
+TTree* OpenTree(TFile& f, const std::string& file, const std::string& treeName)
+{
+    auto* tree = f.IsZombie() ? nullptr : f.Get<TTree>(treeName.c_str());
+    if (!tree) throw std::runtime_error("[TreeScan] Cannot read " + treeName + " from " + file);
+    return tree;
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------//
+std::size_t TreeScan::MaxTasks()
+{
+    // A few tasks per thread, so one slow run of clusters does not hold up the pass
+    return ROOT::IsImplicitMTEnabled() ? 4 * std::max(1u, ROOT::GetThreadPoolSize()) : 1;
+}
+
+// ----------------------------------------------------------------------//
+std::vector<std::pair<Long64_t, Long64_t>>
+TreeScan::Tasks(const std::string& file, const std::string& treeName, Long64_t begin, Long64_t end)
+{
+    std::vector<std::pair<Long64_t, Long64_t>> tasks;
+    if (begin >= end) return tasks;
+
+    std::vector<Long64_t> bounds{begin};
+    {
+        std::unique_ptr<TFile> f{TFile::Open(file.c_str(), "READ")};
+        if (!f) throw std::runtime_error("[TreeScan] Cannot open " + file);
+        TTree* tree = OpenTree(*f, file, treeName);
+        auto it = tree->GetClusterIterator(begin);
+        Long64_t start;
+        while ((start = it()) < end) {
+            const Long64_t next = std::min(it.GetNextEntry(), end);
+            bounds.push_back(next);
+            if (next >= end) break;
+        }
+    }
+
+    // Cut the cluster boundaries into about MaxTasks() runs of equal entries
+    const std::size_t nTasks = std::min(MaxTasks(), bounds.size() - 1);
+    const double perTask = static_cast<double>(end - begin) / nTasks;
+    Long64_t taskBegin = begin;
+    for (std::size_t b = 1; b < bounds.size(); ++b) {
+        const bool last = b + 1 == bounds.size();
+        if (last || bounds[b] - begin >= perTask * (tasks.size() + 1)) {
+            tasks.emplace_back(taskBegin, bounds[b]);
+            taskBegin = bounds[b];
+        }
+    }
+    return tasks;
+}
+
+// ----------------------------------------------------------------------//
+void TreeScan::ForEach(const std::string& file, const std::string& treeName,
+                       const std::vector<std::string>& exprs, Long64_t begin, Long64_t end,
+                       const Callback& fn)
+{
+    const auto tasks = Tasks(file, treeName, begin, end);
+    if (tasks.empty()) return;
+
+    std::atomic<std::size_t> next{0};
+    std::mutex mtx;
+    std::vector<std::string> errors;
+    auto worker = [&]() {
+        try {
+            // This thread's tree and formulas
+            std::unique_ptr<TFile> f{TFile::Open(file.c_str(), "READ")};
+            if (!f) throw std::runtime_error("[TreeScan] Cannot open " + file);
+            TTree* tree = OpenTree(*f, file, treeName);
+            std::vector<std::unique_ptr<TTreeFormula>> owned;
+            Values values;
+            for (std::size_t k = 0; k < exprs.size(); ++k) {
+                owned.push_back(std::make_unique<TTreeFormula>(("scan" + std::to_string(k)).c_str(),
+                                                               exprs[k].c_str(), tree));
+                if (owned.back()->GetNdim() == 0)
+                    throw std::runtime_error("[TreeScan] Cannot evaluate '" + exprs[k] + "' on " + treeName);
+                values.formulas.push_back(owned.back().get());
+            }
+            values.sizes.resize(exprs.size());
+
+            for (std::size_t t = next++; t < tasks.size(); t = next++) {
+                for (Long64_t e = tasks[t].first; e < tasks[t].second; ++e) {
+                    tree->LoadTree(e);
+                    for (std::size_t k = 0; k < exprs.size(); ++k) values.sizes[k] = values.formulas[k]->GetNdata();
+                    fn(t, e, values);
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(mtx);
+            errors.emplace_back(e.what());
+            next = tasks.size();   // stop the other workers early
+        }
+    };
+
+    const std::size_t nWorkers = ROOT::IsImplicitMTEnabled()
+        ? std::min<std::size_t>(std::max(1u, ROOT::GetThreadPoolSize()), tasks.size()) : 1;
+    if (nWorkers == 1) {
+        worker();
+    }
+    else {
+        ROOT::EnableThreadSafety();
+        std::vector<std::thread> pool;
+        for (std::size_t w = 0; w < nWorkers; ++w) pool.emplace_back(worker);
+        for (auto& t : pool) t.join();
+    }
+
+    for (const auto& e : errors) std::cerr << e << "\n";
+    if (!errors.empty()) throw std::runtime_error(errors.front());
+}
@@ -0,0 +1,166 @@
+#include "Utils/UniverseHist.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace Analysis;
+
+// ----------------------------------------------------------------------//
+UniverseHist::UniverseHist(const std::string& name, int nBins, double xMin, double xMax, unsigned nSlots)
+    : fName(name), fNBins(nBins), fXMin(xMin), fXMax(xMax)
+    , fCV(nSlots, std::vector<double>(static_cast<std::size_t>(nBins) + 2, 0.))
+    , fNoWeights(nSlots, std::vector<double>(static_cast<std::size_t>(nBins) + 2, 0.))
+    , fFill(nSlots)
+    , fSlotNU(nSlots, 0)
+{
+    if (nBins <= 0 || !(xMax > xMin))
+        throw std::runtime_error("[UniverseHist] Invalid binning for " + name);
+}
+
+// ----------------------------------------------------------------------//
+int UniverseHist::FindBin(double x) const
+{
+    // Same convention as TAxis::FindFixBin, NaN included (overflow)
+    if (x < fXMin)     return 0;
+    if (!(x < fXMax))  return fNBins + 1;
+    return 1 + static_cast<int>(fNBins * (x - fXMin) / (fXMax - fXMin));
+}
+
+// ----------------------------------------------------------------------//
+double* UniverseHist::SlotRow(unsigned slot, int bin, std::size_t n)
+{
+    auto& nu = fSlotNU[slot];
+    if (nu == 0) {
+        nu = n;
+        fFill[slot].assign(Stride() * n, 0.);
+    }
+    else if (nu != n) {
+        throw std::runtime_error("[UniverseHist] " + fName + ": event with " + std::to_string(n)
+                                 + " weights, expected " + std::to_string(nu));
+    }
+    return fFill[slot].data() + static_cast<std::size_t>(bin) * n;
+}
+
+// ----------------------------------------------------------------------//
+void UniverseHist::Merge()
+{
+    fNUniverses = 0;
+    for (auto nu : fSlotNU) {
+        if (nu == 0) continue;
+        if (fNUniverses != 0 && nu != fNUniverses)
+            throw std::runtime_error("[UniverseHist] " + fName + ": inconsistent universe counts between threads");
+        fNUniverses = nu;
+    }
+
+    const std::size_t stride = Stride();
+    fUniv.assign(fNUniverses * stride, 0.);
+    for (std::size_t s = 0; s < fFill.size(); ++s) {
+        if (fSlotNU[s] == 0) continue;
+        const double* buf = fFill[s].data();
+        for (std::size_t b = 0; b < stride; ++b)
+            for (std::size_t u = 0; u < fNUniverses; ++u)
+                fUniv[u * stride + b] += buf[b * fNUniverses + u];
+    }
+    for (std::size_t s = 1; s < fCV.size(); ++s)
+        for (std::size_t b = 0; b < stride; ++b) fCV[0][b] += fCV[s][b];
+
+    // Events without weights, from any slot, at their central value in every universe
+    for (const auto& noWeights : fNoWeights)
+        for (std::size_t u = 0; u < fNUniverses; ++u)
+            for (std::size_t b = 0; b < stride; ++b) fUniv[u * stride + b] += noWeights[b];
+
+    // Fill buffers are no longer needed
+    fFill.assign(1, {});
+    fSlotNU.assign(1, 0);
+    fCV.resize(1);
+    fNoWeights.assign(1, std::vector<double>(stride, 0.));
+}
+
+// ----------------------------------------------------------------------//
+void UniverseHist::Add(const UniverseHist& other, double scale)
+{
+    if (fNBins == 0) {            // default-constructed: adopt the other's binning
+        fName  = other.fName;
+        fNBins = other.fNBins;
+        fXMin  = other.fXMin;
+        fXMax  = other.fXMax;
+        fCV.assign(1, std::vector<double>(Stride(), 0.));
+        fNoWeights.assign(1, std::vector<double>(Stride(), 0.));
+        fFill.assign(1, {});
+        fSlotNU.assign(1, 0);
+    }
+    if (other.fNBins != fNBins)
+        throw std::runtime_error("[UniverseHist] Cannot add " + other.fName + " to " + fName + ": different binning");
+
+    // A histogram without weights (e.g. an empty sample) sits at its central
+    // value in every universe
+    const std::size_t stride = Stride();
+    if (fNUniverses == 0 && other.fNUniverses != 0) {
+        fNUniverses = other.fNUniverses;
+        fUniv.resize(fNUniverses * stride);
+        for (std::size_t u = 0; u < fNUniverses; ++u)
+            std::copy(fCV[0].begin(), fCV[0].end(), fUniv.begin() + u * stride);
+    }
+    if (other.fNUniverses != 0 && other.fNUniverses != fNUniverses)
+        throw std::runtime_error("[UniverseHist] Cannot add " + other.fName + " to " + fName
+                                 + ": different universe count");
+
+    for (std::size_t u = 0; u < fNUniverses; ++u)
+        for (std::size_t b = 0; b < stride; ++b)
+            fUniv[u * stride + b] += scale * (other.fNUniverses ? other.At(u, b) : other.fCV[0][b]);
+    for (std::size_t b = 0; b < stride; ++b) fCV[0][b] += scale * other.fCV[0][b];
+}
+
+// ----------------------------------------------------------------------//
+TH1D UniverseHist::CentralValue() const
+{
+    TH1D h((fName + "_cv").c_str(), "", fNBins, fXMin, fXMax);
+    h.SetDirectory(nullptr);
+    for (int b = 0; b <= fNBins + 1; ++b) h.SetBinContent(b, fCV[0][b]);
+    return h;
+}
+
+// ----------------------------------------------------------------------//
+TH1D UniverseHist::Universe(std::size_t u) const
+{
+    TH1D h((fName + "_univ" + std::to_string(u)).c_str(), "", fNBins, fXMin, fXMax);
+    h.SetDirectory(nullptr);
+    for (int b = 0; b <= fNBins + 1; ++b) h.SetBinContent(b, At(u, b));
+    return h;
+}
+
+// ----------------------------------------------------------------------//
+TH2D UniverseHist::Covariance() const
+{
+    TH2D cov((fName + "_cov").c_str(), ";bin i;bin j", fNBins, fXMin, fXMax, fNBins, fXMin, fXMax);
+    cov.SetDirectory(nullptr);
+    if (fNUniverses == 0) return cov;
+
+    const std::size_t stride = Stride();
+    std::vector<double> m(static_cast<std::size_t>(fNBins) * fNBins, 0.);
+    std::vector<double> d(fNBins);
+    for (std::size_t u = 0; u < fNUniverses; ++u) {
+        const double* row = fUniv.data() + u * stride;
+        for (int i = 0; i < fNBins; ++i) d[i] = row[i + 1] - fCV[0][i + 1];
+        for (int i = 0; i < fNBins; ++i)
+            for (int j = i; j < fNBins; ++j) m[i * fNBins + j] += d[i] * d[j];
+    }
+    for (int i = 0; i < fNBins; ++i)
+        for (int j = i; j < fNBins; ++j) {
+            const double c = m[i * fNBins + j] / static_cast<double>(fNUniverses);
+            cov.SetBinContent(i + 1, j + 1, c);
+            cov.SetBinContent(j + 1, i + 1, c);
+        }
+    return cov;
+}
+
+// ----------------------------------------------------------------------//
+TH1D UniverseHist::ErrorBand() const
+{
+    TH1D band = CentralValue();
+    band.SetName((fName + "_band").c_str());
+    const TH2D cov = Covariance();
+    for (int b = 1; b <= fNBins; ++b) band.SetBinError(b, std::sqrt(std::max(0., cov.GetBinContent(b, b))));
+    return band;
+}
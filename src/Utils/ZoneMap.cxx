@@ -0,0 +1,279 @@
+#include "Utils/ZoneMap.hxx"
+#include "Utils/TreeScan.hxx"
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TTreeFormula.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Analysis;
+
+namespace {
+
+bool MayPass(const ZoneMap::Stats& s, Long64_t nEntries, const ZoneMap::Term& t)
+{
+    // Null (NaN) values fail every comparison
+    if (s.nNull >= nEntries) return false;
+    using Op = ZoneMap::Term::Op;
+    switch (t.op) {
+        case Op::Less:         return s.min <  t.value;
+        case Op::LessEqual:    return s.min <= t.value;
+        case Op::Greater:      return s.max >  t.value;
+        case Op::GreaterEqual: return s.max >= t.value;
+        case Op::Equal:        return s.min <= t.value && t.value <= s.max;
+    }
+    return true;
+}
+
+} // namespace
+
+// ----------------------------------------------------------------------//
+ZoneMap ZoneMap::Build(const std::string& file, const std::string& treeName,
+                       const std::vector<std::string>& columns)
+{
+    ZoneMap zm;
+    zm.fTreeName = treeName;
+    zm.fColumns  = columns;
+    {
+        std::unique_ptr<TFile> f{TFile::Open(file.c_str(), "READ")};
+        auto* tree = f && !f->IsZombie() ? f->Get<TTree>(treeName.c_str()) : nullptr;
+        if (!tree) throw std::runtime_error("[ZoneMap] Cannot read " + treeName + " from " + file);
+        zm.fEntries = tree->GetEntries();
+        auto it = tree->GetClusterIterator(0);
+        Long64_t start;
+        while ((start = it()) < zm.fEntries)
+            zm.fClusters.push_back({start, std::min(it.GetNextEntry(), zm.fEntries), {}});
+        for (const auto& c : columns) {
+            TTreeFormula formula("zonemap_column", c.c_str(), tree);
+            if (formula.GetNdim() == 0)
+                throw std::runtime_error("[ZoneMap] Unknown column " + c + " in " + file);
+            zm.fIsVector.push_back(formula.GetMultiplicity() != 0);
+        }
+    }
+    const std::size_t nCols = columns.size();
+    const std::size_t nClusters = zm.fClusters.size();
+    std::vector<Long64_t> starts(nClusters);
+    for (std::size_t c = 0; c < nClusters; ++c) starts[c] = zm.fClusters[c].begin;
+
+    // Statistics per task (a run of whole clusters) over the tree entry
+    // numbers themselves, merged afterwards. Vector columns count an empty
+    // vector as null and contribute all their elements.
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    std::vector<std::vector<Stats>> acc(TreeScan::MaxTasks(),
+                                        std::vector<Stats>(nClusters * nCols, Stats{inf, -inf, 0}));
+
+    TreeScan::ForEach(file, treeName, columns, 0, zm.fEntries,
+        [&](std::size_t task, Long64_t entry, const TreeScan::Values& v) {
+            const auto c = static_cast<std::size_t>(
+                std::upper_bound(starts.begin(), starts.end(), entry) - starts.begin() - 1);
+            Stats* s = &acc[task][c * nCols];
+            for (std::size_t k = 0; k < nCols; ++k) {
+                const int n = v.Size(k);
+                bool any = false;
+                for (int i = 0; i < n; ++i) {
+                    const double x = v.Get(k, i);
+                    if (std::isnan(x)) continue;
+                    s[k].min = std::min(s[k].min, x);
+                    s[k].max = std::max(s[k].max, x);
+                    any = true;
+                }
+                if (!any) ++s[k].nNull;
+            }
+        });
+
+    for (std::size_t c = 0; c < nClusters; ++c) {
+        auto& stats = zm.fClusters[c].stats;
+        stats.assign(nCols, Stats{inf, -inf, 0});
+        for (const auto& task : acc) {
+            for (std::size_t k = 0; k < nCols; ++k) {
+                const Stats& s = task[c * nCols + k];
+                stats[k].min = std::min(stats[k].min, s.min);
+                stats[k].max = std::max(stats[k].max, s.max);
+                stats[k].nNull += s.nNull;
+            }
+        }
+        // All null: the range is meaningless, keep it finite for the text file
+        for (auto& s : stats)
+            if (s.min > s.max) s.min = s.max = 0.;
+    }
+    return zm;
+}
+
+// ----------------------------------------------------------------------//
+void ZoneMap::WriteSidecar(const std::string& file, const std::string& treeName,
+                           const std::vector<std::string>& columns)
+{
+    Build(file, treeName, columns).Write(SidecarPath(file));
+}
+
+// ----------------------------------------------------------------------//
+void ZoneMap::Write(const std::string& path) const
+{
+    // zonemap <tree> <entries>; columns ...; vector flags; one line per cluster:
+    // begin end (min max nnull) per column
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) throw std::runtime_error("[ZoneMap] Cannot write " + path);
+    out << std::setprecision(17);
+    out << "zonemap " << fTreeName << " " << fEntries << "\ncolumns";
+    for (const auto& c : fColumns) out << " " << c;
+    out << "\nvector";
+    for (const bool v : fIsVector) out << " " << v;
+    out << "\n";
+    for (const auto& cl : fClusters) {
+        out << cl.begin << " " << cl.end;
+        for (const auto& s : cl.stats) out << "  " << s.min << " " << s.max << " " << s.nNull;
+        out << "\n";
+    }
+    if (!out) throw std::runtime_error("[ZoneMap] Failed writing " + path);
+}
+
+// ----------------------------------------------------------------------//
+ZoneMap ZoneMap::Read(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("[ZoneMap] Cannot open " + path);
+
+    ZoneMap zm;
+    std::string word, line;
+    if (!(in >> word) || word != "zonemap" || !(in >> zm.fTreeName >> zm.fEntries))
+        throw std::runtime_error("[ZoneMap] Not a zone map: " + path);
+    std::getline(in, line);
+
+    std::getline(in, line);
+    std::istringstream cols(line);
+    cols >> word;
+    while (cols >> word) zm.fColumns.push_back(word);
+
+    std::getline(in, line);
+    std::istringstream flags(line);
+    flags >> word;
+    bool flag;
+    while (flags >> flag) zm.fIsVector.push_back(flag);
+    if (zm.fIsVector.size() != zm.fColumns.size())
+        throw std::runtime_error("[ZoneMap] Malformed header in " + path);
+
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        std::istringstream ss(line);
+        Cluster cl;
+        ss >> cl.begin >> cl.end;
+        cl.stats.resize(zm.fColumns.size());
+        for (auto& s : cl.stats) ss >> s.min >> s.max >> s.nNull;
+        if (!ss) throw std::runtime_error("[ZoneMap] Malformed cluster line in " + path);
+        zm.fClusters.push_back(std::move(cl));
+    }
+    return zm;
+}
+
+// ----------------------------------------------------------------------//
+std::optional<ZoneMap> ZoneMap::Load(const std::string& file, const std::string& treeName)
+{
+    namespace fs = std::filesystem;
+    const std::string sidecar = SidecarPath(file);
+    std::error_code ec;
+    if (!fs::exists(sidecar, ec) || fs::last_write_time(sidecar, ec) < fs::last_write_time(file, ec) || ec)
+        return std::nullopt;
+    ZoneMap zm = Read(sidecar);
+    if (zm.fTreeName != treeName) return std::nullopt;
+    return zm;
+}
+
+// ----------------------------------------------------------------------//
+std::vector<ZoneMap::Term> ZoneMap::ParseCuts(const std::vector<std::string>& cuts)
+{
+    static const std::string num  = R"([-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?)";
+    static const std::string name = R"([A-Za-z_]\w*)";
+    static const std::regex columnFirst(R"(^\s*()" + name + R"()\s*(<=|>=|==|<|>)\s*()" + num + R"()\s*$)");
+    static const std::regex numberFirst(R"(^\s*()" + num + R"()\s*(<=|>=|==|<|>)\s*()" + name + R"()\s*$)");
+
+    auto toOp = [](const std::string& s, bool flip) {
+        using Op = Term::Op;
+        if (s == "==") return Op::Equal;
+        if (s == "<")  return flip ? Op::Greater      : Op::Less;
+        if (s == "<=") return flip ? Op::GreaterEqual : Op::LessEqual;
+        if (s == ">")  return flip ? Op::Less         : Op::Greater;
+        return flip ? Op::LessEqual : Op::GreaterEqual;
+    };
+
+    std::vector<Term> terms;
+    for (const auto& cut : cuts) {
+        // Only plain conjunctions: with || or grouping a term need not hold on its own
+        if (cut.find("||") != std::string::npos || cut.find('(') != std::string::npos) continue;
+        std::size_t pos = 0;
+        while (pos <= cut.size()) {
+            const std::size_t amp = std::min(cut.find("&&", pos), cut.size());
+            const std::string part = cut.substr(pos, amp - pos);
+            std::smatch m;
+            if (std::regex_match(part, m, columnFirst))
+                terms.push_back({m[1], toOp(m[2], false), std::stod(m[3])});
+            else if (std::regex_match(part, m, numberFirst))
+                terms.push_back({m[3], toOp(m[2], true), std::stod(m[1])});
+            pos = amp + 2;
+        }
+    }
+    return terms;
+}
+
+// ----------------------------------------------------------------------//
+std::vector<std::pair<Long64_t, Long64_t>>
+ZoneMap::Candidates(const std::vector<Term>& terms, Long64_t first, Long64_t last) const
+{
+    // Terms on scalar columns of this map, as (column index, term)
+    std::vector<std::pair<std::size_t, const Term*>> usable;
+    for (const auto& t : terms) {
+        const auto it = std::find(fColumns.begin(), fColumns.end(), t.column);
+        if (it == fColumns.end()) continue;
+        const auto k = static_cast<std::size_t>(it - fColumns.begin());
+        if (!fIsVector[k]) usable.emplace_back(k, &t);
+    }
+
+    std::vector<std::pair<Long64_t, Long64_t>> ranges;
+    for (const auto& cl : fClusters) {
+        const Long64_t b = std::max(cl.begin, first), e = std::min(cl.end, last);
+        if (b >= e) continue;
+        const bool keep = std::all_of(usable.begin(), usable.end(), [&cl](const auto& u) {
+            return MayPass(cl.stats[u.first], cl.end - cl.begin, *u.second);
+        });
+        if (!keep) continue;
+        if (!ranges.empty() && ranges.back().second == b) ranges.back().second = e;
+        else ranges.emplace_back(b, e);
+    }
+    return ranges;
+}
+
+// ----------------------------------------------------------------------//
+Long64_t ZoneMap::Narrow(const std::string& file, const std::string& treeName, Long64_t nEntries,
+                         const std::vector<Term>& terms, std::vector<std::pair<Long64_t, Long64_t>>& ranges)
+{
+    if (terms.empty() || ranges.empty()) return 0;
+    const auto zm = Load(file, treeName);
+    if (!zm || zm->fEntries != nEntries) return 0;
+
+    Long64_t before = 0, after = 0;
+    std::vector<std::pair<Long64_t, Long64_t>> kept;
+    for (const auto& [b, e] : ranges) {
+        before += e - b;
+        for (const auto& r : zm->Candidates(terms, b, e)) {
+            after += r.second - r.first;
+            kept.push_back(r);
+        }
+    }
+    // No cluster can pass: keep a single entry for the cuts to reject, as an
+    // empty entry list would be taken as no list at all
+    if (kept.empty()) {
+        kept.emplace_back(ranges.front().first, ranges.front().first + 1);
+        after = 1;
+    }
+    ranges = std::move(kept);
+    return before - after;
+}